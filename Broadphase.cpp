@@ -0,0 +1,193 @@
+#include "Broadphase.h"
+
+#include "Entities.h"
+#include "Jobs.h"
+#include "Trace.h"
+
+#include <atomic>
+
+constexpr int CELL_COUNT = Broadphase::CELLS_X * Broadphase::CELLS_Y * Broadphase::CELLS_Z;
+
+// entities per job
+constexpr int BUILD_CHUNK = 4096;
+constexpr int QUERY_CHUNK = 256;
+
+// the entities in cell c are sorted[cellStart[c]] to sorted[cellStart[c + 1] - 1]
+static int* cellStart = new int[CELL_COUNT + 1];
+static std::atomic<int>* cellCounts = new std::atomic<int>[CELL_COUNT];
+static int* sorted = new int[MAX_ENTITIES];
+
+// each entity's cell, and where it goes in that cell
+static int* cellOf = new int[MAX_ENTITIES];
+static int* rankInCell = new int[MAX_ENTITIES];
+
+// the biggest half size of any entity, how far past its cell a box can reach
+static vec3 reach;
+
+static int builtCount = 0;
+
+static int clampInt(const int val, const int max)
+{
+    return val < 0 ? 0 : (val > max ? max : val);
+}
+
+static int cellX(const float x)
+{
+    return clampInt(int(x) / BROADPHASE_CELL, Broadphase::CELLS_X - 1);
+}
+
+static int cellY(const float y)
+{
+    return clampInt(int(y) / BROADPHASE_CELL, Broadphase::CELLS_Y - 1);
+}
+
+static int cellZ(const float z)
+{
+    return clampInt(int(z) / BROADPHASE_CELL, Broadphase::CELLS_Z - 1);
+}
+
+void Broadphase::build()
+{
+    using namespace Entities;
+
+    builtCount = count();
+    if (builtCount == 0)
+        return;
+
+    TRACE_ZONE("Broadphase::build");
+
+    const int chunks = (builtCount + BUILD_CHUNK - 1) / BUILD_CHUNK;
+    vec3* chunkReach = new vec3[chunks];
+
+    for (int c = 0; c < CELL_COUNT; c++)
+        cellCounts[c].store(0, std::memory_order_relaxed);
+
+    // find everyone's cell and count the cells up
+    Jobs::parallelFor(chunks, [&](const int chunk) {
+        const int begin = chunk * BUILD_CHUNK;
+        const int end = begin + BUILD_CHUNK < builtCount ? begin + BUILD_CHUNK : builtCount;
+
+        vec3 biggest;
+        for (int i = begin; i < end; i++)
+        {
+            const int cell = cellX(posX[i]) + cellY(posY[i]) * CELLS_X + cellZ(posZ[i]) * CELLS_X * CELLS_Y;
+            cellOf[i] = cell;
+            rankInCell[i] = cellCounts[cell].fetch_add(1, std::memory_order_relaxed);
+
+            biggest.x = halfX[i] > biggest.x ? halfX[i] : biggest.x;
+            biggest.y = halfY[i] > biggest.y ? halfY[i] : biggest.y;
+            biggest.z = halfZ[i] > biggest.z ? halfZ[i] : biggest.z;
+        }
+        chunkReach[chunk] = biggest;
+    });
+
+    reach = vec3(0);
+    for (int chunk = 0; chunk < chunks; chunk++)
+    {
+        reach.x = chunkReach[chunk].x > reach.x ? chunkReach[chunk].x : reach.x;
+        reach.y = chunkReach[chunk].y > reach.y ? chunkReach[chunk].y : reach.y;
+        reach.z = chunkReach[chunk].z > reach.z ? chunkReach[chunk].z : reach.z;
+    }
+    delete[] chunkReach;
+
+    int start = 0;
+    for (int c = 0; c < CELL_COUNT; c++)
+    {
+        cellStart[c] = start;
+        start += cellCounts[c].load(std::memory_order_relaxed);
+    }
+    cellStart[CELL_COUNT] = start;
+
+    Jobs::parallelFor(chunks, [&](const int chunk) {
+        const int begin = chunk * BUILD_CHUNK;
+        const int end = begin + BUILD_CHUNK < builtCount ? begin + BUILD_CHUNK : builtCount;
+
+        for (int i = begin; i < end; i++)
+            sorted[cellStart[cellOf[i]] + rankInCell[i]] = i;
+    });
+}
+
+// call test(i) on every entity in a cell that a box reaching [min, max] could be centred in
+template<typename F>
+static int query(const vec3& min, const vec3& max, int* out, const int maxOut, const F& test)
+{
+    if (builtCount == 0)
+        return 0;
+
+    const int x0 = cellX(min.x - reach.x), x1 = cellX(max.x + reach.x);
+    const int y0 = cellY(min.y - reach.y), y1 = cellY(max.y + reach.y);
+    const int z0 = cellZ(min.z - reach.z), z1 = cellZ(max.z + reach.z);
+
+    int found = 0;
+    for (int z = z0; z <= z1; z++)
+    {
+        for (int y = y0; y <= y1; y++)
+        {
+            const int row = (y + z * Broadphase::CELLS_Y) * Broadphase::CELLS_X;
+            for (int k = cellStart[row + x0]; k < cellStart[row + x1 + 1]; k++)
+            {
+                const int i = sorted[k];
+                if (test(i))
+                {
+                    if (found < maxOut)
+                        out[found] = i;
+                    found++;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+int Broadphase::queryBox(const Collision::Box& box, int* out, const int maxOut)
+{
+    using namespace Entities;
+
+    return query(box.min, box.max, out, maxOut, [&](const int i) {
+        return posX[i] - halfX[i] < box.max.x && posX[i] + halfX[i] > box.min.x &&
+               posY[i] - halfY[i] < box.max.y && posY[i] + halfY[i] > box.min.y &&
+               posZ[i] - halfZ[i] < box.max.z && posZ[i] + halfZ[i] > box.min.z;
+    });
+}
+
+// how far v is outside [centre - half, centre + half] on one axis
+static float outside(const float v, const float centre, const float half)
+{
+    const float d = v > centre ? v - centre - half : centre - v - half;
+    return d > 0 ? d : 0;
+}
+
+int Broadphase::queryRadius(const vec3& centre, const float radius, int* out, const int maxOut)
+{
+    using namespace Entities;
+
+    return query(centre - vec3(radius), centre + vec3(radius), out, maxOut, [&](const int i) {
+        const float dx = outside(centre.x, posX[i], halfX[i]);
+        const float dy = outside(centre.y, posY[i], halfY[i]);
+        const float dz = outside(centre.z, posZ[i], halfZ[i]);
+        return dx * dx + dy * dy + dz * dz <= radius * radius;
+    });
+}
+
+void Broadphase::queryBoxes(const int count, const Collision::Box* boxes, int* out, int* counts, const int maxPerQuery)
+{
+    TRACE_ZONE("Broadphase::queryBoxes");
+
+    Jobs::parallelFor((count + QUERY_CHUNK - 1) / QUERY_CHUNK, [&](const int chunk) {
+        const int end = (chunk + 1) * QUERY_CHUNK < count ? (chunk + 1) * QUERY_CHUNK : count;
+        for (int q = chunk * QUERY_CHUNK; q < end; q++)
+            counts[q] = queryBox(boxes[q], out + long(q) * maxPerQuery, maxPerQuery);
+    });
+}
+
+void Broadphase::queryRadii(const int count, const vec3* centres, const float* radii, int* out, int* counts, const int maxPerQuery)
+{
+    TRACE_ZONE("Broadphase::queryRadii");
+
+    Jobs::parallelFor((count + QUERY_CHUNK - 1) / QUERY_CHUNK, [&](const int chunk) {
+        const int end = (chunk + 1) * QUERY_CHUNK < count ? (chunk + 1) * QUERY_CHUNK : count;
+        for (int q = chunk * QUERY_CHUNK; q < end; q++)
+            counts[q] = queryRadius(centres[q], radii[q], out + long(q) * maxPerQuery, maxPerQuery);
+    });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Collision.h"
+#include "Constants.h"
+
+// Which entities are near a point or a box, without testing every entity. Entities are
+// bucketed by the BROADPHASE_CELL^3 cube of the world their centre is in, so a query only
+// looks at the cubes around it. Rebuilt from scratch every tick, after Entities::update.
+// Answers are indices into the Entities arrays, good until entities next move or despawn
+namespace Broadphase
+{
+    constexpr int CELLS_X = WORLD_SIZE / BROADPHASE_CELL;
+    constexpr int CELLS_Y = WORLD_HEIGHT / BROADPHASE_CELL;
+    constexpr int CELLS_Z = WORLD_SIZE / BROADPHASE_CELL;
+
+    // bucket every entity, spread over the job system
+    void build();
+
+    // entities whose boxes overlap box. up to maxOut of them go in out, returns how many there are
+    int queryBox(const Collision::Box& box, int* out, int maxOut);
+
+    // entities whose boxes come within radius of centre, like queryBox
+    int queryRadius(const vec3& centre, float radius, int* out, int maxOut);
+
+    // queryBox for each of count boxes, spread over the job system. query i's answers go in
+    // out[i * maxPerQuery...] and how many there were in counts[i]
+    void queryBoxes(int count, const Collision::Box* boxes, int* out, int* counts, int maxPerQuery);
+
+    // queryRadius for each of count points, like queryBoxes
+    void queryRadii(int count, const vec3* centres, const float* radii, int* out, int* counts, int maxPerQuery);
+}
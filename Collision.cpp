@@ -0,0 +1,132 @@
+#include "Collision.h"
+
+#include "Constants.h"
+#include "Occupancy.h"
+
+static int floorInt(const float val)
+{
+    const int i = int(val);
+    return i - (val < float(i));
+}
+
+static int ceilInt(const float val)
+{
+    const int i = int(val);
+    return i + (val > float(i));
+}
+
+// any block in [x0, x1] x [y0, y1] x [z0, z1], including the walls and floor around the world?
+static bool solid(const int x0, int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    // open sky above the world
+    if (y1 < 0)
+        return false;
+    if (y0 < 0)
+        y0 = 0;
+
+    if (x0 < 0 || z0 < 0 || x1 >= WORLD_SIZE || y1 >= WORLD_HEIGHT || z1 >= WORLD_SIZE)
+        return true;
+
+    return Occupancy::any(x0, y0, z0, x1, y1, z1);
+}
+
+Collision::Hit Collision::sweep(const Box& box, const vec3& motion)
+{
+    const float min[3] = { box.min.x, box.min.y, box.min.z };
+    const float max[3] = { box.max.x, box.max.y, box.max.z };
+    const float move[3] = { motion.x, motion.y, motion.z };
+
+    int step[3];
+    int leadCell[3]; // the last layer of blocks the leading face is in
+    float next[3]; // time the leading face reaches the next block boundary
+    float delta[3]; // time between boundaries
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        step[axis] = move[axis] > 0 ? 1 : (move[axis] < 0 ? -1 : 0);
+
+        if (step[axis] == 0)
+        {
+            leadCell[axis] = 0;
+            next[axis] = 2; // never
+            delta[axis] = 0;
+            continue;
+        }
+
+        const float lead = step[axis] > 0 ? max[axis] : min[axis];
+        leadCell[axis] = step[axis] > 0 ? ceilInt(lead) - 1 : floorInt(lead);
+
+        const int boundary = step[axis] > 0 ? leadCell[axis] + 1 : leadCell[axis];
+        next[axis] = (boundary - lead) / move[axis];
+        delta[axis] = 1 / (move[axis] * step[axis]);
+    }
+
+    for (;;)
+    {
+        const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+        const float time = next[axis];
+
+        if (time > 1)
+            return { 1, -1, 0 };
+
+        // the leading face crosses into the next layer of blocks, check the part of it the box covers then
+        leadCell[axis] += step[axis];
+
+        int lo[3], hi[3];
+        for (int i = 0; i < 3; i++)
+        {
+            lo[i] = floorInt(min[i] + move[i] * time);
+            hi[i] = ceilInt(max[i] + move[i] * time) - 1;
+        }
+        lo[axis] = hi[axis] = leadCell[axis];
+
+        // include layers other axes crossed into at this same time, or a block touching just the corner slips through
+        for (int i = 0; i < 3; i++)
+        {
+            if (step[i] > 0 && leadCell[i] > hi[i])
+                hi[i] = leadCell[i];
+            else if (step[i] < 0 && leadCell[i] < lo[i])
+                lo[i] = leadCell[i];
+        }
+
+        if (solid(lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]))
+            return { time, axis, -step[axis] };
+
+        next[axis] += delta[axis];
+    }
+}
+
+int Collision::move(Box& box, const vec3& motion)
+{
+    float left[3] = { motion.x, motion.y, motion.z };
+    int blocked = 0;
+
+    // each hit blocks another axis, so three sweeps at most
+    for (int sweeps = 0; sweeps < 3; sweeps++)
+    {
+        const Hit hit = sweep(box, vec3(left[0], left[1], left[2]));
+
+        float moved[3] = { left[0] * hit.time, left[1] * hit.time, left[2] * hit.time };
+
+        if (hit.axis >= 0)
+        {
+            // stop SKIN short of the face, backing off if rounding already put us closer
+            moved[hit.axis] += hit.normal * SKIN;
+
+            blocked |= 1 << hit.axis;
+        }
+
+        const vec3 offset(moved[0], moved[1], moved[2]);
+        box.min += offset;
+        box.max += offset;
+
+        if (hit.axis < 0)
+            break;
+
+        for (int i = 0; i < 3; i++)
+            left[i] -= moved[i];
+        left[hit.axis] = 0;
+    }
+
+    return blocked;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "Vector.h"
+
+// Moving axis-aligned boxes through the world without letting them pass into blocks.
+// Blocks outside the world count as solid, except above it (y < 0, y is inverted) which is open
+namespace Collision
+{
+    // [min, max) on each axis
+    struct Box
+    {
+        vec3 min;
+        vec3 max;
+    };
+
+    // where a moving box first touches a block
+    struct Hit
+    {
+        float time; // fraction of the motion done before touching, 1 if nothing is in the way
+        int axis; // of the face it hit, -1 if nothing is in the way
+        int normal; // 1 or -1, which way that face points along axis
+    };
+
+    // boxes stop this far short of blocks, so rounding can never leave them inside one
+    constexpr float SKIN = 1.0f / 1024;
+
+    // sweep box along motion in one pass over the block boundaries its leading faces cross,
+    // like a raycast. Only checks the blocks it moves into, a box already inside blocks can move out
+    Hit sweep(const Box& box, const vec3& motion);
+
+    // move box by as much of motion as it can, sliding along what it hits.
+    // returns which axes were blocked, bit 1 << axis
+    int move(Box& box, const vec3& motion);
+}
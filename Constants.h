@@ -23,6 +23,14 @@ constexpr int RENDER_DIST = 80;
 
 constexpr int TEXTURE_RES = 16;
 
+// the block atlas, a column of top, side and bottom tiles for each of 16 blocks
+constexpr int ATLAS_WIDTH = TEXTURE_RES * 16;
+constexpr int ATLAS_HEIGHT = TEXTURE_RES * 3;
+
+// save the generated texture atlas here and load it on later launches with the same seed
+// and TEXTURE_RES. comment out to always generate
+#define TEXTURE_CACHE "textures.cache"
+
 #ifdef CLASSIC
 constexpr int WORLD_SIZE = 64;
 #else
@@ -30,6 +38,77 @@ constexpr int WORLD_SIZE = 512;
 #endif
 constexpr int WORLD_HEIGHT = 64;
 
+// rays skip BRICK_SIZE^3 bricks with no blocks in them in one step (BS in raytrace.comp)
+constexpr int BRICK_SIZE = 8;
+
+constexpr int BRICKS_X = WORLD_SIZE / BRICK_SIZE;
+constexpr int BRICKS_Y = WORLD_HEIGHT / BRICK_SIZE;
+constexpr int BRICKS_Z = WORLD_SIZE / BRICK_SIZE;
+
+// keep a distance field next to the world so rays can leap through open space in one step.
+// costs another byte per block. must match DF in raytrace.comp
+//#define DISTANCE_FIELD
+
+// distances are capped to this, a ray leaps at most DISTANCE_FIELD_MAX - 1 blocks at a time
+constexpr int DISTANCE_FIELD_MAX = 16;
+
+// store the world as palette-compressed 16^3 sections instead of a flat array.
+// several times less memory, at the cost of slower block access
+//#define CHUNKED_WORLD
+
+// memory order of the flat (non-chunked) world, see VoxelStorage.h.
+// LinearLayout, ColumnLayout, MortonLayout or TiledLayout
+#ifndef WORLD_LAYOUT
+#define WORLD_LAYOUT LinearLayout
+#endif
+
+// worldgen samples terrain noise every HEIGHTMAP_STEP blocks and interpolates the columns
+// in between. 1 samples every column
+constexpr int HEIGHTMAP_STEP = 4;
+
+// build in the CPU raytracer, picked at runtime with --cpu for machines without a GPU.
+// comment out to leave it out of the 4k build
+#define CPU_RENDERER
+
+// the most physics ticks a frame runs to catch up after a stall. any more are dropped, so a slow
+// machine plays slower instead of spending longer and longer frames catching up
+constexpr int MAX_TICKS_PER_FRAME = 5;
+
+// the most entities (see Entities.h) there can be at once. their arrays are allocated up front
+constexpr int MAX_ENTITIES = 1 << 17;
+
+// entities are bucketed by the BROADPHASE_CELL^3 cube they're in for Broadphase queries.
+// smaller cubes mean fewer entities to test per query but more cubes to look in
+constexpr int BROADPHASE_CELL = 4;
+
+// the most bytes of changed world a frame copies to the GPU, bigger edits get spread over
+// several frames. needs to fit a whole z slab of the world
+constexpr int UPLOAD_BUDGET = 1 << 18;
+
+// the most boxes a frame copies to the GPU, each is its own glTexSubImage3D. Scattered edits
+// come out a brick each
+constexpr int UPLOAD_PIECES = 128;
+
+// staging buffers the uploads rotate through, so a frame never waits on the GPU reading the last one
+constexpr int UPLOAD_RING_SIZE = 3;
+
+// run ticks on their own thread (see Simulation.h) instead of between frames.
+// comment out to do everything on the main thread
+#define SIM_THREAD
+
+// --record <file> saves each frame's mouse and keyboard input for replaying in the frame
+// benchmark, in a world made from RECORDING_SEED. comment out to leave it out of the 4k build
+#define INPUT_RECORDING
+constexpr uint64_t RECORDING_SEED = 18295169L;
+
+// record TRACE_ZONEs (see Trace.h) and write them to TRACE_FILE as a Chrome trace on exit
+// or when F9 is pressed. for profiling, leave it out of the 4k build
+//#define TRACING
+#define TRACE_FILE "trace.json"
+
+// zones kept per thread, older ones get overwritten
+constexpr int TRACE_RING_SIZE = 1 << 16;
+
 // END OF PERFORMANCE OPTIONS
 
 
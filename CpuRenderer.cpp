@@ -0,0 +1,395 @@
+#include "CpuRenderer.h"
+
+#include "DistanceField.h"
+#include "Jobs.h"
+#include "World.h"
+
+#include <SDL/SDL.h>
+#include <atomic>
+#include <cmath>
+
+// the same size as the compute shader's work groups
+constexpr int TILE_SIZE = WORK_GROUP_SIZE;
+
+// the atlas as 0-1 colors, the way the shader's sampler sees it
+static float atlasColors[ATLAS_WIDTH * ATLAS_HEIGHT][3];
+
+static uint32_t* frame = nullptr; // 0x00RRGGBB
+static int frameWidth = 0;
+static int frameHeight = 0;
+
+struct Color
+{
+    float r, g, b;
+};
+
+static Color mix(const Color& x, const Color& y, const float a)
+{
+    return { x.r + (y.r - x.r) * a, x.g + (y.g - x.g) * a, x.b + (y.b - x.b) * a };
+}
+
+static Color toColor(const vec3& v)
+{
+    return { v.x, v.y, v.z };
+}
+
+static int clampInt(const int val, const int min, const int max)
+{
+    return val < min ? min : (val > max ? max : val);
+}
+
+// GLSL's mod, floored rather than truncated
+static float floorMod(const float x, const float y)
+{
+    return x - y * floorf(x / y);
+}
+
+// where the ray crosses the next boundary of [min, max) on one axis
+static float boundaryDist(const int boundary, const float start, const float velocity, const int step)
+{
+    return step == 0 ? 1e9f : (boundary - start) / velocity;
+}
+
+static bool brickEmpty(const int x, const int y, const int z)
+{
+    // above the world is all air, like the shader's out of range image loads
+    return y < 0 || World::bricks[x / BRICK_SIZE + y / BRICK_SIZE * BRICKS_X + z / BRICK_SIZE * BRICKS_X * BRICKS_Y] == 0;
+}
+
+// rayMarch from raytrace.comp, line for line where it can be
+static Color rayMarch(const float start[3], const float velocity[3], const float maximum, const Color& fogColor,
+    const CpuRenderer::Uniforms& u, bool& hit, float hitPos[3], float& rayTravelDist)
+{
+    int ijk[3];
+    int ijkStep[3];
+    float vInverted[3];
+    float dist[3];
+
+    for (int a = 0; a < 3; a++)
+    {
+        ijk[a] = int(start[a]);
+        ijkStep[a] = (velocity[a] > 0) - (velocity[a] < 0);
+        vInverted[a] = fabsf(1 / velocity[a]);
+
+        // the shader gets NaN for a ray that never moves on this axis, which never wins a comparison either
+        dist[a] = ijkStep[a] == 0 ? 1e9f : ((ijkStep[a] > 0) - (start[a] - floorf(start[a])) * ijkStep[a]) * vInverted[a];
+    }
+
+    int axis = 0; // X
+
+    rayTravelDist = 0;
+
+    while (rayTravelDist <= maximum)
+    {
+        // Exit check. Above the world (y < 0) is air we can still come down from
+        if (ijk[0] < 0 || ijk[2] < 0 || ijk[0] >= WORLD_SIZE || ijk[1] >= WORLD_HEIGHT || ijk[2] >= WORLD_SIZE)
+            break;
+
+        // Above the whole terrain and not heading down (y is inverted), nothing left to hit
+        if (ijk[1] < World::terrainTop && ijkStep[1] <= 0)
+            break;
+
+#ifdef DISTANCE_FIELD
+        // Nothing within d - 1 blocks of here, leap that far along the ray
+        const int leap = ijk[1] < 0 ? -1 : DistanceField::get(ijk[0], ijk[1], ijk[2]) - 1;
+        if (leap > 0)
+        {
+            rayTravelDist += leap * fminf(vInverted[0], fminf(vInverted[1], vInverted[2]));
+
+            // clamped to the empty cube we just crossed, in case of rounding
+            for (int a = 0; a < 3; a++)
+            {
+                ijk[a] = clampInt(int(floorf(start[a] + velocity[a] * rayTravelDist)), ijk[a] - leap, ijk[a] + leap);
+                dist[a] = boundaryDist(ijk[a] + (ijkStep[a] > 0), start[a], velocity[a], ijkStep[a]);
+            }
+
+            continue;
+        }
+#endif
+
+        // Empty brick, jump straight to where the ray leaves it
+        if (brickEmpty(ijk[0], ijk[1], ijk[2]))
+        {
+            int brick[3];
+            float brickExit[3];
+            for (int a = 0; a < 3; a++)
+            {
+                brick[a] = ijk[a] & ~(BRICK_SIZE - 1);
+                brickExit[a] = boundaryDist(brick[a] + (ijkStep[a] > 0) * BRICK_SIZE, start[a], velocity[a], ijkStep[a]);
+            }
+
+            rayTravelDist = fminf(brickExit[0], fminf(brickExit[1], brickExit[2]));
+            axis = rayTravelDist == brickExit[0] ? 0 : (rayTravelDist == brickExit[1] ? 1 : 2);
+
+            // Land in the voxel we exit into, clamped to the brick on the other axes to stay safe from rounding
+            for (int a = 0; a < 3; a++)
+                ijk[a] = clampInt(int(floorf(start[a] + velocity[a] * rayTravelDist)), brick[a], brick[a] + BRICK_SIZE - 1);
+            ijk[axis] = brick[axis] + (ijkStep[axis] > 0 ? BRICK_SIZE : -1);
+
+            for (int a = 0; a < 3; a++)
+                dist[a] = boundaryDist(ijk[a] + (ijkStep[a] > 0), start[a], velocity[a], ijkStep[a]);
+
+            continue;
+        }
+
+        // Above the highest block in this column. If we're still above it where we leave the column,
+        // go straight to the next one
+        const int columnTop = World::columnTops[ijk[0] + ijk[2] * WORLD_SIZE];
+        if (ijk[1] < columnTop)
+        {
+            const int side = dist[0] < dist[2] ? 0 : 2;
+            const float exitY = start[1] + velocity[1] * dist[side];
+
+            if (exitY < columnTop)
+            {
+                rayTravelDist = dist[side];
+                axis = side;
+
+                ijk[side] += ijkStep[side];
+                dist[side] += vInverted[side];
+
+                // somewhere between where we were and the column top, or above the world
+                ijk[1] = clampInt(int(floorf(exitY)), ijkStep[1] > 0 ? ijk[1] : -1, ijkStep[1] > 0 ? columnTop - 1 : ijk[1]);
+                dist[1] = boundaryDist(ijk[1] + (ijkStep[1] > 0), start[1], velocity[1], ijkStep[1]);
+
+                continue;
+            }
+        }
+
+        const int blockHit = ijk[1] < 0 ? BLOCK_AIR : World::world.get(ijk[0], ijk[1], ijk[2]);
+
+        if (blockHit != BLOCK_AIR)
+        {
+            for (int a = 0; a < 3; a++)
+                hitPos[a] = start[a] + velocity[a] * rayTravelDist;
+
+            // side of block
+            int texFetchX = int(floorMod((hitPos[0] + hitPos[2]) * TEXTURE_RES, TEXTURE_RES));
+            int texFetchY = int(floorMod(hitPos[1] * TEXTURE_RES, TEXTURE_RES) + TEXTURE_RES);
+
+            if (axis == 1) // Y. we hit the top/bottom of block
+            {
+                texFetchX = int(floorMod(hitPos[0] * TEXTURE_RES, TEXTURE_RES));
+                texFetchY = int(floorMod(hitPos[2] * TEXTURE_RES, TEXTURE_RES));
+
+                if (velocity[1] < 0.0F) // looking at the underside of a block
+                    texFetchY += TEXTURE_RES * 2;
+            }
+
+            const float* texel = atlasColors[texFetchX + blockHit * TEXTURE_RES + texFetchY * ATLAS_WIDTH];
+            const Color textureColor = { texel[0], texel[1], texel[2] };
+
+            if (textureColor.r != 0 || textureColor.g != 0 || textureColor.b != 0) { // pixel is not transparent
+                hit = true;
+                for (int a = 0; a < 3; a++)
+                    hitPos[a] = start[a] + velocity[a] * (rayTravelDist - 0.01f);
+
+#ifdef CLASSIC
+                const float fogIntensity = ((rayTravelDist / RENDER_DIST)) * (0xFF - (axis + 2) % 3 * 50) / 0xFF;
+                return mix(textureColor, fogColor, fogIntensity);
+#else
+                const float light[3] = { u.lightDirection.x, u.lightDirection.y, u.lightDirection.z };
+                const float lightIntensity = 1 + (-float(ijkStep[axis]) * light[axis]) / 2.0f;
+
+                const Color lightColor = mix(toColor(u.ambColor), toColor(u.sunColor), lightIntensity);
+                return { textureColor.r * lightColor.r, textureColor.g * lightColor.g, textureColor.b * lightColor.b };
+#endif
+            }
+        }
+
+        // Determine the closest voxel boundary
+        if (dist[1] < dist[0])
+        {
+            if (dist[1] < dist[2])
+            {
+                ijk[1] += ijkStep[1];
+
+                rayTravelDist = dist[1];
+                dist[1] += vInverted[1];
+                axis = 1; // Y
+            }
+            else
+            {
+                ijk[2] += ijkStep[2];
+
+                rayTravelDist = dist[2];
+                dist[2] += vInverted[2];
+                axis = 2; // Z
+            }
+        }
+        else if (dist[0] < dist[2])
+        {
+            ijk[0] += ijkStep[0];
+
+            rayTravelDist = dist[0];
+            dist[0] += vInverted[0];
+            axis = 0; // X
+        }
+        else
+        {
+            ijk[2] += ijkStep[2];
+
+            rayTravelDist = dist[2];
+            dist[2] += vInverted[2];
+            axis = 2; // Z
+        }
+    }
+
+    hit = false;
+
+#ifdef CLASSIC
+    return { 0, 0, 0 };
+#else
+    return fogColor; // sky
+#endif
+}
+
+// getPixel from raytrace.comp. Counts the rays it traced into rays
+static Color getPixel(const int pixelX, const int pixelY, const CpuRenderer::Uniforms& u, long& rays)
+{
+    const float frustumRayX = (pixelX - 0.5f * frameWidth) / u.frustumDiv.x;
+    const float frustumRayY = (pixelY - 0.5f * frameHeight) / u.frustumDiv.y;
+
+    // rotate frustum space to world space
+    const float temp = u.cosPitch + frustumRayY * u.sinPitch;
+
+    float rayDir[3] = { frustumRayX * u.cosYaw + temp * u.sinYaw,
+                        frustumRayY * u.cosPitch - u.sinPitch,
+                        temp * u.cosYaw - frustumRayX * u.sinYaw };
+
+    const float length = sqrtf(rayDir[0] * rayDir[0] + rayDir[1] * rayDir[1] + rayDir[2] * rayDir[2]);
+    for (float& d : rayDir)
+        d /= length;
+
+    const float sunDot = rayDir[0] * u.lightDirection.x + rayDir[1] * u.lightDirection.y + rayDir[2] * u.lightDirection.z;
+    const float sunGlow = (sunDot < 0 ? 0 : (sunDot > 1 ? 1 : sunDot)) + 0.2f;
+    const Color fogColor = mix(toColor(u.skyColor), toColor(u.sunColor), 0.5f * sunGlow * sunGlow * sunGlow * sunGlow * sunGlow);
+
+    const float start[3] = { u.position.x, u.position.y, u.position.z };
+
+    // raymarch outputs
+    float hitPos[3];
+    bool hit;
+    float hitDist;
+    Color color = rayMarch(start, rayDir, RENDER_DIST, fogColor, u, hit, hitPos, hitDist);
+    rays++;
+
+#ifndef CLASSIC
+    if (hit)
+    {
+        const float light[3] = { u.lightDirection.x, u.lightDirection.y, u.lightDirection.z };
+
+        float shadowMult = (1 - light[1]) * 0.3f;
+
+        if (light[1] < 0) { // day
+            float ignoreHitDist = 0;
+            const float shadowStart[3] = { hitPos[0], hitPos[1], hitPos[2] };
+            rayMarch(shadowStart, light, RENDER_DIST / 2, fogColor, u, hit, hitPos, ignoreHitDist);
+            rays++;
+
+            if (hit) // we can't see the sun
+                shadowMult *= 1 + light[1] * 0.3f;
+        }
+
+        // apply shadow
+        color.r *= shadowMult;
+        color.g *= shadowMult;
+        color.b *= shadowMult;
+
+        if (hitDist > RENDER_DIST * 0.95f) {
+            const float fogIntensity = ((hitDist - RENDER_DIST * 0.95f) / (RENDER_DIST * 0.05f));
+
+            color = mix(color, fogColor, fogIntensity);
+        }
+    }
+#endif
+
+    return color;
+}
+
+static uint32_t toPixel(const float c)
+{
+    return c <= 0 ? 0 : (c >= 1 ? 255 : uint32_t(c * 255 + 0.5f));
+}
+
+void CpuRenderer::init(const int* textureAtlas)
+{
+    for (int i = 0; i < ATLAS_WIDTH * ATLAS_HEIGHT; i++)
+    {
+        atlasColors[i][0] = float(textureAtlas[i] >> 16 & 0xFF) / 255.0f;
+        atlasColors[i][1] = float(textureAtlas[i] >> 8 & 0xFF) / 255.0f;
+        atlasColors[i][2] = float(textureAtlas[i] & 0xFF) / 255.0f;
+    }
+}
+
+long CpuRenderer::render(const Uniforms& uniforms, const int width, const int height)
+{
+    if (width != frameWidth || height != frameHeight)
+    {
+        delete[] frame;
+        frame = new uint32_t[width * height];
+        frameWidth = width;
+        frameHeight = height;
+    }
+
+    const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    std::atomic<long> rays{0};
+
+    // a row of tiles at a time, letting go of the world in between so an edit only waits for
+    // the row being traced and not the whole frame. Not from inside the jobs: an edit can
+    // hand out jobs of its own while it holds the lock
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        World::lockEdits();
+
+        // the job system hands tiles out one at a time, whoever's free takes the next one
+        Jobs::parallelFor(tilesX, [&](const int tileX) {
+            const int x0 = tileX * TILE_SIZE;
+            const int y0 = tileY * TILE_SIZE;
+            const int x1 = x0 + TILE_SIZE < width ? x0 + TILE_SIZE : width;
+            const int y1 = y0 + TILE_SIZE < height ? y0 + TILE_SIZE : height;
+
+            long tileRays = 0;
+
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x++)
+                {
+                    const Color color = getPixel(x, y, uniforms, tileRays);
+                    frame[x + y * width] = toPixel(color.r) << 16 | toPixel(color.g) << 8 | toPixel(color.b);
+                }
+            }
+
+            rays += tileRays;
+        });
+
+        World::unlockEdits();
+    }
+
+    return rays;
+}
+
+void CpuRenderer::present(SDL_Surface* surface)
+{
+    if (SDL_MUSTLOCK(surface))
+        SDL_LockSurface(surface);
+
+    const SDL_PixelFormat* format = surface->format;
+
+    // nearest neighbour, like the GL path's screen texture
+    Jobs::parallelFor(surface->h, [&](const int y) {
+        uint32_t* row = (uint32_t*)((uint8_t*)surface->pixels + y * surface->pitch);
+        const uint32_t* frameRow = frame + y * frameHeight / surface->h * frameWidth;
+
+        for (int x = 0; x < surface->w; x++)
+        {
+            const uint32_t pixel = frameRow[x * frameWidth / surface->w];
+            row[x] = (pixel >> 16 & 0xFF) << format->Rshift | (pixel >> 8 & 0xFF) << format->Gshift | (pixel & 0xFF) << format->Bshift;
+        }
+    });
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Constants.h"
+#include "Vector.h"
+
+struct SDL_Surface;
+
+// raytrace.comp ported to C++, for machines without a GPU. Traces a 16x16 tile at a time
+// on the Jobs threads and presents through an SDL software surface
+namespace CpuRenderer
+{
+    // the compute shader's uniforms
+    struct Uniforms
+    {
+        vec3 position; // c.P
+        float cosYaw, cosPitch; // c.cY, c.cP
+        float sinYaw, sinPitch; // c.sY, c.sP
+        vec2 frustumDiv; // c.fD
+
+        vec3 lightDirection; // l
+        vec3 skyColor; // k
+        vec3 ambColor; // a
+        vec3 sunColor; // s
+    };
+
+    // copy the atlas (as loadTextureAtlas makes it) for texturing
+    void init(const int* textureAtlas);
+
+    // trace a width x height frame into the framebuffer, returns how many rays that took.
+    // Holds World::lockEdits a row of tiles at a time
+    long render(const Uniforms& uniforms, int width, int height);
+
+    // stretch the last frame over the surface
+    void present(SDL_Surface* surface);
+}
@@ -0,0 +1,212 @@
+#include "DirtyRegions.h"
+
+static DirtyRegion bounds(const DirtyRegion& a, const DirtyRegion& b)
+{
+    return {
+        a.x0 < b.x0 ? a.x0 : b.x0, a.y0 < b.y0 ? a.y0 : b.y0, a.z0 < b.z0 ? a.z0 : b.z0,
+        a.x1 > b.x1 ? a.x1 : b.x1, a.y1 > b.y1 ? a.y1 : b.y1, a.z1 > b.z1 ? a.z1 : b.z1,
+    };
+}
+
+static bool contains(const DirtyRegion& outer, const DirtyRegion& inner)
+{
+    return inner.x0 >= outer.x0 && inner.y0 >= outer.y0 && inner.z0 >= outer.z0 &&
+           inner.x1 <= outer.x1 && inner.y1 <= outer.y1 && inner.z1 <= outer.z1;
+}
+
+static bool intersects(const DirtyRegion& a, const DirtyRegion& b)
+{
+    return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1 && a.z0 < b.z1 && b.z0 < a.z1;
+}
+
+static short clampShort(const int val, const int max)
+{
+    return short(val < 0 ? 0 : (val > max ? max : val));
+}
+
+// blocks the box around a and b covers that neither of them does
+static int waste(const DirtyRegion& a, const DirtyRegion& b)
+{
+    return bounds(a, b).volume() - a.volume() - b.volume();
+}
+
+// region rounded out to whole bricks
+static DirtyRegion brickBounds(const DirtyRegion& region)
+{
+    return {
+        short(region.x0 / BRICK_SIZE), short(region.y0 / BRICK_SIZE), short(region.z0 / BRICK_SIZE),
+        short((region.x1 + BRICK_SIZE - 1) / BRICK_SIZE), short((region.y1 + BRICK_SIZE - 1) / BRICK_SIZE), short((region.z1 + BRICK_SIZE - 1) / BRICK_SIZE),
+    };
+}
+
+static bool hasBrick(const uint64_t* bricks, const int i)
+{
+    return bricks[i / 64] >> (i % 64) & 1;
+}
+
+// f on the index of each brick region touches
+template<typename F>
+static void forBricks(const DirtyRegion& region, const F& f)
+{
+    const DirtyRegion b = brickBounds(region);
+
+    for (int bz = b.z0; bz < b.z1; bz++)
+        for (int by = b.y0; by < b.y1; by++)
+            for (int bx = b.x0; bx < b.x1; bx++)
+                f(bx + by * BRICKS_X + bz * BRICKS_X * BRICKS_Y);
+}
+
+void DirtyRegions::add(DirtyRegion region)
+{
+    region = {
+        clampShort(region.x0, WORLD_SIZE), clampShort(region.y0, WORLD_HEIGHT), clampShort(region.z0, WORLD_SIZE),
+        clampShort(region.x1, WORLD_SIZE), clampShort(region.y1, WORLD_HEIGHT), clampShort(region.z1, WORLD_SIZE),
+    };
+
+    if (region.x0 >= region.x1 || region.y0 >= region.y1 || region.z0 >= region.z1)
+        return;
+
+    // already covered, the usual case for digging about in one spot
+    for (int i = 0; i < count; i++)
+        if (contains(regions[i], region))
+            return;
+
+    if (brickCount > 0)
+    {
+        bool marked = true;
+        forBricks(region, [&](const int i) { marked = marked && hasBrick(bricks, i); });
+        if (marked)
+            return;
+    }
+
+    absorb(region);
+
+    // no room, make some by merging the two boxes that cost the least blocks to. The merged box
+    // can reach the new one, so that takes another look around
+    while (count == DIRTY_REGION_MAX)
+    {
+        int bestA = 0, bestB = 1;
+        int bestWaste = waste(regions[0], regions[1]);
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = a + 1; b < count; b++)
+            {
+                const int w = waste(regions[a], regions[b]);
+                if (w < bestWaste)
+                {
+                    bestA = a;
+                    bestB = b;
+                    bestWaste = w;
+                }
+            }
+        }
+
+        // unless the edit's own bricks cover fewer, like they do when the edits are all over the place
+        const DirtyRegion b = brickBounds(region);
+        if ((b.x1 - b.x0) * (b.y1 - b.y0) * (b.z1 - b.z0) * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE - region.volume() <= bestWaste)
+        {
+            forBricks(region, [&](const int i) {
+                brickCount += !hasBrick(bricks, i);
+                bricks[i / 64] |= uint64_t(1) << (i % 64);
+            });
+            return;
+        }
+
+        DirtyRegion merged = bounds(regions[bestA], regions[bestB]);
+        remove(bestB); // the higher one first, remove moves the last box into its slot
+        remove(bestA);
+
+        absorb(merged);
+        regions[count++] = merged;
+
+        absorb(region);
+    }
+
+    regions[count++] = region;
+}
+
+void DirtyRegions::merge(const DirtyRegions& other)
+{
+    for (int i = 0; i < other.count; i++)
+        add(other.regions[i]);
+
+    for (int i = 0; i < DIRTY_BRICK_WORDS && other.brickCount > 0; i++)
+    {
+        for (uint64_t fresh = other.bricks[i] & ~bricks[i]; fresh != 0; fresh &= fresh - 1)
+            brickCount++;
+
+        bricks[i] |= other.bricks[i];
+    }
+}
+
+void DirtyRegions::absorb(DirtyRegion& region)
+{
+    // every merge makes the box bigger, which can bring it onto or close to boxes it wasn't before.
+    // Overlapping boxes would upload the same blocks twice, so those are merged however far apart
+    for (int i = 0; i < count; i++)
+    {
+        if (intersects(regions[i], region) || waste(regions[i], region) <= DIRTY_MERGE_SLACK)
+        {
+            region = bounds(regions[i], region);
+            remove(i);
+            i = -1;
+        }
+    }
+}
+
+bool DirtyRegions::takeBricks(const int budget, DirtyRegion& piece)
+{
+    const int most = budget / (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE);
+
+    for (int word = 0; word < DIRTY_BRICK_WORDS && brickCount > 0 && most > 0; word++)
+    {
+        if (bricks[word] == 0)
+            continue;
+
+        int first = word * 64;
+        while (!hasBrick(bricks, first))
+            first++;
+
+        const int bx = first % BRICKS_X, by = first / BRICKS_X % BRICKS_Y, bz = first / (BRICKS_X * BRICKS_Y);
+
+        // along the row as far as the marked bricks and the budget go
+        int run = 0;
+        while (bx + run < BRICKS_X && run < most && hasBrick(bricks, first + run))
+        {
+            bricks[(first + run) / 64] &= ~(uint64_t(1) << ((first + run) % 64));
+            run++;
+        }
+        brickCount -= run;
+
+        piece = {
+            short(bx * BRICK_SIZE), short(by * BRICK_SIZE), short(bz * BRICK_SIZE),
+            short((bx + run) * BRICK_SIZE), short((by + 1) * BRICK_SIZE), short((bz + 1) * BRICK_SIZE),
+        };
+        return true;
+    }
+
+    return false;
+}
+
+void DirtyRegions::remove(const int i)
+{
+    regions[i] = regions[--count];
+}
+
+bool takeSlabs(DirtyRegion& region, const int budget, DirtyRegion& piece)
+{
+    const int slab = (region.x1 - region.x0) * (region.y1 - region.y0);
+
+    int slabs = budget / slab;
+    if (slabs == 0)
+        return false;
+
+    if (slabs > region.z1 - region.z0)
+        slabs = region.z1 - region.z0;
+
+    piece = region;
+    piece.z1 = short(region.z0 + slabs);
+    region.z0 = piece.z1;
+
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "Constants.h"
+
+// Boxes of the world that changed and still need copying to the GPU. Edits close together are
+// merged into one box, so a frame's worth of digging comes out as a handful of uploads
+
+// the most boxes kept, past this the closest ones get merged even if it covers unchanged blocks,
+// or the edit is kept as the bricks it touches if that covers fewer
+constexpr int DIRTY_REGION_MAX = 32;
+
+// a bit per brick, for the edits that didn't fit in the boxes
+constexpr int DIRTY_BRICK_WORDS = BRICKS_X * BRICKS_Y * BRICKS_Z / 64;
+
+static_assert(BRICKS_X * BRICKS_Y * BRICKS_Z % 64 == 0, "dirty bricks come in 64 bit words");
+
+// two boxes are merged if their bounding box has at most this many blocks neither covers
+constexpr int DIRTY_MERGE_SLACK = 64;
+
+static_assert(UPLOAD_BUDGET >= WORLD_SIZE * WORLD_HEIGHT, "takeSlabs needs a whole slab of the world to fit in UPLOAD_BUDGET");
+
+// [x0, x1) x [y0, y1) x [z0, z1)
+struct DirtyRegion
+{
+    short x0, y0, z0;
+    short x1, y1, z1;
+
+    int volume() const
+    {
+        return (x1 - x0) * (y1 - y0) * (z1 - z0);
+    }
+};
+
+struct DirtyRegions
+{
+    DirtyRegion regions[DIRTY_REGION_MAX];
+    int count = 0;
+
+    // ordered like World::bricks. Scattered edits come out a brick each instead of a few boxes
+    // around most of the world
+    uint64_t bricks[DIRTY_BRICK_WORDS] = {};
+    int brickCount = 0;
+
+    // clamped to the world, merged with whatever it's close to
+    void add(DirtyRegion region);
+
+    // everything other has
+    void merge(const DirtyRegions& other);
+
+    void remove(int i);
+
+    // take out the boxes region overlaps or is close to, growing it around them
+    void absorb(DirtyRegion& region);
+
+    // move the first run of marked bricks along x into piece, as many as fit in budget bytes.
+    // false if there are none or not even one fits
+    bool takeBricks(int budget, DirtyRegion& piece);
+
+    bool empty() const
+    {
+        return count == 0 && brickCount == 0;
+    }
+
+    void clear()
+    {
+        count = 0;
+
+        if (brickCount > 0)
+        {
+            for (int i = 0; i < DIRTY_BRICK_WORDS; i++)
+                bricks[i] = 0;
+            brickCount = 0;
+        }
+    }
+
+    // f on each box, then on the box of each marked brick
+    template<typename F>
+    void forEach(const F& f) const
+    {
+        for (int i = 0; i < count; i++)
+            f(regions[i]);
+
+        for (int i = 0; i < DIRTY_BRICK_WORDS * 64 && brickCount > 0; i++)
+        {
+            if ((bricks[i / 64] >> (i % 64) & 1) == 0)
+                continue;
+
+            const short x = short(i % BRICKS_X * BRICK_SIZE);
+            const short y = short(i / BRICKS_X % BRICKS_Y * BRICK_SIZE);
+            const short z = short(i / (BRICKS_X * BRICKS_Y) * BRICK_SIZE);
+            f(DirtyRegion{ x, y, z, short(x + BRICK_SIZE), short(y + BRICK_SIZE), short(z + BRICK_SIZE) });
+        }
+    }
+};
+
+// move as many whole z slabs of region as fit in budget bytes (a byte per block) into piece.
+// false if not even one does
+bool takeSlabs(DirtyRegion& region, int budget, DirtyRegion& piece);
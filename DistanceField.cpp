@@ -0,0 +1,151 @@
+#include "DistanceField.h"
+
+#include "Jobs.h"
+#include "World.h"
+
+uint8_t* DistanceField::distances = nullptr;
+
+static bool ready = false;
+
+// solid blocks further than this don't change a block's (capped) distance
+constexpr int REACH = DISTANCE_FIELD_MAX - 1;
+
+static int minInt(const int a, const int b)
+{
+    return a < b ? a : b;
+}
+
+static int maxInt(const int a, const int b)
+{
+    return a > b ? a : b;
+}
+
+// min over j of max(line[j], |i - j|), looking no further than the best distance found so far
+static int combine(const uint8_t* line, const int stride, const int length, const int i)
+{
+    int best = line[i * stride];
+
+    for (int r = 1; r < best; r++)
+    {
+        if (i - r >= 0)
+            best = minInt(best, maxInt(line[(i - r) * stride], r));
+        if (i + r < length)
+            best = minInt(best, maxInt(line[(i + r) * stride], r));
+    }
+
+    return best;
+}
+
+// exact distances for the blocks in [x0, x1) x [y0, y1) x [z0, z1).
+// The cube metric is separable, so this does one pass per axis over the box plus a REACH margin
+static void computeBox(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    const int hx0 = maxInt(x0 - REACH, 0), hx1 = minInt(x1 + REACH, WORLD_SIZE);
+    const int hy0 = maxInt(y0 - REACH, 0), hy1 = minInt(y1 + REACH, WORLD_HEIGHT);
+    const int hz0 = maxInt(z0 - REACH, 0), hz1 = minInt(z1 + REACH, WORLD_SIZE);
+
+    const int width = hx1 - hx0;
+    const int height = hy1 - hy0;
+    const int depth = hz1 - hz0;
+
+    uint8_t* alongX = new uint8_t[width * height * depth];
+    uint8_t* alongXY = new uint8_t[width * height * depth];
+
+    // distance to the nearest solid block in the same row
+    Jobs::parallelFor(depth, [&](const int z) {
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t* row = alongX + y * width + z * width * height;
+
+            int dist = DISTANCE_FIELD_MAX;
+            for (int x = 0; x < width; x++)
+            {
+                dist = World::world.get(hx0 + x, hy0 + y, hz0 + z) != BLOCK_AIR ? 0 : minInt(dist + 1, DISTANCE_FIELD_MAX);
+                row[x] = dist;
+            }
+
+            dist = DISTANCE_FIELD_MAX;
+            for (int x = width - 1; x >= 0; x--)
+            {
+                dist = row[x] == 0 ? 0 : minInt(dist + 1, DISTANCE_FIELD_MAX);
+                row[x] = minInt(row[x], dist);
+            }
+        }
+    });
+
+    // in the same xy plane
+    Jobs::parallelFor(depth, [&](const int z) {
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const int offset = x + z * width * height;
+                alongXY[offset + y * width] = combine(alongX + offset, width, height, y);
+            }
+        }
+    });
+
+    // and finally across planes, only for the blocks we were asked for
+    Jobs::parallelFor(y1 - y0, [&](const int yi) {
+        const int y = y0 + yi;
+
+        for (int z = z0; z < z1; z++)
+        {
+            for (int x = x0; x < x1; x++)
+            {
+                const int offset = (x - hx0) + (y - hy0) * width;
+                DistanceField::distances[x + y * WORLD_SIZE + z * WORLD_SIZE * WORLD_HEIGHT] =
+                    combine(alongXY + offset, width * height, depth, z - hz0);
+            }
+        }
+    });
+
+    delete[] alongX;
+    delete[] alongXY;
+}
+
+void DistanceField::build()
+{
+    if (!distances)
+        distances = new uint8_t[WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE];
+
+    computeBox(0, 0, 0, WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE);
+
+    ready = true;
+}
+
+void DistanceField::invalidate()
+{
+    ready = false;
+}
+
+void DistanceField::update(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    if (!ready)
+        return;
+
+    computeBox(maxInt(x0 - REACH, 0), maxInt(y0 - REACH, 0), maxInt(z0 - REACH, 0),
+        minInt(x1 + REACH, WORLD_SIZE), minInt(y1 + REACH, WORLD_HEIGHT), minInt(z1 + REACH, WORLD_SIZE));
+}
+
+void DistanceField::addSolid(const int x, const int y, const int z)
+{
+    if (!ready)
+        return;
+
+    // distances can only shrink, to at most the distance to this block
+    for (int bz = maxInt(z - REACH, 0); bz < minInt(z + REACH + 1, WORLD_SIZE); bz++)
+    {
+        for (int by = maxInt(y - REACH, 0); by < minInt(y + REACH + 1, WORLD_HEIGHT); by++)
+        {
+            for (int bx = maxInt(x - REACH, 0); bx < minInt(x + REACH + 1, WORLD_SIZE); bx++)
+            {
+                const int dist = maxInt(maxInt(bx > x ? bx - x : x - bx, by > y ? by - y : y - by), bz > z ? bz - z : z - bz);
+
+                uint8_t& stored = distances[bx + by * WORLD_SIZE + bz * WORLD_SIZE * WORLD_HEIGHT];
+                if (dist < stored)
+                    stored = dist;
+            }
+        }
+    }
+}
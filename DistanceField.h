@@ -0,0 +1,28 @@
+#pragma once
+#include "Constants.h"
+
+// Chebyshev distance from every block to the nearest non-air block, capped at DISTANCE_FIELD_MAX.
+// Everything closer than a block's distance is air, so a ray in a block with distance d
+// can move d - 1 blocks along its longest axis without missing anything
+namespace DistanceField
+{
+    // ordered like the world texture, null until the first build()
+    extern uint8_t* distances;
+
+    inline uint8_t get(const int x, const int y, const int z)
+    {
+        return distances[x + y * WORLD_SIZE + z * WORLD_SIZE * WORLD_HEIGHT];
+    }
+
+    // whole world, spread over the job system
+    void build();
+
+    // stop updating until the next build(), e.g. while the world is being generated
+    void invalidate();
+
+    // recompute the distances around the blocks in [x0, x1) x [y0, y1) x [z0, z1) after they changed
+    void update(int x0, int y0, int z0, int x1, int y1, int z1);
+
+    // cheaper update for a single block that went from air to solid
+    void addSolid(int x, int y, int z);
+}
@@ -0,0 +1,179 @@
+#include "Entities.h"
+
+#include "Collision.h"
+#include "Jobs.h"
+#include "Trace.h"
+
+// entities per job
+constexpr int UPDATE_CHUNK = 1024;
+
+// the player's
+constexpr float DAMPING_XZ = 0.5f;
+constexpr float DAMPING_Y = 0.99f;
+constexpr float GRAVITY = 0.003f;
+
+float* Entities::posX = new float[MAX_ENTITIES];
+float* Entities::posY = new float[MAX_ENTITIES];
+float* Entities::posZ = new float[MAX_ENTITIES];
+float* Entities::velX = new float[MAX_ENTITIES];
+float* Entities::velY = new float[MAX_ENTITIES];
+float* Entities::velZ = new float[MAX_ENTITIES];
+float* Entities::halfX = new float[MAX_ENTITIES];
+float* Entities::halfY = new float[MAX_ENTITIES];
+float* Entities::halfZ = new float[MAX_ENTITIES];
+uint8_t* Entities::flags = new uint8_t[MAX_ENTITIES];
+
+// which slot each entity is in, and which entity each slot holds (-1 if none)
+static unsigned int* slotOf = new unsigned int[MAX_ENTITIES];
+static int* entityIn = new int[MAX_ENTITIES];
+static unsigned int* generations = new unsigned int[MAX_ENTITIES]();
+
+// slots that held entities before, reused first. slots from usedSlots on have never been used
+static unsigned int* freeSlots = new unsigned int[MAX_ENTITIES];
+static int freeSlotCount = 0;
+static unsigned int usedSlots = 0;
+
+static int entityCount = 0;
+
+int Entities::count()
+{
+    return entityCount;
+}
+
+Entities::Handle Entities::spawn(const vec3& pos, const vec3& halfSize, const uint8_t entityFlags)
+{
+    if (entityCount == MAX_ENTITIES)
+        return { (unsigned int)MAX_ENTITIES, 0 };
+
+    const unsigned int slot = freeSlotCount > 0 ? freeSlots[--freeSlotCount] : usedSlots++;
+
+    const int i = entityCount++;
+    posX[i] = pos.x;
+    posY[i] = pos.y;
+    posZ[i] = pos.z;
+    velX[i] = velY[i] = velZ[i] = 0;
+    halfX[i] = halfSize.x;
+    halfY[i] = halfSize.y;
+    halfZ[i] = halfSize.z;
+    flags[i] = entityFlags;
+
+    slotOf[i] = slot;
+    entityIn[slot] = i;
+
+    return { slot, generations[slot] };
+}
+
+void Entities::despawn(const Handle entity)
+{
+    const int i = indexOf(entity);
+    if (i < 0)
+        return;
+
+    // fill the gap with the last entity
+    const int last = --entityCount;
+    posX[i] = posX[last];
+    posY[i] = posY[last];
+    posZ[i] = posZ[last];
+    velX[i] = velX[last];
+    velY[i] = velY[last];
+    velZ[i] = velZ[last];
+    halfX[i] = halfX[last];
+    halfY[i] = halfY[last];
+    halfZ[i] = halfZ[last];
+    flags[i] = flags[last];
+
+    slotOf[i] = slotOf[last];
+    entityIn[slotOf[i]] = i;
+
+    entityIn[entity.slot] = -1;
+    generations[entity.slot]++;
+    freeSlots[freeSlotCount++] = entity.slot;
+}
+
+bool Entities::alive(const Handle entity)
+{
+    return indexOf(entity) >= 0;
+}
+
+int Entities::indexOf(const Handle entity)
+{
+    if (entity.slot >= usedSlots || generations[entity.slot] != entity.generation)
+        return -1;
+
+    return entityIn[entity.slot];
+}
+
+void Entities::clear()
+{
+    for (int i = 0; i < entityCount; i++)
+    {
+        entityIn[slotOf[i]] = -1;
+        generations[slotOf[i]]++;
+        freeSlots[freeSlotCount++] = slotOf[i];
+    }
+
+    entityCount = 0;
+}
+
+// damping and gravity for [begin, end). no branches, so it vectorises
+static void accelerate(const int begin, const int end)
+{
+    using namespace Entities;
+
+    for (int i = begin; i < end; i++)
+    {
+        velX[i] *= DAMPING_XZ;
+        velY[i] = velY[i] * DAMPING_Y + GRAVITY * (flags[i] & ENTITY_GRAVITY);
+        velZ[i] *= DAMPING_XZ;
+    }
+}
+
+// move [begin, end) by their velocities, stopping the ones that collide at blocks
+static void move(const int begin, const int end)
+{
+    using namespace Entities;
+
+    for (int i = begin; i < end; i++)
+    {
+        if (!(flags[i] & ENTITY_COLLIDES))
+        {
+            posX[i] += velX[i];
+            posY[i] += velY[i];
+            posZ[i] += velZ[i];
+            continue;
+        }
+
+        const vec3 half(halfX[i], halfY[i], halfZ[i]);
+        const vec3 pos(posX[i], posY[i], posZ[i]);
+
+        Collision::Box box = { pos - half, pos + half };
+        const int blocked = Collision::move(box, vec3(velX[i], velY[i], velZ[i]));
+
+        posX[i] = box.min.x + half.x;
+        posY[i] = box.min.y + half.y;
+        posZ[i] = box.min.z + half.z;
+
+        const bool landed = (blocked & 2) && velY[i] > 0;
+        flags[i] = (flags[i] & ~ENTITY_ON_GROUND) | (landed ? ENTITY_ON_GROUND : 0);
+
+        if (blocked & 1)
+            velX[i] = 0;
+        if (blocked & 2)
+            velY[i] = 0;
+        if (blocked & 4)
+            velZ[i] = 0;
+    }
+}
+
+void Entities::update()
+{
+    TRACE_ZONE("Entities::update");
+
+    Jobs::parallelFor((entityCount + UPDATE_CHUNK - 1) / UPDATE_CHUNK, [](const int chunk) {
+        const int begin = chunk * UPDATE_CHUNK;
+        const int end = begin + UPDATE_CHUNK < entityCount ? begin + UPDATE_CHUNK : entityCount;
+
+        accelerate(begin, end);
+        move(begin, end);
+    });
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Constants.h"
+#include "Vector.h"
+
+// Bodies other than the player, up to MAX_ENTITIES of them. Stored as structure of arrays, packed
+// into [0, count()) so a tick is a few straight passes over them, split across the job system.
+// Slots get reused, so entities are referred to by Handles that go stale when theirs is despawned
+namespace Entities
+{
+    // fall like the player does
+    constexpr uint8_t ENTITY_GRAVITY = 1;
+    // stop at blocks, otherwise move straight through them
+    constexpr uint8_t ENTITY_COLLIDES = 2;
+    // set by update() if the entity was stopped falling (y is inverted) in the last tick
+    constexpr uint8_t ENTITY_ON_GROUND = 4;
+
+    struct Handle
+    {
+        unsigned int slot;
+        unsigned int generation; // how many times slot had been despawned when this was spawned
+    };
+
+    // entity i of count(), in no particular order. despawn moves the last one into the gap
+    extern float* posX;
+    extern float* posY;
+    extern float* posZ;
+    extern float* velX;
+    extern float* velY;
+    extern float* velZ;
+    extern float* halfX; // half the size of the box around pos
+    extern float* halfY;
+    extern float* halfZ;
+    extern uint8_t* flags;
+
+    int count();
+
+    // a new entity with its box centred on pos, an invalid handle (never alive) if all MAX_ENTITIES are in use
+    Handle spawn(const vec3& pos, const vec3& halfSize, uint8_t entityFlags);
+
+    // does nothing if it's already gone
+    void despawn(Handle entity);
+
+    bool alive(Handle entity);
+
+    // where the entity is in the arrays, -1 if it's gone. changes when others despawn
+    int indexOf(Handle entity);
+
+    // despawn everything, all handles go stale
+    void clear();
+
+    // one TICK_LENGTH step of every entity: damping, gravity and moving through the world
+    void update();
+}
@@ -0,0 +1,312 @@
+#include "Game.h"
+
+#include "Broadphase.h"
+#include "Entities.h"
+#include "Player.h"
+#include "Trace.h"
+#include "Util.h"
+#include "World.h"
+
+#include <atomic>
+#include <cmath>
+
+constexpr float START_YAW = 0.01f; // make it not axis aligned by default to avoid raymarching error
+constexpr float START_PITCH = -2.0f * PI;
+
+float cameraYaw = START_YAW;
+float cameraPitch = START_PITCH;
+
+float sinYaw, sinPitch;
+float cosYaw, cosPitch;
+
+vec3 renderPos;
+
+TickState lastTicks;
+
+long tickOverruns = 0;
+long droppedTicks = 0;
+
+const uint8_t hotbar[HOTBAR_SIZE] = { BLOCK_GRASS, BLOCK_DEFAULT_DIRT, BLOCK_STONE, BLOCK_BRICKS, BLOCK_WOOD, BLOCK_LEAVES };
+
+BlockPick pick;
+
+// a ring of edits from queueEdit to the ticks. Each side only writes its own counter
+static World::BlockEdit editQueue[EDIT_QUEUE_SIZE];
+static std::atomic<unsigned int> editsQueued{0};
+static std::atomic<unsigned int> editsTaken{0};
+
+// what the buttons were last pickBlocks and when it last queued an edit
+static uint8_t lastButtons = 0;
+static float lastEditTime = 0;
+
+vec3 lightDirection = vec3(0.866025404f, -0.866025404f, 0.866025404f);
+
+vec3 ambColor;
+vec3 skyColor;
+vec3 sunColor;
+
+static vec3 lerp(const vec3& start, const vec3& end, const float t)
+{
+    return start + (end - start) * t;
+}
+
+void resetGame()
+{
+    cameraYaw = START_YAW;
+    cameraPitch = START_PITCH;
+
+    playerPos = PLAYER_SPAWN;
+    playerVelocity = vec3(0);
+    controller = {};
+
+    resetEdits();
+}
+
+void resetEdits()
+{
+    editsQueued.store(0, std::memory_order_relaxed);
+    editsTaken.store(0, std::memory_order_relaxed);
+
+    lastButtons = 0;
+    lastEditTime = 0;
+}
+
+void turnCamera(const InputFrame& input)
+{
+    cameraYaw += input.mouseX / 500.0f;
+    cameraPitch -= input.mouseY / 500.0f;
+
+    if(abs(cameraYaw) > PI)
+    {
+        if (cameraYaw > 0)
+            cameraYaw = -PI - (cameraYaw - PI);
+        else
+            cameraYaw = PI + (cameraYaw + PI);
+    }
+    cameraPitch = clamp(cameraPitch, -PI / 2.0f, PI / 2.0f);
+
+    sinYaw = sin(cameraYaw);
+    cosYaw = cos(cameraYaw);
+    sinPitch = sin(cameraPitch);
+    cosPitch = cos(cameraPitch);
+}
+
+void setController(const uint8_t keys, const float yaw)
+{
+    controller.reset();
+
+    if (keys & KEY_FORWARD)
+        controller.forward += 1.0f;
+    if (keys & KEY_BACK)
+        controller.forward -= 1.0f;
+    if (keys & KEY_RIGHT)
+        controller.right += 1.0f;
+    if (keys & KEY_LEFT)
+        controller.right -= 1.0f;
+    if (keys & KEY_JUMP)
+        controller.jump = true;
+
+    controller.sinYaw = sin(yaw);
+    controller.cosYaw = cos(yaw);
+}
+
+void applyInput(const InputFrame& input)
+{
+    turnCamera(input);
+    setController(input.keys, cameraYaw);
+}
+
+void pickBlocks(const InputFrame& input, const vec3& eye, const float frameTime)
+{
+    TRACE_ZONE("pickBlocks");
+
+    // the middle of the screen
+    const vec3 dir(cosPitch * sinYaw, -sinPitch, cosPitch * cosYaw);
+
+    int axis = -1;
+    int coords[3];
+    World::raycast(eye, dir, PLAYER_REACH, axis, nullptr, coords);
+
+    pick.hit = axis >= 0;
+    if (pick.hit)
+    {
+        pick.x = pick.placeX = coords[0];
+        pick.y = pick.placeY = coords[1];
+        pick.z = pick.placeZ = coords[2];
+
+        // back out of the face the ray went in through
+        const int back = axis >= 3 ? -1 : 1;
+        if (axis % 3 == 0)
+            pick.placeX += back;
+        else if (axis % 3 == 1)
+            pick.placeY += back;
+        else
+            pick.placeZ += back;
+    }
+
+    const uint8_t buttons = input.keys & (KEY_BREAK | KEY_PLACE);
+    const bool pressed = (buttons & ~lastButtons) != 0;
+    lastButtons = buttons;
+
+    if (!pick.hit || buttons == 0 || (!pressed && frameTime - lastEditTime < EDIT_REPEAT))
+        return;
+
+    if (buttons & KEY_BREAK)
+        queueEdit({ short(pick.x), short(pick.y), short(pick.z), BLOCK_AIR });
+    else
+        queueEdit({ short(pick.placeX), short(pick.placeY), short(pick.placeZ), hotbar[input.held % HOTBAR_SIZE] });
+
+    lastEditTime = frameTime;
+}
+
+bool queueEdit(const World::BlockEdit& edit)
+{
+    const unsigned int queued = editsQueued.load(std::memory_order_relaxed);
+    if (queued - editsTaken.load(std::memory_order_acquire) == EDIT_QUEUE_SIZE)
+        return false;
+
+    editQueue[queued % EDIT_QUEUE_SIZE] = edit;
+    editsQueued.store(queued + 1, std::memory_order_release);
+
+    return true;
+}
+
+// would a block at x, y, z be inside the player?
+static bool insidePlayer(const int x, const int y, const int z)
+{
+    const vec3 min = playerPos + PLAYER_BOX_MIN, max = playerPos + PLAYER_BOX_MAX;
+
+    return x + 1 > min.x && x < max.x && y + 1 > min.y && y < max.y && z + 1 > min.z && z < max.z;
+}
+
+// the blocks inside the player dug out and the queued edits, set all in one go
+static void applyEdits()
+{
+    World::BlockEdit batch[12 + EDIT_QUEUE_SIZE];
+    int count = 0;
+
+    for (int colliderIndex = 0; colliderIndex < 12; colliderIndex++) {
+        int magicX = int(playerPos.x +       (colliderIndex       & 1) * 0.6F - 0.3F);
+        int magicY = int(playerPos.y + float((colliderIndex >> 2) - 1) * 0.8F + 0.65F);
+        int magicZ = int(playerPos.z +       (colliderIndex >> 1  & 1) * 0.6F - 0.3F);
+
+        // set block to air if inside player
+        if (World::isWithinWorld(vec3(magicX, magicY, magicZ)))
+            batch[count++] = { short(magicX), short(magicY), short(magicZ), BLOCK_AIR };
+    }
+
+    const unsigned int queued = editsQueued.load(std::memory_order_acquire);
+    for (unsigned int i = editsTaken.load(std::memory_order_relaxed); i != queued; i++)
+    {
+        const World::BlockEdit& edit = editQueue[i % EDIT_QUEUE_SIZE];
+
+        if (!World::isWithinWorld(vec3(edit.x, edit.y, edit.z)))
+            continue;
+
+        // only into air, and not on top of the player
+        if (edit.block != BLOCK_AIR &&
+            (World::getBlock(edit.x, edit.y, edit.z) != BLOCK_AIR || insidePlayer(edit.x, edit.y, edit.z)))
+            continue;
+
+        batch[count++] = edit;
+    }
+    editsTaken.store(queued, std::memory_order_release);
+
+    World::setBlocks(batch, count);
+}
+
+void updateSky(const float frameTime)
+{
+    lightDirection.y = sin(frameTime / 10000.0f);
+    lightDirection.x = lightDirection.y * 0.5f;
+    lightDirection.z = cos(frameTime / 10000.0f);
+
+    lightDirection.normalize();
+
+    if (lightDirection.y < 0.0f)
+    {
+        sunColor = lerp(SC_TWILIGHT, SC_DAY, -lightDirection.y);
+        ambColor = lerp(AC_TWILIGHT, AC_DAY, -lightDirection.y);
+        skyColor = lerp(YC_TWILIGHT, YC_DAY, -lightDirection.y);
+    }
+    else {
+        sunColor = lerp(SC_TWILIGHT, SC_NIGHT, lightDirection.y);
+        ambColor = lerp(AC_TWILIGHT, AC_NIGHT, lightDirection.y);
+        skyColor = lerp(YC_TWILIGHT, YC_NIGHT, lightDirection.y);
+    }
+}
+
+void tick()
+{
+    TRACE_ZONE("tick");
+
+    const float inputX = controller.right * 0.02F;
+    const float inputZ = controller.forward * 0.02F;
+
+    playerVelocity.x *= 0.5F;
+    playerVelocity.y *= 0.99F;
+    playerVelocity.z *= 0.5F;
+
+    playerVelocity.x += controller.sinYaw * inputZ + controller.cosYaw * inputX;
+    playerVelocity.z += controller.cosYaw * inputZ - controller.sinYaw * inputX;
+    playerVelocity.y += 0.003F; // gravity
+
+
+    collidePlayer();
+
+    Entities::update();
+    Broadphase::build();
+
+    applyEdits();
+}
+
+void startTicks(const float now)
+{
+    lastTicks.previousPos = playerPos;
+    lastTicks.pos = playerPos;
+    lastTicks.time = now;
+
+    renderPos = playerPos;
+}
+
+int catchUpTicks(const float now)
+{
+    int ticks = 0;
+
+    while (now - lastTicks.time > TICK_LENGTH)
+    {
+        if (ticks == MAX_TICKS_PER_FRAME)
+        {
+            // too far behind, skip the rest rather than make the next frame late too
+            const int behind = int((now - lastTicks.time) / TICK_LENGTH);
+            lastTicks.time += behind * TICK_LENGTH;
+
+            droppedTicks += behind;
+            tickOverruns++;
+            break;
+        }
+
+        lastTicks.previousPos = playerPos;
+        tick();
+        lastTicks.pos = playerPos;
+
+        lastTicks.time += TICK_LENGTH;
+        ticks++;
+    }
+
+    return ticks;
+}
+
+int runTicks(const float now)
+{
+    const int ticks = catchUpTicks(now);
+
+    renderPos = interpolatePlayer(lastTicks, now);
+
+    return ticks;
+}
+
+vec3 interpolatePlayer(const TickState& ticks, const float now)
+{
+    return lerp(ticks.previousPos, ticks.pos, clamp((now - ticks.time) / TICK_LENGTH, 0.0f, 1.0f));
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "Constants.h"
+#include "Vector.h"
+#include "World.h"
+
+// The part of a frame that doesn't need a window or a GPU: input, the sky and physics.
+// run() and the frame benchmark both go through these
+
+constexpr float TICK_LENGTH = 10.0f; // ms of game time per physics tick
+
+constexpr float EDIT_REPEAT = 250.0f; // ms between edits while a mouse button is held down
+
+// edits the ticks haven't got to yet, more than this in one tick are dropped
+constexpr int EDIT_QUEUE_SIZE = 64;
+
+constexpr int HOTBAR_SIZE = 6;
+
+constexpr uint8_t KEY_FORWARD = 1;
+constexpr uint8_t KEY_BACK = 2;
+constexpr uint8_t KEY_RIGHT = 4;
+constexpr uint8_t KEY_LEFT = 8;
+constexpr uint8_t KEY_JUMP = 16;
+constexpr uint8_t KEY_BREAK = 32; // left mouse button
+constexpr uint8_t KEY_PLACE = 64; // right mouse button
+
+// what updateMouse and updateController read in one frame, so it can be recorded and replayed
+struct InputFrame
+{
+    short mouseX, mouseY; // how far the mouse moved from the middle of the window
+    uint8_t keys; // KEY_* bits
+    uint8_t held; // hotbar slot, taken % HOTBAR_SIZE
+};
+
+// the block under the crosshair and the air block next to it a placed block would go in
+struct BlockPick
+{
+    bool hit; // false if there's nothing within PLAYER_REACH
+    int x, y, z;
+    int placeX, placeY, placeZ;
+};
+
+// the player at the last two ticks and when the last one ran, everything needed to draw in between
+struct TickState
+{
+    vec3 previousPos;
+    vec3 pos;
+    float time; // ms
+};
+
+extern float cameraYaw, cameraPitch;
+extern float sinYaw, sinPitch;
+extern float cosYaw, cosPitch;
+
+// playerPos between the last two ticks, where the frame should be drawn from
+extern vec3 renderPos;
+
+extern TickState lastTicks;
+
+// frames that had more than MAX_TICKS_PER_FRAME ticks to catch up on, and the ticks they dropped
+extern long tickOverruns;
+extern long droppedTicks;
+
+// what KEY_PLACE places, by InputFrame::held
+extern const uint8_t hotbar[HOTBAR_SIZE];
+
+// what the last pickBlocks found
+extern BlockPick pick;
+
+extern vec3 lightDirection;
+extern vec3 ambColor;
+extern vec3 skyColor;
+extern vec3 sunColor;
+
+// the camera, player and controller back to how a new game starts, and resetEdits
+void resetGame();
+
+// forget the queued edits and the buttons held for pickBlocks. Not while ticks run on another thread
+void resetEdits();
+
+// turn the camera by the mouse movement
+void turnCamera(const InputFrame& input);
+
+// set up the controller for ticks, from the keys and which way the camera faces
+void setController(uint8_t keys, float yaw);
+
+// turnCamera and setController
+void applyInput(const InputFrame& input);
+
+// find the block under the crosshair from eye, and queue breaking it or placing the held block
+// next to it if input's buttons ask for it. once when pressed, then every EDIT_REPEAT while held
+void pickBlocks(const InputFrame& input, const vec3& eye, float frameTime);
+
+// have the next tick set a block, along with everything else queued since the last one. One
+// thread queues and the ticks can run on another. false if EDIT_QUEUE_SIZE are already waiting
+bool queueEdit(const World::BlockEdit& edit);
+
+// move the sun to where it is at frameTime (ms) and colour the sky to match
+void updateSky(float frameTime);
+
+// one TICK_LENGTH step of player physics, then the queued edits
+void tick();
+
+// start counting ticks from now (ms)
+void startTicks(float now);
+
+// run the ticks that are due by now (ms), up to MAX_TICKS_PER_FRAME. returns how many ran
+int catchUpTicks(float now);
+
+// catchUpTicks and update renderPos
+int runTicks(float now);
+
+// where to draw the player at now (ms), a tick behind so it's always between two known positions
+vec3 interpolatePlayer(const TickState& ticks, float now);
+
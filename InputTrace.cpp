@@ -0,0 +1,80 @@
+#include "InputTrace.h"
+
+#include <SDL/SDL.h>
+
+struct TraceHeader
+{
+    unsigned int magic;
+    unsigned int frameSize;
+    uint64_t seed;
+};
+
+constexpr unsigned int TRACE_MAGIC = 0x4B34494D; // "MI4K"
+
+static SDL_RWops* recording = nullptr;
+
+bool InputTrace::startRecording(const char* path, const uint64_t seed)
+{
+    recording = SDL_RWFromFile(path, "wb");
+    if (recording == nullptr)
+        return false;
+
+    const TraceHeader header = { TRACE_MAGIC, sizeof(InputFrame), seed };
+    SDL_RWwrite(recording, &header, sizeof(header), 1);
+
+    return true;
+}
+
+void InputTrace::record(const InputFrame& input)
+{
+    if (recording != nullptr)
+        SDL_RWwrite(recording, &input, sizeof(input), 1);
+}
+
+void InputTrace::stopRecording()
+{
+    if (recording != nullptr)
+        SDL_RWclose(recording);
+
+    recording = nullptr;
+}
+
+InputFrame* InputTrace::load(const char* path, uint64_t& seed, int& frameCount)
+{
+    SDL_RWops* file = SDL_RWFromFile(path, "rb");
+    if (file == nullptr)
+        return nullptr;
+
+    TraceHeader header;
+    if (SDL_RWread(file, &header, sizeof(header), 1) != 1 ||
+        header.magic != TRACE_MAGIC || header.frameSize != sizeof(InputFrame))
+    {
+        SDL_RWclose(file);
+        return nullptr;
+    }
+
+    seed = header.seed;
+
+    // no length in the header since the game can quit any time, read until the file runs out
+    int capacity = 1024;
+    InputFrame* frames = new InputFrame[capacity];
+    frameCount = 0;
+
+    for (;;)
+    {
+        frameCount += SDL_RWread(file, frames + frameCount, sizeof(InputFrame), capacity - frameCount);
+        if (frameCount < capacity)
+            break;
+
+        InputFrame* bigger = new InputFrame[capacity * 2];
+        for (int i = 0; i < frameCount; i++)
+            bigger[i] = frames[i];
+
+        delete[] frames;
+        frames = bigger;
+        capacity *= 2;
+    }
+
+    SDL_RWclose(file);
+    return frames;
+}
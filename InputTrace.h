@@ -0,0 +1,18 @@
+#pragma once
+#include "Game.h"
+
+// Recordings of the input the game got each frame, for replaying in the frame benchmark.
+// A header with the world seed, then one InputFrame per frame
+namespace InputTrace
+{
+    // write every frame given to record() to path from now on. false if the file can't be made
+    bool startRecording(const char* path, uint64_t seed);
+
+    void record(const InputFrame& input);
+
+    void stopRecording();
+
+    // read a recording made by startRecording, nullptr if there isn't one at path.
+    // the frames are new[]ed
+    InputFrame* load(const char* path, uint64_t& seed, int& frameCount);
+}
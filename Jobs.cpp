@@ -0,0 +1,143 @@
+#include "Jobs.h"
+#include "Trace.h"
+
+#include <SDL/SDL.h>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// the loop currently being run. workers sleep on wakeUp until generation changes
+struct Job
+{
+    void (*fn)(void* context, int i) = nullptr;
+    void* context = nullptr;
+    int count = 0;
+
+    std::atomic<int> next{0};
+    int busyWorkers = 0;
+};
+
+static Job job;
+static int generation = 0;
+
+static SDL_mutex* callerLock = nullptr; // one parallelFor at a time
+static SDL_mutex* lock = nullptr;
+static SDL_cond* wakeUp = nullptr;
+static SDL_cond* finished = nullptr;
+
+static int workerCount = 0;
+static int activeWorkers = 0; // workers past this sit the jobs out
+
+static thread_local bool insideJob = false;
+
+static int coreCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return int(info.dwNumberOfProcessors);
+#else
+    return int(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+}
+
+static void runIndices()
+{
+    TRACE_ZONE("job");
+
+    for (int i = job.next++; i < job.count; i = job.next++)
+        job.fn(job.context, i);
+}
+
+static int worker(void* data)
+{
+    const int id = int((long)data);
+
+    insideJob = true;
+    TRACE_THREAD("worker");
+
+    int seenGeneration = 0;
+
+    SDL_mutexP(lock);
+    for (;;)
+    {
+        while (generation == seenGeneration)
+            SDL_CondWait(wakeUp, lock);
+
+        seenGeneration = generation;
+        SDL_mutexV(lock);
+
+        if (id < activeWorkers)
+            runIndices();
+
+        SDL_mutexP(lock);
+        if (--job.busyWorkers == 0)
+            SDL_CondSignal(finished);
+    }
+}
+
+void Jobs::init(int threads)
+{
+    if (threads <= 0)
+        threads = coreCount();
+
+    callerLock = SDL_CreateMutex();
+    lock = SDL_CreateMutex();
+    wakeUp = SDL_CreateCond();
+    finished = SDL_CreateCond();
+
+    // the thread calling parallelFor does its share too
+    workerCount = threads - 1;
+    activeWorkers = workerCount;
+    for (int i = 0; i < workerCount; i++)
+        SDL_CreateThread(worker, (void*)(long)i);
+}
+
+int Jobs::threadCount()
+{
+    return workerCount + 1;
+}
+
+void Jobs::setThreadLimit(const int threads)
+{
+    activeWorkers = threads <= 0 || threads > workerCount ? workerCount : threads - 1;
+}
+
+void Jobs::parallelFor(const int count, void (*fn)(void* context, int i), void* context)
+{
+    if (activeWorkers == 0 || insideJob || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            fn(context, i);
+
+        return;
+    }
+
+    SDL_mutexP(callerLock);
+
+    SDL_mutexP(lock);
+    job.fn = fn;
+    job.context = context;
+    job.count = count;
+    job.next = 0;
+    job.busyWorkers = workerCount;
+    generation++;
+    SDL_CondBroadcast(wakeUp);
+    SDL_mutexV(lock);
+
+    insideJob = true;
+    runIndices();
+    insideJob = false;
+
+    // wait for the workers to finish their last index
+    SDL_mutexP(lock);
+    while (job.busyWorkers != 0)
+        SDL_CondWait(finished, lock);
+    SDL_mutexV(lock);
+
+    SDL_mutexV(callerLock);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// A fixed pool of worker threads for splitting big loops across cores
+namespace Jobs
+{
+    // start the workers. threads is the total including the calling thread, 0 for one per core
+    void init(int threads = 0);
+
+    int threadCount();
+
+    // use only the first `threads` threads (including the calling one) from now on,
+    // 0 for all of them. For measuring how things scale
+    void setThreadLimit(int threads);
+
+    // run fn(context, i) for every i in [0, count) on the workers and the calling thread,
+    // and return once they're all done. Runs serially before init() or when called from inside a job
+    void parallelFor(int count, void (*fn)(void* context, int i), void* context);
+
+    template<typename F>
+    void parallelFor(const int count, const F& fn)
+    {
+        parallelFor(count, [](void* context, const int i) { (*(const F*)context)(i); }, (void*)&fn);
+    }
+}
@@ -2,37 +2,39 @@
 #include <SDL/SDL.h>
 
 #include "Constants.h"
+#include "CpuRenderer.h"
+#include "DistanceField.h"
+#include "Game.h"
+#include "InputTrace.h"
+#include "Jobs.h"
+#include "Player.h"
 #include "Shader.h"
+#include "Simulation.h"
 #include "TextureGenerator.h"
+#include "Trace.h"
 #include "Util.h"
 #include "World.h"
 
 #include <cmath>
+#include <cstdint>
 
 #include "shader_code.h"
 
-struct Controller
-{
-    float forward;
-    float right;
-
-    bool jump;
-
-    vec2 lastMousePos;
+bool needsResUpdate = true;
 
-    //bool firstMouse = true;
+// trace on the CPU into a software surface instead of running the compute shader
+bool cpuRendering = false;
 
-    void reset()
-    {
-        forward = 0.0f;
-        right = 0.0f;
-        jump = false;
-    }
-};
+// counted up to a second's worth for the window title
+long cpuRays = 0;
+float cpuRaysSince = 0;
 
-Controller controller{};
+char windowTitle[64];
 
-bool needsResUpdate = true;
+#ifdef INPUT_RECORDING
+// --record <file>, see InputTrace.h
+const char* recordingPath = nullptr;
+#endif
 
 int SCR_DETAIL = 2;
 
@@ -47,47 +49,23 @@ GLuint vao;
 
 GLuint textureAtlasTex;
 GLuint worldTexture;
+GLuint brickTexture;
+GLuint columnTopsTexture;
+#ifdef DISTANCE_FIELD
+GLuint distanceFieldTexture;
+#endif
 GLuint screenTexture;
 
 float deltaTime = 16.666f; // 16.66 = 60fps
 
-// spawn player at world center
-vec3 playerPos = vec3(WORLD_SIZE / 2.0f + 0.5f,
-                      1, 
-                      WORLD_SIZE / 2.0f + 0.5f);
-
-vec3 playerVelocity;
-
-vec3 hoveredBlockPos;
-vec3 placeBlockPos;
-
-vec3 newHoverBlockPos;
-
-vec3 lightDirection = vec3(0.866025404f, -0.866025404f, 0.866025404f);
-
-float cameraYaw = 0.01f; // make it not axis aligned by default to avoid raymarching error
-float cameraPitch = -2.0f * PI;                                                                                 
 float FOV = 90.0f;
 vec2 frustumDiv = (SCR_RES * FOV);
 
-float sinYaw, sinPitch;
-float cosYaw, cosPitch;
-
-vec3 ambColor;
-vec3 skyColor;
-vec3 sunColor;
-
-uint8_t hotbar[] { BLOCK_GRASS, BLOCK_DEFAULT_DIRT, BLOCK_STONE, BLOCK_BRICKS, BLOCK_WOOD, BLOCK_LEAVES };
-int heldBlockIndex = 0;
-
-static vec3 lerp(const vec3& start, const vec3& end, const float t)
-{
-    return start + (end - start) * t;
-}
+int heldBlockIndex = 0; // into hotbar
 
 void initTexture(GLuint* texture, const int width, const int height);
-void updateMouse();
-void updateController();
+void updateMouse(InputFrame& input);
+void updateController(InputFrame& input);
 void onWindowResized(int width, int height);
 
 void updateScreenResolution()
@@ -101,7 +79,7 @@ void updateScreenResolution()
     SCR_RES.y = 60 * pow(2, SCR_DETAIL);
 
 
-    char* title = new char[32];
+    char* title = windowTitle;
     strcpy(title, "Minecraft4k");
 
     switch (SCR_DETAIL) {
@@ -139,24 +117,19 @@ void updateScreenResolution()
 
     SDL_WM_SetCaption(title, nullptr);
 
-    glDeleteTextures(1, &screenTexture);
-    initTexture(&screenTexture, int(SCR_RES.x), int(SCR_RES.y));
+    if (!cpuRendering)
+    {
+        glDeleteTextures(1, &screenTexture);
+        initTexture(&screenTexture, int(SCR_RES.x), int(SCR_RES.y));
+    }
 
     needsResUpdate = false;
 }
 
-void init()
+// copy the world and the structures rays use to skip empty space into textures
+static void uploadWorld()
 {
-    // generate world
-
-    prints("Generating world... ");
-#ifdef CLASSIC
-    World::generateWorld(18295169L);
-#else
-    World::generateWorld();
-#endif
-
-    prints("Done!\n");
+    TRACE_ZONE("uploadWorld");
 
     prints("Uploading world to GPU... ");
     glGenTextures(1, &worldTexture);
@@ -173,160 +146,256 @@ void init()
         GL_R8,                                  // internal format
         WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE);  // size
 
-    glTexSubImage3D(GL_TEXTURE_3D,              // target
-        0,                                      // level
-        0, 0, 0,                                // offsets
-        WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE,   // size
-        GL_RED,                                 // format
-        GL_UNSIGNED_BYTE,                       // type
-        World::world);                          // pixels
+    // upload a slab at a time so we never need a flat copy of the whole world
+    constexpr int UPLOAD_SLAB_DEPTH = 16;
+    uint8_t* slab = new uint8_t[WORLD_SIZE * WORLD_HEIGHT * UPLOAD_SLAB_DEPTH];
 
-    glBindTexture(GL_TEXTURE_3D, 0);
+    for (int z = 0; z < WORLD_SIZE; z += UPLOAD_SLAB_DEPTH)
+    {
+        World::readBox(0, 0, z, WORLD_SIZE, WORLD_HEIGHT, UPLOAD_SLAB_DEPTH, slab);
+
+        glTexSubImage3D(GL_TEXTURE_3D,                  // target
+            0,                                          // level
+            0, 0, z,                                    // offsets
+            WORLD_SIZE, WORLD_HEIGHT, UPLOAD_SLAB_DEPTH,// size
+            GL_RED,                                     // format
+            GL_UNSIGNED_BYTE,                           // type
+            slab);                                      // pixels
+    }
 
-    prints("Done!\n");
+    delete[] slab;
 
-    prints("Generating textures... ");
-    textureAtlasTex = generateTextures(151910774187927L);
+    // empty space skipping
+    glGenTextures(1, &brickTexture);
+    glBindTexture(GL_TEXTURE_3D, brickTexture);
 
-    prints("Finished initializing engine! Onto the game.\n");
-}
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, BRICKS_X, BRICKS_Y, BRICKS_Z);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, BRICKS_X, BRICKS_Y, BRICKS_Z, GL_RED, GL_UNSIGNED_BYTE, World::bricks);
 
-void collidePlayer()
-{
-    // check for movement on each axis individually?
-    for (int axis = 0; axis < 3; axis++) {
-        bool moveValid = true;
+    // rays above these skip whole columns
+    glGenTextures(1, &columnTopsTexture);
+    glBindTexture(GL_TEXTURE_2D, columnTopsTexture);
 
-        const vec3 newPlayerPos = vec3(playerPos.x + playerVelocity.x * (axis == 0),
-                                       playerPos.y + playerVelocity.y * (axis == 1),
-                                       playerPos.z + playerVelocity.z * (axis == 2));
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, WORLD_SIZE, WORLD_SIZE);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WORLD_SIZE, WORLD_SIZE, GL_RED, GL_UNSIGNED_BYTE, World::columnTops);
 
-        for (int colliderIndex = 0; colliderIndex < 12; colliderIndex++) {
-            // magic
-            const vec3 colliderBlockPos = vec3((newPlayerPos.x + (colliderIndex       % 2) * 0.6f - 0.3f ),
-                                               (newPlayerPos.y + (colliderIndex / 4   - 1) * 0.8f + 0.65f),
-                                               (newPlayerPos.z + (colliderIndex / 2   % 2) * 0.6f - 0.3f ));
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-            if (colliderBlockPos.y < 0) // ignore collision above the world height limit
-                continue;
+#ifdef DISTANCE_FIELD
+    glGenTextures(1, &distanceFieldTexture);
+    glBindTexture(GL_TEXTURE_3D, distanceFieldTexture);
 
-            // check collision with world bounds and blocks
-            if (!World::isWithinWorld(colliderBlockPos)
-                || World::getBlock(colliderBlockPos) != BLOCK_AIR) {
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE, GL_RED, GL_UNSIGNED_BYTE, DistanceField::distances);
+#endif
 
-                if (axis == 1) // AXIS_Y
-                {
-                    // if we're falling, colliding, and we press space
-                    if (controller.jump && playerVelocity.y > 0.0f) {
+    glBindTexture(GL_TEXTURE_3D, 0);
 
-                        playerVelocity.y = -0.1F; // jump
-                    }
-                    else { // we're on the ground, not jumping
+    prints("Done!\n");
+}
 
-                        playerVelocity.y = 0.0f; // prevent accelerating downwards infinitely
-                    }
-                }
+// boxes changed since they were last uploaded, the big ones can take a few frames
+static DirtyRegions pendingUploads;
 
-                moveValid = false;
-                break;
-            }
-        }
+// a frame copies its share of pendingUploads into the next of these and the GPU takes it from there,
+// so we never write to one it's still reading
+static GLuint stagingBuffers[UPLOAD_RING_SIZE];
+static GLsync stagingFences[UPLOAD_RING_SIZE];
+static int nextStaging = 0;
 
-        if (moveValid) {
-            playerPos = newPlayerPos;
-        }
-    }
+// World::terrainTop as of the frame's reads, the simulation thread can move it any time
+static int frameTerrainTop = WORLD_HEIGHT;
+
+static void initStaging()
+{
+    // pieces can be any width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    //prints(playerPos); prints('\n');
+    glGenBuffers(UPLOAD_RING_SIZE, stagingBuffers);
+    for (int i = 0; i < UPLOAD_RING_SIZE; i++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffers[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, UPLOAD_BUDGET, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
-void run() {
-    auto lastUpdateTime = currentTime();
-    float lastFrameTime = lastUpdateTime - 16;
+// the bricks, column tops (and distances) over piece, straight out of World's arrays. they're small
+static void uploadDerived(const DirtyRegion& piece)
+{
+    const int bx0 = piece.x0 / BRICK_SIZE, bx1 = (piece.x1 - 1) / BRICK_SIZE + 1;
+    const int by0 = piece.y0 / BRICK_SIZE, by1 = (piece.y1 - 1) / BRICK_SIZE + 1;
+    const int bz0 = piece.z0 / BRICK_SIZE, bz1 = (piece.z1 - 1) / BRICK_SIZE + 1;
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, BRICKS_X);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, BRICKS_Y);
+    glBindTexture(GL_TEXTURE_3D, brickTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, bx0, by0, bz0, bx1 - bx0, by1 - by0, bz1 - bz0, GL_RED, GL_UNSIGNED_BYTE,
+        World::bricks + bx0 + by0 * BRICKS_X + bz0 * BRICKS_X * BRICKS_Y);
+
+#ifdef DISTANCE_FIELD
+    // distances change up to DISTANCE_FIELD_MAX blocks away
+    const int x0 = piece.x0 > DISTANCE_FIELD_MAX ? piece.x0 - DISTANCE_FIELD_MAX : 0;
+    const int y0 = piece.y0 > DISTANCE_FIELD_MAX ? piece.y0 - DISTANCE_FIELD_MAX : 0;
+    const int z0 = piece.z0 > DISTANCE_FIELD_MAX ? piece.z0 - DISTANCE_FIELD_MAX : 0;
+    const int x1 = piece.x1 + DISTANCE_FIELD_MAX < WORLD_SIZE ? piece.x1 + DISTANCE_FIELD_MAX : WORLD_SIZE;
+    const int y1 = piece.y1 + DISTANCE_FIELD_MAX < WORLD_HEIGHT ? piece.y1 + DISTANCE_FIELD_MAX : WORLD_HEIGHT;
+    const int z1 = piece.z1 + DISTANCE_FIELD_MAX < WORLD_SIZE ? piece.z1 + DISTANCE_FIELD_MAX : WORLD_SIZE;
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, WORLD_SIZE);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, WORLD_HEIGHT);
+    glBindTexture(GL_TEXTURE_3D, distanceFieldTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, x0, y0, z0, x1 - x0, y1 - y0, z1 - z0, GL_RED, GL_UNSIGNED_BYTE,
+        DistanceField::distances + x0 + y0 * WORLD_SIZE + z0 * WORLD_SIZE * WORLD_HEIGHT);
+#endif
 
-    SDL_WarpMouse(WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2);
+    glBindTexture(GL_TEXTURE_3D, 0);
 
-    SDL_Event evt;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, WORLD_SIZE);
+    glBindTexture(GL_TEXTURE_2D, columnTopsTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, piece.x0, piece.z0, piece.x1 - piece.x0, piece.z1 - piece.z0, GL_RED, GL_UNSIGNED_BYTE,
+        World::columnTops + piece.x0 + piece.z0 * WORLD_SIZE);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    bool running = true;
-    while(running) {
-        const float frameTime = currentTime();
-        deltaTime = frameTime - lastFrameTime;
-        lastFrameTime = frameTime;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
 
-        updateMouse();
-        updateController();
+// copy up to UPLOAD_BUDGET bytes of what's changed in the world to the GPU
+static void uploadDirty()
+{
+    World::takeDirty(pendingUploads);
+    if (pendingUploads.empty())
+        return;
 
-        if (needsResUpdate) {
-            updateScreenResolution();
-        }
+    TRACE_ZONE("uploadDirty");
 
-        sinYaw = sin(cameraYaw);
-        cosYaw = cos(cameraYaw);
-        sinPitch = sin(cameraPitch);
-        cosPitch = cos(cameraPitch);
+    // if the GPU still hasn't finished with this one, try again next frame instead of waiting for it
+    GLsync& fence = stagingFences[nextStaging];
+    if (fence)
+    {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return;
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
 
-        lightDirection.y = sin(frameTime / 10000.0f);
-        lightDirection.x = lightDirection.y * 0.5f;
-        lightDirection.z = cos(frameTime / 10000.0f);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffers[nextStaging]);
+    uint8_t* staging = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, UPLOAD_BUDGET, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
 
-        lightDirection.normalize();
+    DirtyRegion pieces[UPLOAD_PIECES];
+    int offsets[UPLOAD_PIECES];
+    int pieceCount = 0;
+    int used = 0;
 
-        if (lightDirection.y < 0.0f)
+    // a region at a time, the last one might only get some of its slabs in. Then the loose bricks
+    while (!pendingUploads.empty() && pieceCount < UPLOAD_PIECES)
+    {
+        DirtyRegion& piece = pieces[pieceCount];
+
+        if (pendingUploads.count > 0)
         {
-            sunColor = lerp(SC_TWILIGHT, SC_DAY, -lightDirection.y);
-            ambColor = lerp(AC_TWILIGHT, AC_DAY, -lightDirection.y);
-            skyColor = lerp(YC_TWILIGHT, YC_DAY, -lightDirection.y);
-        }
-        else {
-            sunColor = lerp(SC_TWILIGHT, SC_NIGHT, lightDirection.y);
-            ambColor = lerp(AC_TWILIGHT, AC_NIGHT, lightDirection.y);
-            skyColor = lerp(YC_TWILIGHT, YC_NIGHT, lightDirection.y);
+            DirtyRegion& region = pendingUploads.regions[pendingUploads.count - 1];
+            if (!takeSlabs(region, UPLOAD_BUDGET - used, piece))
+                break;
+
+            if (region.z0 == region.z1)
+                pendingUploads.count--;
         }
-        
-        while (currentTime() - lastUpdateTime > 10)
+        else if (!pendingUploads.takeBricks(UPLOAD_BUDGET - used, piece))
         {
-            const float inputX = controller.right * 0.02F;
-            const float inputZ = controller.forward * 0.02F;
+            break;
+        }
 
-            playerVelocity.x *= 0.5F;
-            playerVelocity.y *= 0.99F;
-            playerVelocity.z *= 0.5F;
+        World::readBox(piece.x0, piece.y0, piece.z0, piece.x1 - piece.x0, piece.y1 - piece.y0, piece.z1 - piece.z0, staging + used);
 
-            playerVelocity.x += sinYaw * inputZ + cosYaw * inputX;
-            playerVelocity.z += cosYaw * inputZ - sinYaw * inputX;
-            playerVelocity.y += 0.003F; // gravity
+        offsets[pieceCount++] = used;
+        used += piece.volume();
+    }
 
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
-            collidePlayer();
+    glBindTexture(GL_TEXTURE_3D, worldTexture);
+    for (int i = 0; i < pieceCount; i++)
+    {
+        const DirtyRegion& piece = pieces[i];
+        glTexSubImage3D(GL_TEXTURE_3D, 0, piece.x0, piece.y0, piece.z0, piece.x1 - piece.x0, piece.y1 - piece.y0, piece.z1 - piece.z0,
+            GL_RED, GL_UNSIGNED_BYTE, (void*)(intptr_t)offsets[i]);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
 
-            for (int colliderIndex = 0; colliderIndex < 12; colliderIndex++) {
-                int magicX = int(playerPos.x +       (colliderIndex       & 1) * 0.6F - 0.3F);
-                int magicY = int(playerPos.y + float((colliderIndex >> 2) - 1) * 0.8F + 0.65F);
-                int magicZ = int(playerPos.z +       (colliderIndex >> 1  & 1) * 0.6F - 0.3F);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-                // set block to air if inside player
-                if (World::isWithinWorld(vec3(magicX, magicY, magicZ)))
-                    World::setBlock(magicX, magicY, magicZ, BLOCK_AIR);
-            }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextStaging = (nextStaging + 1) % UPLOAD_RING_SIZE;
 
-            lastUpdateTime += 10;
-        }
+    for (int i = 0; i < pieceCount; i++)
+        uploadDerived(pieces[i]);
+}
 
-        //raycast(SCR_RES / 2.0f, hoveredBlockPos, placeBlockPos);
+void init()
+{
+    TRACE_ZONE("init");
 
-        //prints(hoveredBlockPos); prints("\n");
+    // generate world
 
+    Perlin::init();
 
-        // Compute the raytracing!
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    prints("Generating world... ");
+#ifdef CLASSIC
+    World::generateWorld(18295169L);
+#else
+#ifdef INPUT_RECORDING
+    // a fixed seed, so the frame benchmark can replay the recording in the same world
+    if (recordingPath != nullptr && InputTrace::startRecording(recordingPath, RECORDING_SEED))
+        World::generateWorld(RECORDING_SEED);
+    else
+#endif
+        World::generateWorld();
+#endif
 
+    prints("Done!\n");
 
-        frustumDiv = (SCR_RES * FOV) / defaultRes;
+#ifdef CPU_RENDERER
+    if (cpuRendering)
+    {
+        prints("Generating textures... ");
+        int* textureAtlas = new int[ATLAS_WIDTH * ATLAS_HEIGHT]();
+        loadTextureAtlas(151910774187927L, textureAtlas);
+        CpuRenderer::init(textureAtlas);
+        delete[] textureAtlas;
+        prints("Done!\n");
+
+        return;
+    }
+#endif
+
+    uploadWorld();
+    initStaging();
+
+    prints("Generating textures... ");
+    textureAtlasTex = generateTextures(151910774187927L);
+
+    prints("Finished initializing engine! Onto the game.\n");
+}
+
+void renderGPU()
+{
+    // Compute the raytracing!
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    computeShader.use();
 
-        computeShader.use();
+    glBindImageTexture(1, worldTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8UI);
+    glBindImageTexture(2, brickTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8UI);
+    glBindImageTexture(4, columnTopsTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8UI);
+#ifdef DISTANCE_FIELD
+    glBindImageTexture(3, distanceFieldTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8UI);
+#endif
+    {
+        TRACE_ZONE("uniforms");
 
-        glBindImageTexture(1, worldTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R8UI);
         computeShader.setVec2(PASS_STR("S"), SCR_RES.x, SCR_RES.y);
 
         glBindTexture(GL_TEXTURE_2D, textureAtlasTex);
@@ -337,7 +406,7 @@ void run() {
         computeShader.setFloat(PASS_STR("c.sY"), sin(cameraYaw));
         computeShader.setFloat(PASS_STR("c.sP"), sin(cameraPitch));
         computeShader.setVec2(PASS_STR("c.fD"), frustumDiv);
-        computeShader.setVec3(PASS_STR("c.P"), playerPos);
+        computeShader.setVec3(PASS_STR("c.P"), renderPos);
 
 #ifdef CLASSIC
 
@@ -346,14 +415,23 @@ void run() {
         computeShader.setVec3(PASS_STR("k"), skyColor);
         computeShader.setVec3(PASS_STR("a"), ambColor);
         computeShader.setVec3(PASS_STR("s"), sunColor);
+        computeShader.setInt(PASS_STR("h"), frameTerrainTop);
 #endif
+    }
 
-        glInvalidateTexImage(screenTexture, 0);
+    glInvalidateTexImage(screenTexture, 0);
+
+    {
+        TRACE_ZONE("glDispatchCompute");
 
         glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
         glDispatchCompute(GLuint((SCR_RES.x + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), GLuint((SCR_RES.y + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1);
         glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
         glUseProgram(0);
+    }
+
+    {
+        TRACE_ZONE("blit");
 
         // render the screen texture
         screenShader.use();
@@ -372,41 +450,171 @@ void run() {
         glDisableVertexAttribArray(0);
 
         glUseProgram(0);
+    }
 
-        prints("frame\n");
+    prints("frame\n");
 
+    {
+        TRACE_ZONE("SDL_GL_SwapBuffers");
         SDL_GL_SwapBuffers();
+    }
+}
+
+#ifdef CPU_RENDERER
+void renderCPU(const float frameTime)
+{
+    CpuRenderer::Uniforms uniforms;
+    uniforms.position = renderPos;
+    uniforms.cosYaw = cos(cameraYaw);
+    uniforms.cosPitch = cos(cameraPitch);
+    uniforms.sinYaw = sin(cameraYaw);
+    uniforms.sinPitch = sin(cameraPitch);
+    uniforms.frustumDiv = frustumDiv;
+
+#ifndef CLASSIC // classic never sets these, so they stay 0
+    uniforms.lightDirection = lightDirection;
+    uniforms.skyColor = skyColor;
+    uniforms.ambColor = ambColor;
+    uniforms.sunColor = sunColor;
+#endif
+
+    {
+        TRACE_ZONE("CpuRenderer::render");
+        cpuRays += CpuRenderer::render(uniforms, int(SCR_RES.x), int(SCR_RES.y));
+    }
+
+    {
+        TRACE_ZONE("present");
+        SDL_Surface* surface = SDL_GetVideoSurface();
+        CpuRenderer::present(surface);
+        SDL_Flip(surface);
+    }
+
+    // show rays per second in the title
+    if (frameTime - cpuRaysSince >= 1000)
+    {
+        char caption[96];
+        char kRays[16];
+        itoa(int(cpuRays / long(frameTime - cpuRaysSince)), kRays); // per ms = thousands per second
+
+        strcpy(caption, windowTitle);
+        strcat(caption, " - ");
+        strcat(caption, kRays);
+        strcat(caption, "k rays/s");
+        SDL_WM_SetCaption(caption, nullptr);
+
+        cpuRays = 0;
+        cpuRaysSince = frameTime;
+    }
+}
+#endif
+
+void run() {
+    float lastFrameTime = currentTime() - 16;
+#ifdef SIM_THREAD
+    Simulation::start(currentTime());
+#else
+    startTicks(currentTime());
+#endif
+
+    SDL_WarpMouse(WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2);
+
+    SDL_Event evt;
+
+    bool running = true;
+    while(running) {
+        TRACE_ZONE("frame");
+
+        const float frameTime = currentTime();
+        deltaTime = frameTime - lastFrameTime;
+        lastFrameTime = frameTime;
+
+        InputFrame input;
+        updateMouse(input);
+        updateController(input);
+
+#ifdef INPUT_RECORDING
+        InputTrace::record(input);
+#endif
+
+#ifdef SIM_THREAD
+        turnCamera(input);
+        Simulation::setInput(input.keys, cameraYaw);
+#else
+        applyInput(input);
+#endif
+
+        if (needsResUpdate) {
+            updateScreenResolution();
+        }
+
+        updateSky(frameTime);
+
+#ifdef SIM_THREAD
+        renderPos = interpolatePlayer(Simulation::latest().ticks, frameTime);
+#else
+        runTicks(frameTime);
+#endif
+
+        // the ticks can't edit the world halfway through us reading it
+        World::lockEdits();
+
+#ifdef CPU_RENDERER
+        if (!cpuRendering)
+#endif
+            uploadDirty();
+
+        pickBlocks(input, renderPos, frameTime);
+        frameTerrainTop = World::terrainTop;
+
+        World::unlockEdits();
+
+        frustumDiv = (SCR_RES * FOV) / defaultRes;
+
+#ifdef CPU_RENDERER
+        if (cpuRendering)
+            renderCPU(frameTime);
+        else
+#endif
+            renderGPU();
 
         while(SDL_PollEvent(&evt))
         {
             if(evt.type == SDL_QUIT)
                 running = false;
+
+            // scroll through the hotbar
+            if (evt.type == SDL_MOUSEBUTTONDOWN && evt.button.button == SDL_BUTTON_WHEELUP)
+                heldBlockIndex = (heldBlockIndex + HOTBAR_SIZE - 1) % HOTBAR_SIZE;
+            if (evt.type == SDL_MOUSEBUTTONDOWN && evt.button.button == SDL_BUTTON_WHEELDOWN)
+                heldBlockIndex = (heldBlockIndex + 1) % HOTBAR_SIZE;
         }
     }
 
+#ifdef SIM_THREAD
+    Simulation::stop();
+#endif
+
+#ifdef INPUT_RECORDING
+    InputTrace::stopRecording();
+#endif
+
+    TRACE_DUMP();
+
     // put it out of its misery (evil code)
     crash();
 
     //glfwTerminate();
 }
 
-void updateMouse()
+void updateMouse(InputFrame& input)
 {
     int x, y;
     SDL_GetMouseState(&x, &y);
     SDL_WarpMouse(WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2);
 
-    cameraYaw += (x - (WINDOW_WIDTH / 2)) / 500.0f;
-    cameraPitch -= (y - (WINDOW_HEIGHT / 2)) / 500.0f;
-
-    if(abs(cameraYaw) > PI)
-    {
-        if (cameraYaw > 0)
-            cameraYaw = -PI - (cameraYaw - PI);
-        else
-            cameraYaw = PI + (cameraYaw + PI);
-    }
-    cameraPitch = clamp(cameraPitch, -PI / 2.0f, PI / 2.0f);
+    input.mouseX = short(x - (WINDOW_WIDTH / 2));
+    input.mouseY = short(y - (WINDOW_HEIGHT / 2));
 }
 
 void onWindowResized(int width, int height)
@@ -456,22 +664,29 @@ bool keyPress(SDL_Window* window, int key)
     return false;
 }*/
 
-void updateController()
+void updateController(InputFrame& input)
 {
-    controller.reset();
-
     const uint8_t *keyboard = SDL_GetKeyState(nullptr);
 
+    input.keys = 0;
     if(keyboard[SDLK_w])
-        controller.forward += 1.0f;
+        input.keys |= KEY_FORWARD;
     if (keyboard[SDLK_s])
-        controller.forward -= 1.0f;
+        input.keys |= KEY_BACK;
     if (keyboard[SDLK_d])
-        controller.right += 1.0f;
+        input.keys |= KEY_RIGHT;
     if (keyboard[SDLK_a])
-        controller.right -= 1.0f;
+        input.keys |= KEY_LEFT;
     if (keyboard[SDLK_SPACE])
-        controller.jump = true;
+        input.keys |= KEY_JUMP;
+
+    const uint8_t buttons = SDL_GetMouseState(nullptr, nullptr);
+    if (buttons & SDL_BUTTON(SDL_BUTTON_LEFT))
+        input.keys |= KEY_BREAK;
+    if (buttons & SDL_BUTTON(SDL_BUTTON_RIGHT))
+        input.keys |= KEY_PLACE;
+
+    input.held = uint8_t(heldBlockIndex);
 
     if (keyboard[SDLK_COMMA]) {
         SCR_DETAIL--;
@@ -482,8 +697,13 @@ void updateController()
         needsResUpdate = true;
     }
 
-    controller.forward = clamp(controller.forward, -1.0f, 1.0f);
-    controller.right = clamp(controller.right, -1.0f, 1.0f);
+#ifdef TRACING
+    // once per press, not every frame it's held
+    static bool traceKeyDown = false;
+    if (keyboard[SDLK_F9] && !traceKeyDown)
+        TRACE_DUMP();
+    traceKeyDown = keyboard[SDLK_F9];
+#endif
 }
 
 void initBuffers() {
@@ -522,17 +742,9 @@ void initTexture(GLuint* texture, const int width, const int height) {
     glBindImageTexture(0, *texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
 }
 
-// TODO maybe use _start: https://int21.de/linux4k/
-int main()
+void initGL()
 {
-    prints("Initializing SDL... ");
-    // uhh I guess we don't need to SDL_Init??
-    prints("Done!\n");
-
-    prints("Creating window... ");
-
-    SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, 0, SDL_OPENGL); // TODO SDL_FULLSCREEN?
-    SDL_ShowCursor(SDL_DISABLE);
+    TRACE_ZONE("initGL");
 
     // Request an OpenGL 4.3 context (should be core)
     SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1); // TODO what is this?
@@ -542,8 +754,6 @@ int main()
 #ifdef __APPLE__
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE); // add on Mac bc Apple is big dumb :(
 #endif
-    prints("Done!\n");
-
 
     prints("Setting OpenGL context... ");
     
@@ -592,6 +802,42 @@ int main()
     prints("Building render texture... ");
     initTexture(&screenTexture, int(SCR_RES.x), int(SCR_RES.y));
     prints("Done!\n");
+}
+
+// TODO maybe use _start: https://int21.de/linux4k/
+int main(int argc, char** argv)
+{
+    TRACE_THREAD("main");
+
+#ifdef CPU_RENDERER
+    for (int i = 1; i < argc; i++)
+        cpuRendering |= strcmp(argv[i], "--cpu") == 0;
+#endif
+
+#ifdef INPUT_RECORDING
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--record") == 0)
+            recordingPath = argv[i + 1];
+    }
+#endif
+
+    prints("Initializing SDL... ");
+    // uhh I guess we don't need to SDL_Init??
+    prints("Done!\n");
+
+    prints("Creating window... ");
+
+    SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, cpuRendering ? 32 : 0, cpuRendering ? SDL_SWSURFACE : SDL_OPENGL); // TODO SDL_FULLSCREEN?
+    SDL_ShowCursor(SDL_DISABLE);
+    prints("Done!\n");
+
+    if (!cpuRendering)
+        initGL();
+
+    prints("Starting worker threads... ");
+    Jobs::init();
+    prints("Done!\n");
 
     prints("Initializing engine...\n");
     init();
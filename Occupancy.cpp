@@ -0,0 +1,152 @@
+#include "Occupancy.h"
+
+#include "Jobs.h"
+#include "World.h"
+
+static constexpr int levelSize(const int level)
+{
+    return Occupancy::wordsX(level) * Occupancy::wordsY(level) * Occupancy::wordsZ(level);
+}
+
+uint64_t* Occupancy::levels[OCCUPANCY_LEVELS] = {
+    new uint64_t[levelSize(0)],
+    new uint64_t[levelSize(1)],
+    new uint64_t[levelSize(2)],
+};
+
+static int wordIndex(const int level, const int cx, const int cy, const int cz)
+{
+    return (cx >> 2) + (cy >> 2) * Occupancy::wordsX(level) + (cz >> 2) * Occupancy::wordsX(level) * Occupancy::wordsY(level);
+}
+
+static uint64_t bit(const int cx, const int cy, const int cz)
+{
+    return uint64_t(1) << ((cx & 3) | (cy & 3) << 2 | (cz & 3) << 4);
+}
+
+// the 4x4x4 blocks of level 0 word (wx, wy, wz)
+static uint64_t blockBits(const int wx, const int wy, const int wz)
+{
+    uint64_t word = 0;
+
+    for (int z = wz * 4; z < wz * 4 + 4; z++)
+        for (int y = wy * 4; y < wy * 4 + 4; y++)
+            for (int x = wx * 4; x < wx * 4 + 4; x++)
+                if (World::world.get(x, y, z) != BLOCK_AIR)
+                    word |= bit(x, y, z);
+
+    return word;
+}
+
+void Occupancy::build()
+{
+    // a layer of level 0 words at a time
+    Jobs::parallelFor(wordsZ(0), [](const int wz) {
+        for (int wy = 0; wy < wordsY(0); wy++)
+            for (int wx = 0; wx < wordsX(0); wx++)
+                levels[0][wx + wy * wordsX(0) + wz * wordsX(0) * wordsY(0)] = blockBits(wx, wy, wz);
+    });
+
+    // every word of the level below is a bit of this one
+    for (int level = 1; level < OCCUPANCY_LEVELS; level++)
+    {
+        for (int i = 0; i < levelSize(level); i++)
+            levels[level][i] = 0;
+
+        for (int cz = 0; cz < wordsZ(level - 1); cz++)
+            for (int cy = 0; cy < wordsY(level - 1); cy++)
+                for (int cx = 0; cx < wordsX(level - 1); cx++)
+                    if (levels[level - 1][cx + cy * wordsX(level - 1) + cz * wordsX(level - 1) * wordsY(level - 1)] != 0)
+                        levels[level][wordIndex(level, cx, cy, cz)] |= bit(cx, cy, cz);
+    }
+}
+
+void Occupancy::set(int x, int y, int z, const bool solid)
+{
+    for (int level = 0; level < OCCUPANCY_LEVELS; level++)
+    {
+        uint64_t& word = levels[level][wordIndex(level, x, y, z)];
+        const bool wasEmpty = word == 0;
+
+        if (solid)
+            word |= bit(x, y, z);
+        else
+            word &= ~bit(x, y, z);
+
+        // the level above only cares whether the word is empty
+        if (wasEmpty == (word == 0))
+            break;
+
+        x >>= 2;
+        y >>= 2;
+        z >>= 2;
+    }
+}
+
+void Occupancy::refresh(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    for (int wz = z0 >> 2; wz <= (z1 - 1) >> 2; wz++)
+        for (int wy = y0 >> 2; wy <= (y1 - 1) >> 2; wy++)
+            for (int wx = x0 >> 2; wx <= (x1 - 1) >> 2; wx++)
+                levels[0][wx + wy * wordsX(0) + wz * wordsX(0) * wordsY(0)] = blockBits(wx, wy, wz);
+
+    // each bit of a level is whether the word under it has anything in
+    for (int level = 1; level < OCCUPANCY_LEVELS; level++)
+    {
+        const int shift = 2 * level;
+
+        for (int cz = z0 >> shift; cz <= (z1 - 1) >> shift; cz++)
+        {
+            for (int cy = y0 >> shift; cy <= (y1 - 1) >> shift; cy++)
+            {
+                for (int cx = x0 >> shift; cx <= (x1 - 1) >> shift; cx++)
+                {
+                    uint64_t& word = levels[level][wordIndex(level, cx, cy, cz)];
+
+                    if (levels[level - 1][cx + cy * wordsX(level - 1) + cz * wordsX(level - 1) * wordsY(level - 1)] != 0)
+                        word |= bit(cx, cy, cz);
+                    else
+                        word &= ~bit(cx, cy, cz);
+                }
+            }
+        }
+    }
+}
+
+// bits [from, to] of a 4 bit row
+static uint64_t span(const int from, const int to)
+{
+    return ((uint64_t(1) << (to - from + 1)) - 1) << from;
+}
+
+bool Occupancy::any(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    for (int wz = z0 >> 2; wz <= z1 >> 2; wz++)
+    {
+        for (int wy = y0 >> 2; wy <= y1 >> 2; wy++)
+        {
+            for (int wx = x0 >> 2; wx <= x1 >> 2; wx++)
+            {
+                const uint64_t word = levels[0][wx + wy * wordsX(0) + wz * wordsX(0) * wordsY(0)];
+                if (word == 0)
+                    continue;
+
+                // the part of the box inside this word
+                const uint64_t row = span(wx == x0 >> 2 ? x0 & 3 : 0, wx == x1 >> 2 ? x1 & 3 : 3);
+
+                uint64_t layer = 0;
+                for (int y = wy == y0 >> 2 ? y0 & 3 : 0; y <= (wy == y1 >> 2 ? y1 & 3 : 3); y++)
+                    layer |= row << (y * 4);
+
+                uint64_t mask = 0;
+                for (int z = wz == z0 >> 2 ? z0 & 3 : 0; z <= (wz == z1 >> 2 ? z1 & 3 : 3); z++)
+                    mask |= layer << (z * 16);
+
+                if (word & mask)
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
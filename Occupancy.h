@@ -0,0 +1,55 @@
+#pragma once
+#include "Constants.h"
+
+// 1 bit per block, set if it isn't air. Each 64 bit word holds a 4x4x4 cube of blocks.
+// Level n + 1 has one bit per word of level n (OR of its 64 bits), so a bit of level n
+// covers a (4^n)^3 cell of blocks: 1, 4 and 16 blocks wide for the levels we keep
+constexpr int OCCUPANCY_LEVELS = 3;
+
+static_assert(WORLD_SIZE % 64 == 0 && WORLD_HEIGHT % 64 == 0,
+    "the top occupancy level needs the world to be made of 64^3 cubes");
+
+namespace Occupancy
+{
+    extern uint64_t* levels[OCCUPANCY_LEVELS];
+
+    // words per row and per layer of each level
+    constexpr int wordsX(const int level)
+    {
+        return WORLD_SIZE >> (2 * level + 2);
+    }
+
+    constexpr int wordsY(const int level)
+    {
+        return WORLD_HEIGHT >> (2 * level + 2);
+    }
+
+    constexpr int wordsZ(const int level)
+    {
+        return WORLD_SIZE >> (2 * level + 2);
+    }
+
+    // any block in cell (cx, cy, cz) of level? cells are 4^level blocks wide
+    inline bool cell(const int level, const int cx, const int cy, const int cz)
+    {
+        const uint64_t word = levels[level][(cx >> 2) + (cy >> 2) * wordsX(level) + (cz >> 2) * wordsX(level) * wordsY(level)];
+
+        return (word >> ((cx & 3) | (cy & 3) << 2 | (cz & 3) << 4)) & 1;
+    }
+
+    inline bool solid(const int x, const int y, const int z)
+    {
+        return cell(0, x, y, z);
+    }
+
+    // from scratch, spread over the job system
+    void build();
+
+    void set(int x, int y, int z, bool solid);
+
+    // redo the bits of [x0, x1) x [y0, y1) x [z0, z1) from the world, after lots of it changed at once
+    void refresh(int x0, int y0, int z0, int x1, int y1, int z1);
+
+    // any block in [x0, x1] x [y0, y1] x [z0, z1]? bounds are inclusive and must be within the world
+    bool any(int x0, int y0, int z0, int x1, int y1, int z1);
+}
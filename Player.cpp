@@ -0,0 +1,38 @@
+#include "Player.h"
+
+#include "Collision.h"
+#include "Constants.h"
+#include "Trace.h"
+#include "World.h"
+
+Controller controller{};
+
+vec3 playerPos = PLAYER_SPAWN;
+
+vec3 playerVelocity;
+
+void collidePlayer()
+{
+    TRACE_ZONE("collidePlayer");
+
+    Collision::Box box = { playerPos + PLAYER_BOX_MIN, playerPos + PLAYER_BOX_MAX };
+
+    const int blocked = Collision::move(box, playerVelocity);
+
+    playerPos = box.min - PLAYER_BOX_MIN;
+
+    if (blocked & (1 << 1)) // AXIS_Y
+    {
+        // if we're falling, colliding, and we press space
+        if (controller.jump && playerVelocity.y > 0.0f) {
+
+            playerVelocity.y = -0.1F; // jump
+        }
+        else { // we're on the ground, not jumping
+
+            playerVelocity.y = 0.0f; // prevent accelerating downwards infinitely
+        }
+    }
+
+    //prints(playerPos); prints('\n');
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Constants.h"
+#include "Vector.h"
+
+struct Controller
+{
+    float forward;
+    float right;
+
+    bool jump;
+
+    // which way forward is
+    float sinYaw, cosYaw;
+
+    vec2 lastMousePos;
+
+    //bool firstMouse = true;
+
+    void reset()
+    {
+        forward = 0.0f;
+        right = 0.0f;
+        jump = false;
+    }
+};
+
+// the player's box around playerPos, with the same corners the old 12 point probe used
+constexpr vec3 PLAYER_BOX_MIN = vec3(-0.3f, -0.8f + 0.65f, -0.3f);
+constexpr vec3 PLAYER_BOX_MAX = vec3(0.3f, 0.8f + 0.65f, 0.3f);
+
+// spawn player at world center
+constexpr vec3 PLAYER_SPAWN = vec3(WORLD_SIZE / 2.0f + 0.5f, 1, WORLD_SIZE / 2.0f + 0.5f);
+
+extern Controller controller;
+
+extern vec3 playerPos;
+extern vec3 playerVelocity;
+
+// move the player by playerVelocity, stopping at blocks and the world bounds
+void collidePlayer();
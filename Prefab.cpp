@@ -0,0 +1,268 @@
+#include "Prefab.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cstring>
+
+#ifdef X86_SIMD
+#include <immintrin.h>
+#endif
+
+constexpr int TREE_MIN_TRUNK = 4;
+
+// the body's box: the trunk plus a block of crown above it, 2 blocks of foliage either side
+constexpr int TREE_WIDTH = 5;
+constexpr int TREE_MAX_HEIGHT = TREE_MIN_TRUNK + Prefabs::TREE_VARIANTS + 1;
+
+static_assert(TREE_WIDTH * TREE_MAX_HEIGHT * TREE_WIDTH <= PREFAB_MAX_BLOCKS, "trees have to fit a prefab");
+
+static uint8_t treeBlocks[Prefabs::TREE_VARIANTS][TREE_WIDTH * TREE_MAX_HEIGHT * TREE_WIDTH];
+static uint8_t treeReplace[Prefabs::TREE_VARIANTS][TREE_WIDTH * TREE_MAX_HEIGHT * TREE_WIDTH];
+static uint8_t treeSpans[Prefabs::TREE_VARIANTS][TREE_MAX_HEIGHT * TREE_WIDTH * 2];
+
+// what the corner cuts stamp, a column of up to 2 blocks of air over anything
+static const uint8_t cutBlocks[2] = { BLOCK_AIR, BLOCK_AIR };
+static const uint8_t cutReplace[2] = { 0xFF, 0xFF };
+static const uint8_t cutSpans[4] = { 0, 1, 0, 1 };
+
+static Stencil cut(const int x, const int y, const int z, const int height)
+{
+    return { short(x), short(y), short(z), 1, short(height), 1, cutBlocks, cutReplace, cutSpans };
+}
+
+// a choice between BOUND picks that all stamp nothing yet. stamp indexes picks with
+// rand.nextInt(BOUND), so it can't be more than there are
+template<int BOUND>
+static PrefabChoice noPicks()
+{
+    static_assert(BOUND > 0 && BOUND <= PREFAB_MAX_PICKS, "a choice picks between 1 to PREFAB_MAX_PICKS parts");
+
+    PrefabChoice choice;
+    choice.bound = BOUND;
+    for (int pick = 0; pick < PREFAB_MAX_PICKS; pick++)
+        choice.picks[pick] = -1;
+
+    return choice;
+}
+
+// fill in the spans of a stencil's rows, trimming the air that only goes into air off each end
+static void trimRows(const Stencil& stencil, uint8_t* spans)
+{
+    for (int row = 0; row < stencil.height * stencil.depth; row++)
+    {
+        const uint8_t* blocks = stencil.blocks + row * stencil.width;
+        const uint8_t* replace = stencil.replace + row * stencil.width;
+
+        int begin = 0, end = stencil.width;
+        while (begin < end && blocks[begin] == BLOCK_AIR && replace[begin] == 0)
+            begin++;
+        while (end > begin && blocks[end - 1] == BLOCK_AIR && replace[end - 1] == 0)
+            end--;
+
+        spans[row * 2] = uint8_t(begin);
+        spans[row * 2 + 1] = uint8_t(end);
+    }
+}
+
+// a trunk of trunkHeight + 1 wood going up from the anchor, two layers of foliage 5 wide around
+// its top and a 3 wide crown over that, with its top corners cut off. The foliage's corners and
+// the crown's bottom corners are cut out at random
+static Prefab buildTree(const int variant)
+{
+    const int trunkHeight = TREE_MIN_TRUNK + variant;
+
+    Prefab tree = {};
+    tree.body = { -2, short(-trunkHeight - 1), -2, TREE_WIDTH, short(trunkHeight + 2), TREE_WIDTH,
+        treeBlocks[variant], treeReplace[variant], treeSpans[variant] };
+
+    int i = 0;
+    for (int dz = -2; dz <= 2; dz++)
+    {
+        for (int dy = -trunkHeight - 1; dy <= 0; dy++)
+        {
+            for (int dx = -2; dx <= 2; dx++, i++)
+            {
+                const bool trunk = dx == 0 && dz == 0 && dy >= -trunkHeight;
+                const bool foliage = dy >= -trunkHeight + 1 && dy <= -trunkHeight + 2;
+                const bool crown = dy <= -trunkHeight && dx >= -1 && dx <= 1 && dz >= -1 && dz <= 1;
+                const bool crownCorner = crown && dy == -trunkHeight - 1 && dx != 0 && dz != 0;
+
+                treeBlocks[variant][i] = trunk ? BLOCK_WOOD : (foliage || crown) && !crownCorner ? BLOCK_LEAVES : BLOCK_AIR;
+                treeReplace[variant][i] = trunk || crownCorner ? 0xFF : 0;
+            }
+        }
+    }
+
+    trimRows(tree.body, treeSpans[variant]);
+
+    // binary counting, so we cover all four corners
+    for (int corner = 0; corner < 4; corner++)
+    {
+        const int bit0 = (corner >> 0 & 0b01) * 2 - 1;
+        const int bit1 = (corner >> 1 & 0b01) * 2 - 1;
+
+        Stencil* parts = tree.parts + corner * 4;
+        parts[0] = cut(2 * bit0, -trunkHeight + 1, 2 * bit1, 1); // foliage top
+        parts[1] = cut(2 * bit0, -trunkHeight + 2, 2 * bit1, 1); // foliage bottom
+        parts[2] = cut(2 * bit0, -trunkHeight + 1, 2 * bit1, 2); // both
+        parts[3] = cut(bit0, -trunkHeight, bit1, 1); // crown bottom
+
+        // the foliage corner's top 1 in 7, bottom 1 in 7 and both 1 in 7, then the crown's 1 in 5
+        PrefabChoice& foliageCut = tree.choices[tree.choiceCount++];
+        PrefabChoice& crownCut = tree.choices[tree.choiceCount++];
+
+        foliageCut = noPicks<7>();
+        crownCut = noPicks<5>();
+        for (int pick = 0; pick < 3; pick++)
+            foliageCut.picks[pick] = static_cast<signed char>(corner * 4 + pick);
+        crownCut.picks[0] = static_cast<signed char>(corner * 4 + 3);
+    }
+
+    return tree;
+}
+
+const Prefab Prefabs::trees[TREE_VARIANTS] = { buildTree(0), buildTree(1) };
+
+// row[i] = blocks[i] where replace[i] is set or row[i] is air
+static void blendStencil(uint8_t* row, const uint8_t* blocks, const uint8_t* replace, const int count)
+{
+    int i = 0;
+
+#ifdef X86_SIMD
+    const __m128i air = _mm_set1_epi8(char(BLOCK_AIR));
+
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(row + i));
+        const __m128i src = _mm_loadu_si128((const __m128i*)(blocks + i));
+        const __m128i take = _mm_or_si128(_mm_loadu_si128((const __m128i*)(replace + i)), _mm_cmpeq_epi8(old, air));
+
+        _mm_storeu_si128((__m128i*)(row + i), _mm_or_si128(_mm_and_si128(take, src), _mm_andnot_si128(take, old)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const uint8_t take = replace[i] | -uint8_t(row[i] == BLOCK_AIR);
+        row[i] = (blocks[i] & take) | (row[i] & ~take);
+    }
+}
+
+// a row at a time, the part of each row's span that's in the world
+static void stampStencil(const Stencil& stencil, const int x, const int y, const int z)
+{
+    const int width = stencil.width, height = stencil.height;
+    const uint8_t* blocks = stencil.blocks;
+    const uint8_t* replace = stencil.replace;
+    const uint8_t* spans = stencil.spans;
+
+    const int boxX = x + stencil.x, boxY = y + stencil.y, boxZ = z + stencil.z;
+
+    const int y0 = boxY < 0 ? 0 : boxY;
+    const int z0 = boxZ < 0 ? 0 : boxZ;
+    const int y1 = boxY + height > WORLD_HEIGHT ? WORLD_HEIGHT : boxY + height;
+    const int z1 = boxZ + stencil.depth > WORLD_SIZE ? WORLD_SIZE : boxZ + stencil.depth;
+    const bool clipX = boxX < 0 || boxX + width > WORLD_SIZE;
+
+    for (int bz = z0; bz < z1; bz++)
+    {
+        for (int by = y0; by < y1; by++)
+        {
+            const int row = (by - boxY) + (bz - boxZ) * height;
+
+            int x0 = boxX + spans[row * 2];
+            int x1 = boxX + spans[row * 2 + 1];
+            if (clipX)
+            {
+                x0 = x0 < 0 ? 0 : x0;
+                x1 = x1 > WORLD_SIZE ? WORLD_SIZE : x1;
+            }
+
+            if (x0 >= x1)
+                continue;
+
+            const int offset = (x0 - boxX) + row * width;
+
+            World::world.editRow(x0, by, bz, x1 - x0, [&](uint8_t* out) {
+                blendStencil(out, blocks + offset, replace + offset, x1 - x0);
+            });
+        }
+    }
+}
+
+// part over a copy of a body, the same as stamping one after the other would leave the world.
+// Widens the spans of the rows it adds to
+static void stampOver(const Stencil& part, const Stencil& body, uint8_t* blocks, uint8_t* replace, uint8_t* spans)
+{
+    for (int z = 0; z < part.depth; z++)
+    {
+        for (int y = 0; y < part.height; y++)
+        {
+            const int row = (part.y - body.y + y) + (part.z - body.z + z) * body.height;
+
+            for (int x = 0; x < part.width; x++)
+            {
+                const int bx = part.x - body.x + x;
+                const int i = bx + row * body.width;
+                const int p = x + (y + z * part.height) * part.width;
+
+                // over anything, or into what's still air
+                if (part.replace[p] != 0)
+                {
+                    blocks[i] = part.blocks[p];
+                    replace[i] = 0xFF;
+                }
+                else if (part.blocks[p] != BLOCK_AIR && blocks[i] == BLOCK_AIR)
+                {
+                    blocks[i] = part.blocks[p];
+                }
+                else
+                {
+                    continue;
+                }
+
+                uint8_t& begin = spans[row * 2];
+                uint8_t& end = spans[row * 2 + 1];
+                const bool empty = begin >= end;
+                begin = empty || bx < begin ? uint8_t(bx) : begin;
+                end = empty || bx >= end ? uint8_t(bx + 1) : end;
+            }
+        }
+    }
+}
+
+void Prefabs::stamp(const Prefab& prefab, Random& rand, const int x, const int y, const int z)
+{
+    const Stencil& body = prefab.body;
+    const int blockCount = body.width * body.height * body.depth;
+    const int rowCount = body.height * body.depth;
+
+    uint8_t blocks[PREFAB_MAX_BLOCKS];
+    uint8_t replace[PREFAB_MAX_BLOCKS];
+    uint8_t spans[PREFAB_MAX_ROWS * 2];
+    Stencil chosen = body;
+    bool copied = false;
+
+    for (int i = 0; i < prefab.choiceCount; i++)
+    {
+        const PrefabChoice& choice = prefab.choices[i];
+        const int pick = choice.picks[rand.nextInt(choice.bound)];
+        if (pick < 0)
+            continue;
+
+        if (!copied)
+        {
+            std::memcpy(blocks, body.blocks, blockCount);
+            std::memcpy(replace, body.replace, blockCount);
+            std::memcpy(spans, body.spans, rowCount * 2);
+            chosen.blocks = blocks;
+            chosen.replace = replace;
+            chosen.spans = spans;
+            copied = true;
+        }
+
+        stampOver(prefab.parts[pick], chosen, blocks, replace, spans);
+    }
+
+    stampStencil(chosen, x, y, z);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Constants.h"
+
+class Random;
+
+// Structures worldgen stamps down whole, like trees. A prefab is a box of blocks built once up
+// front, plus a few random choices between smaller boxes stamped over it (a corner cut out or
+// not). The choices are made on a copy of the box, so placing one is a few copies and one pass
+// over the world a row at a time instead of a set per block
+
+// the most choices a prefab makes, and the most a choice picks between
+constexpr int PREFAB_MAX_CHOICES = 8;
+constexpr int PREFAB_MAX_PICKS = 8;
+
+// the most boxes a prefab's choices can pick from
+constexpr int PREFAB_MAX_PARTS = 16;
+
+// the biggest body, in blocks and in rows along x. Rows are under 256 blocks wide
+constexpr int PREFAB_MAX_BLOCKS = 16 * 16 * 16;
+constexpr int PREFAB_MAX_ROWS = 16 * 16;
+
+// A box of blocks and which of them replace whatever's in the world. The rest only go where
+// there's air: a non-air block fills air, air leaves the world alone
+struct Stencil
+{
+    // the box's low corner relative to where the prefab is stamped
+    short x, y, z;
+    short width, height, depth;
+
+    // ordered like World::readBox
+    const uint8_t* blocks;
+
+    // 0xFF where the block replaces what's there, 0 where it only goes into air
+    const uint8_t* replace;
+
+    // per row along x, ordered the same, the first and one past the last block that changes
+    // anything. Rows that leave the world alone are skipped
+    const uint8_t* spans;
+};
+
+// rand.nextInt(bound) picks parts[picks[i]] to stamp, nothing where picks[i] is -1.
+// bound is at most PREFAB_MAX_PICKS
+struct PrefabChoice
+{
+    int bound;
+    signed char picks[PREFAB_MAX_PICKS];
+};
+
+struct Prefab
+{
+    Stencil body;
+
+    // made in order after the body's stamped, each one stamped over what came before
+    int choiceCount;
+    PrefabChoice choices[PREFAB_MAX_CHOICES];
+
+    // each inside the body's box
+    Stencil parts[PREFAB_MAX_PARTS];
+};
+
+namespace Prefabs
+{
+    // one per trunk height, anchored on the block above the grass under the trunk
+    constexpr int TREE_VARIANTS = 2;
+    extern const Prefab trees[TREE_VARIANTS];
+
+    // prefab with its anchor at x, y, z, making its choices with rand. Straight to storage and
+    // clipped to the world: like the rest of worldgen, the caller rebuilds the bricks and the rest
+    void stamp(const Prefab& prefab, Random& rand, int x, int y, int z);
+}
@@ -156,10 +156,15 @@ void Shader::cacheUniforms()
     {
         glGetActiveUniform(ID, (GLuint)i, bufSize, &length, &size, &type, name);
 
-        uniformCache.push_back(murmurHash2(name, length));
+        cacheUniform(name, length);
     }
 }
 
+void Shader::cacheUniform(const char* name, const int len)
+{
+    uniformCache.push_back(murmurHash2(name, len));
+}
+
 GLint Shader::getUniformLocation(const char* uniformName, int len) const
 {
     unsigned int hash = murmurHash2(uniformName, len);
@@ -30,9 +30,13 @@ public:
     void setVec3(const char* name, int len, const vec3& value) const;
     void setVec3(const char* name, int len, float x, float y, float z) const;
 
+    // give the uniform called name the next location, like cacheUniforms does for each one the
+    // program has. Lets the lookup run without a GL context
+    void cacheUniform(const char* name, int len);
+
+    GLint getUniformLocation(const char* uniformName, int len) const;
+
 private:
     mutable std::vector<int> uniformCache;
     void cacheUniforms();
-
-    GLint getUniformLocation(const char* uniformName, int len) const;
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "Simulation.h"
+
+#include "Trace.h"
+#include "TripleBuffer.h"
+#include "Util.h"
+
+#include <SDL/SDL.h>
+#include <atomic>
+
+// what setInput was last given
+struct SimulationInput
+{
+    uint8_t keys;
+    float yaw;
+};
+
+static TripleBuffer<SimulationInput> inputs;
+static TripleBuffer<Simulation::Snapshot> snapshots;
+
+static std::atomic<bool> running{false};
+static SDL_Thread* thread = nullptr;
+
+static void publish()
+{
+    Simulation::Snapshot& snapshot = snapshots.back();
+    snapshot.ticks = lastTicks;
+    snapshot.tickOverruns = tickOverruns;
+    snapshot.droppedTicks = droppedTicks;
+
+    snapshots.publish();
+}
+
+static int simulate(void*)
+{
+    TRACE_THREAD("simulation");
+
+    while (running.load(std::memory_order_acquire))
+    {
+        {
+            TRACE_ZONE("simulate");
+
+            inputs.update();
+            setController(inputs.front().keys, inputs.front().yaw);
+
+            if (catchUpTicks(currentTime()) > 0)
+                publish();
+        }
+
+        // sleep until the next tick is due
+        const float wait = lastTicks.time + TICK_LENGTH - currentTime();
+        if (wait > 0)
+            SDL_Delay(Uint32(wait) + 1);
+    }
+
+    return 0;
+}
+
+void Simulation::start(const float now)
+{
+    startTicks(now);
+    publish();
+
+    running.store(true, std::memory_order_release);
+    thread = SDL_CreateThread(simulate, nullptr);
+}
+
+void Simulation::stop()
+{
+    running.store(false, std::memory_order_release);
+    SDL_WaitThread(thread, nullptr);
+}
+
+void Simulation::setInput(const uint8_t keys, const float yaw)
+{
+    SimulationInput& input = inputs.back();
+    input.keys = keys;
+    input.yaw = yaw;
+
+    inputs.publish();
+}
+
+const Simulation::Snapshot& Simulation::latest()
+{
+    snapshots.update();
+    return snapshots.front();
+}
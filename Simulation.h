@@ -0,0 +1,29 @@
+#pragma once
+#include "Game.h"
+
+// Runs ticks on their own thread, so a slow tick doesn't hold a frame up and a slow frame
+// doesn't hold ticks up. The render thread sends input in and gets a Snapshot of each tick back
+namespace Simulation
+{
+    // everything a frame needs from the ticks, as of one tick
+    struct Snapshot
+    {
+        TickState ticks;
+
+        long tickOverruns;
+        long droppedTicks;
+    };
+
+    // start ticking from now (ms) on a new thread. the player is the simulation thread's from
+    // here until stop(), and only it edits the world. Read the world under World::lockEdits
+    void start(float now);
+
+    // finish the tick in progress and wait for the thread to end
+    void stop();
+
+    // the keys held and which way the camera faces, for the next ticks
+    void setInput(uint8_t keys, float yaw);
+
+    // the newest snapshot published
+    const Snapshot& latest();
+}
@@ -1,113 +1,222 @@
 #include "TextureGenerator.h"
 
 #include "Constants.h"
+#include "Jobs.h"
+#include "Trace.h"
 #include "Util.h"
 
-GLuint generateTextures(long long seed)
-{
-    // set random seed to generate textures
-    Random rand = Random(seed);
-
-    prints("Building textures... ");
-    int* textureAtlas = new int[TEXTURE_RES * TEXTURE_RES * 3 * 16];
+#include <SDL/SDL.h>
 
-    // procedurally generates the 16x3 textureAtlas
-    // gsd = grayscale detail
-    for (int blockID = 1; blockID < 16; blockID++) {
-        int gsd_tempA = 0xFF - rand.nextInt(0x60);
-
-        for (int y = 0; y < TEXTURE_RES * 3; y++) {
-            for (int x = 0; x < TEXTURE_RES; x++) {
-                // gets executed per pixel/texel
-
-                if (blockID != BLOCK_STONE || rand.nextInt(3) == 0) // if the block type is stone, update the noise value less often to get a stretched out look
-                    gsd_tempA = 0xFF - rand.nextInt(0x60);
-
-                int tint = 0x966C4A; // brown (dirt)
-                switch (blockID)
-                {
-                case BLOCK_STONE:
-                {
-                    tint = 0x7F7F7F; // grey
-                    break;
-                }
-                case BLOCK_GRASS:
-                {
-                    if (y < ((x * x * 3 + x * 81) >> 2 & 0x3) + (TEXTURE_RES * 1.125f)) // grass + grass edge
-                        tint = 0x6AAA40; // green
-                    else if (y < ((x * x * 3 + x * 81) >> 2 & 0x3) + (TEXTURE_RES * 1.1875f)) // grass edge shadow
-                        gsd_tempA = gsd_tempA * 2 / 3;
-                    break;
-                }
-                case BLOCK_WOOD:
-                {
-                    tint = 0x675231; // brown (bark)
-                    if (!(y >= TEXTURE_RES && y < TEXTURE_RES * 2) && // second row = stripes
-                        x > 0 && x < TEXTURE_RES - 1 &&
-                        ((y > 0 && y < TEXTURE_RES - 1) || (y > TEXTURE_RES * 2 && y < TEXTURE_RES * 3 - 1))) { // wood side area
-                        tint = 0xBC9862; // light brown
-
-                        // the following code repurposes 2 gsd variables making it a bit hard to read
-                        // but in short it gets the absolute distance from the tile's center in x and y direction 
-                        // finds the max of it
-                        // uses that to make the gray scale detail darker if the current pixel is part of an annual ring
-                        // and adds some noise as a finishing touch
-                        int woodCenter = TEXTURE_RES / 2 - 1;
-
-                        int dx = x - woodCenter;
-                        int dy = (y % TEXTURE_RES) - woodCenter;
-
-                        if (dx < 0)
-                            dx = 1 - dx;
-
-                        if (dy < 0)
-                            dy = 1 - dy;
-
-                        if (dy > dx)
-                            dx = dy;
-
-                        gsd_tempA = 196 - rand.nextInt(32) + dx % 3 * 32;
-                    }
-                    else if (rand.nextInt(2) == 0) {
-                        // make the gsd 50% brighter on random pixels of the bark
-                        // and 50% darker if x happens to be odd
-                        gsd_tempA = gsd_tempA * (150 - (x & 1) * 100) / 100;
-                    }
-                    break;
-                }
-                case BLOCK_BRICKS:
-                {
-                    tint = 0xB53A15; // red
-                    if ((x + y / 4 * 4) % 8 == 0 || y % 4 == 0) // gap between bricks
-                        tint = 0xBCAFA5; // reddish light grey
-                    break;
+// gsd = grayscale detail
+static void generateBlockTexture(const int blockID, Random rand, int* textureAtlas)
+{
+    int gsd_tempA = 0xFF - rand.nextInt(0x60);
+
+    for (int y = 0; y < TEXTURE_RES * 3; y++) {
+        for (int x = 0; x < TEXTURE_RES; x++) {
+            // gets executed per pixel/texel
+
+            if (blockID != BLOCK_STONE || rand.nextInt(3) == 0) // if the block type is stone, update the noise value less often to get a stretched out look
+                gsd_tempA = 0xFF - rand.nextInt(0x60);
+
+            int tint = 0x966C4A; // brown (dirt)
+            switch (blockID)
+            {
+            case BLOCK_STONE:
+            {
+                tint = 0x7F7F7F; // grey
+                break;
+            }
+            case BLOCK_GRASS:
+            {
+                if (y < ((x * x * 3 + x * 81) >> 2 & 0x3) + (TEXTURE_RES * 1.125f)) // grass + grass edge
+                    tint = 0x6AAA40; // green
+                else if (y < ((x * x * 3 + x * 81) >> 2 & 0x3) + (TEXTURE_RES * 1.1875f)) // grass edge shadow
+                    gsd_tempA = gsd_tempA * 2 / 3;
+                break;
+            }
+            case BLOCK_WOOD:
+            {
+                tint = 0x675231; // brown (bark)
+                if (!(y >= TEXTURE_RES && y < TEXTURE_RES * 2) && // second row = stripes
+                    x > 0 && x < TEXTURE_RES - 1 &&
+                    ((y > 0 && y < TEXTURE_RES - 1) || (y > TEXTURE_RES * 2 && y < TEXTURE_RES * 3 - 1))) { // wood side area
+                    tint = 0xBC9862; // light brown
+
+                    // the following code repurposes 2 gsd variables making it a bit hard to read
+                    // but in short it gets the absolute distance from the tile's center in x and y direction 
+                    // finds the max of it
+                    // uses that to make the gray scale detail darker if the current pixel is part of an annual ring
+                    // and adds some noise as a finishing touch
+                    int woodCenter = TEXTURE_RES / 2 - 1;
+
+                    int dx = x - woodCenter;
+                    int dy = (y % TEXTURE_RES) - woodCenter;
+
+                    if (dx < 0)
+                        dx = 1 - dx;
+
+                    if (dy < 0)
+                        dy = 1 - dy;
+
+                    if (dy > dx)
+                        dx = dy;
+
+                    gsd_tempA = 196 - rand.nextInt(32) + dx % 3 * 32;
                 }
+                else if (rand.nextInt(2) == 0) {
+                    // make the gsd 50% brighter on random pixels of the bark
+                    // and 50% darker if x happens to be odd
+                    gsd_tempA = gsd_tempA * (150 - (x & 1) * 100) / 100;
                 }
+                break;
+            }
+            case BLOCK_BRICKS:
+            {
+                tint = 0xB53A15; // red
+                if ((x + y / 4 * 4) % 8 == 0 || y % 4 == 0) // gap between bricks
+                    tint = 0xBCAFA5; // reddish light grey
+                break;
+            }
+            }
 
-                int gsd_constexpr = gsd_tempA;
-                if (y >= TEXTURE_RES * 2) // bottom side of the block
-                    gsd_constexpr /= 2; // make it darker, baked "shading"
+            int gsd_constexpr = gsd_tempA;
+            if (y >= TEXTURE_RES * 2) // bottom side of the block
+                gsd_constexpr /= 2; // make it darker, baked "shading"
 
-                if (blockID == BLOCK_LEAVES) {
-                    tint = 0x50D937; // green
-                    if (rand.nextInt(2) == 0) {
-                        tint = 0;
-                        gsd_constexpr = 0xFF;
-                    }
+            if (blockID == BLOCK_LEAVES) {
+                tint = 0x50D937; // green
+                if (rand.nextInt(2) == 0) {
+                    tint = 0;
+                    gsd_constexpr = 0xFF;
                 }
+            }
 
-                // multiply tint by the grayscale detail
-                const int col = ((tint & 0xFFFFFF) == 0 ? 0 : 0xFF) << 24 |
-                    (tint >> 16 & 0xFF) * gsd_constexpr / 0xFF << 16 |
-                    (tint >> 8 & 0xFF) * gsd_constexpr / 0xFF << 8 |
-                    (tint & 0xFF) * gsd_constexpr / 0xFF << 0;
+            // multiply tint by the grayscale detail
+            const int col = ((tint & 0xFFFFFF) == 0 ? 0 : 0xFF) << 24 |
+                (tint >> 16 & 0xFF) * gsd_constexpr / 0xFF << 16 |
+                (tint >> 8 & 0xFF) * gsd_constexpr / 0xFF << 8 |
+                (tint & 0xFF) * gsd_constexpr / 0xFF << 0;
 
-                // write pixel to the texture atlas
-                textureAtlas[x + (TEXTURE_RES * blockID) + y * (TEXTURE_RES * 16)] = col;
+            // write pixel to the texture atlas
+            textureAtlas[x + (TEXTURE_RES * blockID) + y * ATLAS_WIDTH] = col;
+        }
+    }
+}
+
+// how many steps of rand generateBlockTexture(blockID, rand) takes. Only stone's depends
+// on the values drawn, so that one gets walked
+static uint64_t randomDraws(const int blockID, Random rand)
+{
+    constexpr uint64_t TEXELS = TEXTURE_RES * TEXTURE_RES * 3;
+
+    if (blockID == BLOCK_STONE)
+    {
+        uint64_t draws = 1 + TEXELS;
+
+        rand.nextInt(0x60); // the first gsd
+
+        for (uint64_t i = 0; i < TEXELS; i++)
+        {
+            if (rand.nextInt(3) == 0)
+            {
+                rand.nextInt(0x60);
+                draws++;
             }
         }
+
+        return draws;
+    }
+
+    // one more per texel for the bark / rings and for the holes in the leaves
+    if (blockID == BLOCK_WOOD || blockID == BLOCK_LEAVES)
+        return 1 + TEXELS * 2;
+
+    return 1 + TEXELS;
+}
+
+void buildTextureAtlas(const long long seed, int* textureAtlas)
+{
+    // the blocks used to be drawn one after another from a single Random.
+    // find where each one started in that sequence, then draw them all at once
+    const Random rand = Random(seed);
+
+    uint64_t firstDraw[16];
+    uint64_t draws = 0;
+    for (int blockID = 1; blockID < 16; blockID++) {
+        firstDraw[blockID] = draws;
+        draws += randomDraws(blockID, rand.ahead(draws));
     }
 
+    Jobs::parallelFor(15, [&](const int i) {
+        generateBlockTexture(i + 1, rand.ahead(firstDraw[i + 1]), textureAtlas);
+    });
+}
+
+#ifdef TEXTURE_CACHE
+struct AtlasCacheHeader
+{
+    unsigned int magic;
+    int textureRes;
+    long long seed;
+};
+
+constexpr unsigned int ATLAS_CACHE_MAGIC = 0x4B34434D; // "MC4K"
+
+static bool loadAtlas(const long long seed, int* textureAtlas)
+{
+    SDL_RWops* file = SDL_RWFromFile(TEXTURE_CACHE, "rb");
+    if (file == nullptr)
+        return false;
+
+    AtlasCacheHeader header;
+    const bool hit = SDL_RWread(file, &header, sizeof(header), 1) == 1 &&
+        header.magic == ATLAS_CACHE_MAGIC && header.textureRes == TEXTURE_RES && header.seed == seed &&
+        SDL_RWread(file, textureAtlas, sizeof(int) * ATLAS_WIDTH * ATLAS_HEIGHT, 1) == 1;
+
+    SDL_RWclose(file);
+    return hit;
+}
+
+static void saveAtlas(const long long seed, const int* textureAtlas)
+{
+    SDL_RWops* file = SDL_RWFromFile(TEXTURE_CACHE, "wb");
+    if (file == nullptr)
+        return; // read-only directory or similar, just generate again next time
+
+    const AtlasCacheHeader header = { ATLAS_CACHE_MAGIC, TEXTURE_RES, seed };
+    SDL_RWwrite(file, &header, sizeof(header), 1);
+    SDL_RWwrite(file, textureAtlas, sizeof(int) * ATLAS_WIDTH * ATLAS_HEIGHT, 1);
+
+    SDL_RWclose(file);
+}
+#endif
+
+void loadTextureAtlas(const long long seed, int* textureAtlas)
+{
+#ifdef TEXTURE_CACHE
+    if (loadAtlas(seed, textureAtlas))
+    {
+        prints("Loaded cached textures... ");
+        return;
+    }
+#endif
+
+    prints("Building textures... ");
+    buildTextureAtlas(seed, textureAtlas);
+
+#ifdef TEXTURE_CACHE
+    saveAtlas(seed, textureAtlas);
+#endif
+}
+
+GLuint generateTextures(long long seed)
+{
+    TRACE_ZONE("generateTextures");
+
+    int* textureAtlas = new int[ATLAS_WIDTH * ATLAS_HEIGHT](); // block 0 is never drawn
+    loadTextureAtlas(seed, textureAtlas);
+
     GLuint textureAtlasTex = 0;
 
     prints("Uploading texture atlas to GPU... ");
@@ -119,8 +228,8 @@ GLuint generateTextures(long long seed)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, TEXTURE_RES * 16, TEXTURE_RES * 3);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_RES * 16, TEXTURE_RES * 3, GL_BGRA, GL_UNSIGNED_BYTE, textureAtlas);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, ATLAS_WIDTH, ATLAS_HEIGHT);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ATLAS_WIDTH, ATLAS_HEIGHT, GL_BGRA, GL_UNSIGNED_BYTE, textureAtlas);
     glGenerateMipmap(GL_TEXTURE_2D); // TODO needed??
     glBindTexture(GL_TEXTURE_2D, 0);
 
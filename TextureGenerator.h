@@ -1,4 +1,12 @@
 #pragma once
 #include <glad.h>
 
+// the 16x3 block atlas, ATLAS_WIDTH by ATLAS_HEIGHT texels of BGRA, one block per column of tiles.
+// The same seed always gives the same atlas, however many threads draw it
+void buildTextureAtlas(long long seed, int* textureAtlas);
+
+// buildTextureAtlas, or read it from TEXTURE_CACHE if it's been built for this seed before
+void loadTextureAtlas(long long seed, int* textureAtlas);
+
+// loadTextureAtlas and upload it
 GLuint generateTextures(long long seed);
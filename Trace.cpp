@@ -0,0 +1,171 @@
+#include "Trace.h"
+
+#ifdef TRACING
+#include <SDL/SDL.h>
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+struct Event
+{
+    const char* name;
+    uint64_t start, end;
+};
+
+// one thread's zones. Only that thread writes, dump() reads
+struct Ring
+{
+    Event events[TRACE_RING_SIZE];
+
+    // how many events were ever recorded, the ring keeps the last TRACE_RING_SIZE
+    std::atomic<unsigned int> written{0};
+
+    int threadId = 0;
+    const char* threadName = nullptr;
+};
+
+constexpr int MAX_TRACE_THREADS = 64;
+
+static std::atomic<Ring*> rings[MAX_TRACE_THREADS];
+static std::atomic<int> ringCount{0};
+
+static thread_local Ring* threadRing = nullptr;
+
+// this thread's ring, made the first time it records anything
+static Ring* ring()
+{
+    if (threadRing == nullptr)
+    {
+        const int index = ringCount++;
+        if (index >= MAX_TRACE_THREADS)
+            return nullptr; // too many threads, the rest go untraced
+
+        threadRing = new Ring;
+        threadRing->threadId = index;
+        rings[index] = threadRing;
+    }
+
+    return threadRing;
+}
+
+uint64_t Trace::now()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    // split up so the multiplication doesn't overflow
+    const uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+    const uint64_t rest = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000 + rest * 1000000000 / frequency.QuadPart;
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+#endif
+}
+
+void Trace::record(const char* name, const uint64_t start, const uint64_t end)
+{
+    Ring* r = ring();
+    if (r == nullptr)
+        return;
+
+    const unsigned int n = r->written.load(std::memory_order_relaxed);
+
+    // the last store to written goes out before this slot changes, so dump() can tell it has
+    std::atomic_thread_fence(std::memory_order_release);
+
+    r->events[n % TRACE_RING_SIZE] = { name, start, end };
+    r->written.store(n + 1, std::memory_order_release);
+}
+
+void Trace::nameThread(const char* name)
+{
+    Ring* r = ring();
+    if (r != nullptr)
+        r->threadName = name;
+}
+
+// copy event n of r, false if the thread has come round the ring and written over it since,
+// or is in the middle of it
+static bool readEvent(const Ring* r, const unsigned int n, Event& event)
+{
+    event = r->events[n % TRACE_RING_SIZE];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return r->written.load(std::memory_order_relaxed) - n < TRACE_RING_SIZE;
+}
+
+bool Trace::dump(const char* path)
+{
+    SDL_RWops* file = SDL_RWFromFile(path, "wb");
+    if (file == nullptr)
+        return false;
+
+    char line[256];
+    const auto write = [&](const int length) { SDL_RWwrite(file, line, 1, length); };
+
+    const int threads = ringCount < MAX_TRACE_THREADS ? int(ringCount) : MAX_TRACE_THREADS;
+
+    // the threads may still be recording, only read what each had finished when we started
+    unsigned int written[MAX_TRACE_THREADS];
+    for (int i = 0; i < threads; i++)
+    {
+        const Ring* r = rings[i];
+        written[i] = r == nullptr ? 0 : r->written.load(std::memory_order_acquire);
+    }
+
+    // timestamps from the earliest start of the events still there, in microseconds like the
+    // format wants. Zones are recorded when they end, so that's not always the oldest slot
+    uint64_t origin = ~uint64_t(0);
+    for (int i = 0; i < threads; i++)
+    {
+        Event event;
+        for (unsigned int n = written[i] > TRACE_RING_SIZE ? written[i] - TRACE_RING_SIZE : 0; n < written[i]; n++)
+            if (readEvent(rings[i], n, event) && event.start < origin)
+                origin = event.start;
+    }
+
+    write(snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"));
+
+    bool first = true;
+    for (int i = 0; i < threads; i++)
+    {
+        const Ring* r = rings[i];
+        if (r == nullptr)
+            continue;
+
+        if (r->threadName != nullptr)
+        {
+            write(snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", r->threadId, r->threadName));
+            first = false;
+        }
+
+        // anything written over since the pass above is left out, the rest started after origin
+        for (unsigned int n = written[i] > TRACE_RING_SIZE ? written[i] - TRACE_RING_SIZE : 0; n < written[i]; n++)
+        {
+            Event event;
+            if (!readEvent(r, n, event))
+                continue;
+
+            write(snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", event.name, r->threadId,
+                (event.start - origin) / 1000.0, (event.end - event.start) / 1000.0));
+            first = false;
+        }
+    }
+
+    write(snprintf(line, sizeof(line), "\n]}\n"));
+
+    SDL_RWclose(file);
+    return true;
+}
+#endif
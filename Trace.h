@@ -0,0 +1,48 @@
+#pragma once
+#include "Constants.h"
+
+// Timing zones for profiling. Each thread records into its own ring buffer without locking,
+// dump() writes them all out as a Chrome trace (open it in chrome://tracing or ui.perfetto.dev).
+// Everything here compiles to nothing unless TRACING is defined
+#ifdef TRACING
+namespace Trace
+{
+    // nanoseconds on a monotonic clock
+    uint64_t now();
+
+    // a zone that ran from start to end on this thread. name has to outlive the trace (use a literal)
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // what to call this thread in the trace
+    void nameThread(const char* name);
+
+    // write the last TRACE_RING_SIZE zones of every thread to path
+    bool dump(const char* path);
+
+    // records the time from construction to destruction
+    struct Zone
+    {
+        const char* name;
+        uint64_t start;
+
+        Zone(const char* name) : name(name), start(now()) {}
+
+        ~Zone()
+        {
+            record(name, start, now());
+        }
+    };
+}
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+
+// time the rest of the enclosing scope
+#define TRACE_ZONE(name) Trace::Zone TRACE_JOIN(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::nameThread(name)
+#define TRACE_DUMP() Trace::dump(TRACE_FILE)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_THREAD(name)
+#define TRACE_DUMP()
+#endif
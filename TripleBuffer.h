@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the latest T from one thread to another without locking or waiting. The writer fills
+// back() and publish()es it, the reader update()s and reads front(). There's always a spare slot
+// between them so neither ever touches the one the other has, and the reader skips straight
+// to the newest one if it missed some
+template<typename T>
+struct TripleBuffer
+{
+    T slots[3] = {};
+
+    // set on middle when it holds something the reader hasn't seen
+    static constexpr int FRESH = 4;
+
+    int writing = 0;
+    std::atomic<int> middle{1};
+    int reading = 2;
+
+    // the slot to write the next T into. writer only
+    T& back()
+    {
+        return slots[writing];
+    }
+
+    // make back() the newest T and start a new back(). writer only
+    void publish()
+    {
+        writing = middle.exchange(writing | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+
+    // move front() on to the newest published T, true if there was a new one. reader only
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+
+        reading = middle.exchange(reading, std::memory_order_acq_rel) & ~FRESH;
+        return true;
+    }
+
+    // the newest T as of the last update(). reader only
+    const T& front() const
+    {
+        return slots[reading];
+    }
+};
@@ -1,6 +1,17 @@
 #include "Util.h"
 #include <cmath>
 
+// batched Perlin noise kernels. SSE2 is always there on x86-64, AVX2 is picked at runtime
+#ifdef X86_SIMD
+#define PERLIN_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 #include <SDL/SDL.h>
 
 float currentTime()
@@ -43,6 +54,30 @@ uint64_t Random::uniqueSeed()
     }
 }
 
+void Random::jump(uint64_t n, uint64_t& mul, uint64_t& add)
+{
+    // stepping is x -> x * m + a, so stepping twice is x -> x * m^2 + a * (m + 1).
+    // square that for every bit of n, like pow() by squaring. Everything is mod 2^48 in the end
+    uint64_t stepMul = multiplier;
+    uint64_t stepAdd = addend;
+
+    mul = 1;
+    add = 0;
+
+    while (n != 0)
+    {
+        if (n & 1)
+        {
+            mul = mul * stepMul;
+            add = add * stepMul + stepAdd;
+        }
+
+        stepAdd = stepAdd * (stepMul + 1);
+        stepMul = stepMul * stepMul;
+        n >>= 1;
+    }
+}
+
 int Random::next(const int bits)
 {
     seed = (seed * multiplier + addend) & mask;
@@ -94,11 +129,98 @@ uint32_t Random::nextInt(const uint32_t bound)
         return ((uint64_t) (next(32)) << 32) + next(32);
     }
 
+void Random::nextInts(const uint32_t bound, uint32_t* out, const int count)
+{
+    // the unsigned rejection test in nextInt(bound) never passes, so every value is exactly
+    // one step and value i only depends on seed i. Run four generators each four steps
+    // apart, then the multiplies don't have to wait on each other
+    uint64_t mul4, add4;
+    jump(4, mul4, add4);
+
+    uint64_t s0 = (seed * multiplier + addend) & mask;
+    uint64_t s1 = (s0 * multiplier + addend) & mask;
+    uint64_t s2 = (s1 * multiplier + addend) & mask;
+    uint64_t s3 = (s2 * multiplier + addend) & mask;
+
+    // 0 counts as a power of two, and comes out as all zeros like nextInt(0)
+    const bool powerOfTwo = (bound & (bound - 1)) == 0;
+
+#ifdef __SIZEOF_INT128__
+    // r % bound as two multiplies (Lemire's fastmod), exact for 32 bit r and bound
+    const uint64_t inverse = powerOfTwo ? 0 : ~uint64_t(0) / bound + 1;
+#define MOD_BOUND(r) uint32_t((unsigned __int128)(inverse * (r)) * bound >> 64)
+#else
+#define MOD_BOUND(r) ((r) % bound)
+#endif
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint32_t r0 = uint32_t(s0 >> 17);
+        const uint32_t r1 = uint32_t(s1 >> 17);
+        const uint32_t r2 = uint32_t(s2 >> 17);
+        const uint32_t r3 = uint32_t(s3 >> 17);
+
+        if (powerOfTwo)
+        {
+            out[i + 0] = uint32_t(bound * uint64_t(r0) >> 31);
+            out[i + 1] = uint32_t(bound * uint64_t(r1) >> 31);
+            out[i + 2] = uint32_t(bound * uint64_t(r2) >> 31);
+            out[i + 3] = uint32_t(bound * uint64_t(r3) >> 31);
+        }
+        else
+        {
+            out[i + 0] = MOD_BOUND(r0);
+            out[i + 1] = MOD_BOUND(r1);
+            out[i + 2] = MOD_BOUND(r2);
+            out[i + 3] = MOD_BOUND(r3);
+        }
+
+        seed = s3;
+
+        s0 = (s0 * mul4 + add4) & mask;
+        s1 = (s1 * mul4 + add4) & mask;
+        s2 = (s2 * mul4 + add4) & mask;
+        s3 = (s3 * mul4 + add4) & mask;
+    }
+
+#undef MOD_BOUND
+
+    for (; i < count; i++)
+        out[i] = nextInt(bound);
+}
+
 void Random::setSeed(const uint64_t newSeed)
 {
     seed = initialScramble(newSeed);
 }
 
+void Random::advance(const uint64_t n)
+{
+    uint64_t mul, add;
+    jump(n, mul, add);
+
+    seed = (seed * mul + add) & mask;
+}
+
+Random Random::ahead(const uint64_t n) const
+{
+    Random copy = *this;
+    copy.advance(n);
+
+    return copy;
+}
+
+Random Random::substream(const uint64_t index) const
+{
+    // splitmix64 of the state and index, so neighbouring indices land far apart
+    uint64_t h = seed + (index + 1) * 0x9E3779B97F4A7C15;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+
+    return Random(h ^ (h >> 31));
+}
+
 // Perlin noise
 
 float scaled_cosine(const float i) {
@@ -117,13 +239,52 @@ constexpr int PERLIN_ZWRAP = 1 << PERLIN_ZWRAPB;
 
 float perlin[PERLIN_RES + 1];
 
-float Perlin::noise(float x, float y) { // stolen from Processing
-    if (perlin[0] == 0) {
-        Random r = Random(18295169L);
+#ifdef PERLIN_SIMD
+static bool useAVX2 = false;
 
-        for (float& i : perlin)
-            i = r.nextFloat();
+bool hasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1;
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] >> 5) & 1;
+
+    const bool ymmSaved = osxsave && (_xgetbv(0) & 6) == 6;
+#else
+    unsigned int a, b, c, d;
+    __cpuid(1, a, b, c, d);
+    const bool osxsave = (c >> 27) & 1, avx = (c >> 28) & 1;
+    __cpuid_count(7, 0, a, b, c, d);
+    const bool avx2 = (b >> 5) & 1;
+
+    bool ymmSaved = false;
+    if (osxsave)
+    {
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        ymmSaved = (a & 6) == 6;
     }
+#endif
+
+    // the OS has to save the ymm registers for us too
+    return avx && avx2 && ymmSaved;
+}
+#endif
+
+void Perlin::init()
+{
+    Random r = Random(18295169L);
+
+    for (float& i : perlin)
+        i = r.nextFloat();
+
+#ifdef PERLIN_SIMD
+    useAVX2 = hasAVX2();
+#endif
+}
+
+float Perlin::noise(float x, float y) { // stolen from Processing
 
     if (x < 0)
         x = -x;
@@ -186,6 +347,277 @@ float Perlin::noise(vec2 pos)
     return noise(pos.x, pos.y);
 }
 
+// The batched noise below is noise() without its second z plane, which is always weighted by
+// scaled_cosine(0) = 0, and with a polynomial fade: 0.5 - 0.5 cos(pi t) = 0.5 + 0.5 sin(pi (t - 0.5)),
+// with the sine fitted by a degree 7 polynomial (at most 3e-7 off).
+// All kernels do exactly the same float operations in the same order, so they agree to the bit
+
+constexpr float FADE_C1 = 1.57079101f;
+constexpr float FADE_C3 = -2.58357139f;
+constexpr float FADE_C5 = 1.27094945f;
+constexpr float FADE_C7 = -0.277317939f;
+
+#ifndef PERLIN_SIMD
+static float polynomialFade(const float t)
+{
+    const float u = t - 0.5f;
+    const float u2 = u * u;
+
+    return 0.5f + u * (FADE_C1 + u2 * (FADE_C3 + u2 * (FADE_C5 + u2 * FADE_C7)));
+}
+
+static float noiseSample(float x, float y)
+{
+    if (x < 0)
+        x = -x;
+    if (y < 0)
+        y = -y;
+
+    int xi = int(x);
+    int yi = int(y);
+
+    float xf = x - float(xi);
+    float yf = y - float(yi);
+
+    float r = 0;
+    float ampl = 0.5f;
+
+    for (int i = 0; i < PERLIN_OCTAVES; i++) {
+        const int of = xi + (yi << PERLIN_YWRAPB);
+
+        const float rxf = polynomialFade(xf);
+        const float ryf = polynomialFade(yf);
+
+        float n1 = perlin[of & (PERLIN_RES - 1)];
+        n1 = n1 + rxf * (perlin[(of + 1) & (PERLIN_RES - 1)] - n1);
+        float n2 = perlin[(of + PERLIN_YWRAP) & (PERLIN_RES - 1)];
+        n2 = n2 + rxf * (perlin[(of + PERLIN_YWRAP + 1) & (PERLIN_RES - 1)] - n2);
+        n1 = n1 + ryf * (n2 - n1);
+
+        r = r + n1 * ampl;
+        ampl *= PERLIN_AMP_FALLOFF;
+        xi <<= 1;
+        xf = xf * 2;
+        yi <<= 1;
+        yf = yf * 2;
+
+        if (xf >= 1.0f) {
+            xi++;
+            xf = xf - 1.0f;
+        }
+
+        if (yf >= 1.0f) {
+            yi++;
+            yf = yf - 1.0f;
+        }
+    }
+
+    return r;
+}
+
+static void noiseRow(const float x0, const float y, const float step, const int width, float* out)
+{
+    for (int i = 0; i < width; i++)
+        out[i] = noiseSample(x0 + float(i) * step, y);
+}
+#else
+static __m128 polynomialFade4(const __m128 t)
+{
+    const __m128 u = _mm_sub_ps(t, _mm_set1_ps(0.5f));
+    const __m128 u2 = _mm_mul_ps(u, u);
+
+    __m128 p = _mm_add_ps(_mm_set1_ps(FADE_C5), _mm_mul_ps(u2, _mm_set1_ps(FADE_C7)));
+    p = _mm_add_ps(_mm_set1_ps(FADE_C3), _mm_mul_ps(u2, p));
+    p = _mm_add_ps(_mm_set1_ps(FADE_C1), _mm_mul_ps(u2, p));
+
+    return _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(u, p));
+}
+
+// no gather before AVX2, so look the 4 lanes up one by one
+static __m128 lookup4(const __m128i of)
+{
+    alignas(16) int index[4];
+    _mm_store_si128((__m128i*)index, _mm_and_si128(of, _mm_set1_epi32(PERLIN_RES - 1)));
+
+    return _mm_setr_ps(perlin[index[0]], perlin[index[1]], perlin[index[2]], perlin[index[3]]);
+}
+
+static __m128 noise4(__m128 x, __m128 y)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // abs
+    x = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    y = _mm_andnot_ps(_mm_set1_ps(-0.0f), y);
+
+    __m128i xi = _mm_cvttps_epi32(x);
+    __m128i yi = _mm_cvttps_epi32(y);
+
+    __m128 xf = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+    __m128 yf = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+
+    __m128 r = _mm_setzero_ps();
+    float ampl = 0.5f;
+
+    for (int i = 0; i < PERLIN_OCTAVES; i++) {
+        const __m128i of = _mm_add_epi32(xi, _mm_slli_epi32(yi, PERLIN_YWRAPB));
+
+        const __m128 rxf = polynomialFade4(xf);
+        const __m128 ryf = polynomialFade4(yf);
+
+        __m128 n1 = lookup4(of);
+        n1 = _mm_add_ps(n1, _mm_mul_ps(rxf, _mm_sub_ps(lookup4(_mm_add_epi32(of, _mm_set1_epi32(1))), n1)));
+        __m128 n2 = lookup4(_mm_add_epi32(of, _mm_set1_epi32(PERLIN_YWRAP)));
+        n2 = _mm_add_ps(n2, _mm_mul_ps(rxf, _mm_sub_ps(lookup4(_mm_add_epi32(of, _mm_set1_epi32(PERLIN_YWRAP + 1))), n2)));
+        n1 = _mm_add_ps(n1, _mm_mul_ps(ryf, _mm_sub_ps(n2, n1)));
+
+        r = _mm_add_ps(r, _mm_mul_ps(n1, _mm_set1_ps(ampl)));
+        ampl *= PERLIN_AMP_FALLOFF;
+        xi = _mm_slli_epi32(xi, 1);
+        xf = _mm_mul_ps(xf, _mm_set1_ps(2.0f));
+        yi = _mm_slli_epi32(yi, 1);
+        yf = _mm_mul_ps(yf, _mm_set1_ps(2.0f));
+
+        // the compare mask is -1 where xf >= 1, so subtracting it increments xi
+        const __m128 xCarry = _mm_cmpge_ps(xf, one);
+        xi = _mm_sub_epi32(xi, _mm_castps_si128(xCarry));
+        xf = _mm_sub_ps(xf, _mm_and_ps(xCarry, one));
+
+        const __m128 yCarry = _mm_cmpge_ps(yf, one);
+        yi = _mm_sub_epi32(yi, _mm_castps_si128(yCarry));
+        yf = _mm_sub_ps(yf, _mm_and_ps(yCarry, one));
+    }
+
+    return r;
+}
+
+static void noiseRowSSE(const float x0, const float y, const float step, const int width, float* out)
+{
+    for (int i = 0; i < width; i += 4)
+    {
+        const __m128 lane = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_setr_epi32(0, 1, 2, 3)));
+        const __m128 x = _mm_add_ps(_mm_set1_ps(x0), _mm_mul_ps(lane, _mm_set1_ps(step)));
+        const __m128 n = noise4(x, _mm_set1_ps(y));
+
+        if (i + 4 <= width)
+        {
+            _mm_storeu_ps(out + i, n);
+        }
+        else
+        {
+            alignas(16) float rest[4];
+            _mm_store_ps(rest, n);
+            for (int j = i; j < width; j++)
+                out[j] = rest[j - i];
+        }
+    }
+}
+
+TARGET_AVX2 static __m256 polynomialFade8(const __m256 t)
+{
+    const __m256 u = _mm256_sub_ps(t, _mm256_set1_ps(0.5f));
+    const __m256 u2 = _mm256_mul_ps(u, u);
+
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(FADE_C5), _mm256_mul_ps(u2, _mm256_set1_ps(FADE_C7)));
+    p = _mm256_add_ps(_mm256_set1_ps(FADE_C3), _mm256_mul_ps(u2, p));
+    p = _mm256_add_ps(_mm256_set1_ps(FADE_C1), _mm256_mul_ps(u2, p));
+
+    return _mm256_add_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(u, p));
+}
+
+TARGET_AVX2 static __m256 lookup8(const __m256i of)
+{
+    return _mm256_i32gather_ps(perlin, _mm256_and_si256(of, _mm256_set1_epi32(PERLIN_RES - 1)), 4);
+}
+
+TARGET_AVX2 static __m256 noise8(__m256 x, __m256 y)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    // abs
+    x = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+    y = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), y);
+
+    __m256i xi = _mm256_cvttps_epi32(x);
+    __m256i yi = _mm256_cvttps_epi32(y);
+
+    __m256 xf = _mm256_sub_ps(x, _mm256_cvtepi32_ps(xi));
+    __m256 yf = _mm256_sub_ps(y, _mm256_cvtepi32_ps(yi));
+
+    __m256 r = _mm256_setzero_ps();
+    float ampl = 0.5f;
+
+    for (int i = 0; i < PERLIN_OCTAVES; i++) {
+        const __m256i of = _mm256_add_epi32(xi, _mm256_slli_epi32(yi, PERLIN_YWRAPB));
+
+        const __m256 rxf = polynomialFade8(xf);
+        const __m256 ryf = polynomialFade8(yf);
+
+        __m256 n1 = lookup8(of);
+        n1 = _mm256_add_ps(n1, _mm256_mul_ps(rxf, _mm256_sub_ps(lookup8(_mm256_add_epi32(of, _mm256_set1_epi32(1))), n1)));
+        __m256 n2 = lookup8(_mm256_add_epi32(of, _mm256_set1_epi32(PERLIN_YWRAP)));
+        n2 = _mm256_add_ps(n2, _mm256_mul_ps(rxf, _mm256_sub_ps(lookup8(_mm256_add_epi32(of, _mm256_set1_epi32(PERLIN_YWRAP + 1))), n2)));
+        n1 = _mm256_add_ps(n1, _mm256_mul_ps(ryf, _mm256_sub_ps(n2, n1)));
+
+        r = _mm256_add_ps(r, _mm256_mul_ps(n1, _mm256_set1_ps(ampl)));
+        ampl *= PERLIN_AMP_FALLOFF;
+        xi = _mm256_slli_epi32(xi, 1);
+        xf = _mm256_mul_ps(xf, _mm256_set1_ps(2.0f));
+        yi = _mm256_slli_epi32(yi, 1);
+        yf = _mm256_mul_ps(yf, _mm256_set1_ps(2.0f));
+
+        const __m256 xCarry = _mm256_cmp_ps(xf, one, _CMP_GE_OQ);
+        xi = _mm256_sub_epi32(xi, _mm256_castps_si256(xCarry));
+        xf = _mm256_sub_ps(xf, _mm256_and_ps(xCarry, one));
+
+        const __m256 yCarry = _mm256_cmp_ps(yf, one, _CMP_GE_OQ);
+        yi = _mm256_sub_epi32(yi, _mm256_castps_si256(yCarry));
+        yf = _mm256_sub_ps(yf, _mm256_and_ps(yCarry, one));
+    }
+
+    return r;
+}
+
+TARGET_AVX2 static void noiseRowAVX2(const float x0, const float y, const float step, const int width, float* out)
+{
+    for (int i = 0; i < width; i += 8)
+    {
+        const __m256 lane = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+        const __m256 x = _mm256_add_ps(_mm256_set1_ps(x0), _mm256_mul_ps(lane, _mm256_set1_ps(step)));
+        const __m256 n = noise8(x, _mm256_set1_ps(y));
+
+        if (i + 8 <= width)
+        {
+            _mm256_storeu_ps(out + i, n);
+        }
+        else
+        {
+            alignas(32) float rest[8];
+            _mm256_store_ps(rest, n);
+            for (int j = i; j < width; j++)
+                out[j] = rest[j - i];
+        }
+    }
+}
+#endif
+
+void Perlin::noiseGrid(const float x0, const float y0, const float step, const int width, const int height, float* out)
+{
+    for (int j = 0; j < height; j++)
+    {
+        const float y = y0 + float(j) * step;
+
+#ifdef PERLIN_SIMD
+        if (useAVX2)
+            noiseRowAVX2(x0, y, step, width, out + j * width);
+        else
+            noiseRowSSE(x0, y, step, width, out + j * width);
+#else
+        noiseRow(x0, y, step, width, out + j * width);
+#endif
+    }
+}
+
 float clamp(float val, const float min, const float max)
 {
     if (val < min)
@@ -237,7 +669,7 @@ float degrees(float rad)
     return v < 0 ? -v : v;
 }*/
 
-bool sign(float v)
+float sign(float v)
 {
     return (0 < v) - (v < 0);
 }
@@ -7,6 +7,19 @@
 
 float currentTime();
 
+// x86-64 always has SSE2. Functions using AVX2 are marked TARGET_AVX2 and only called if hasAVX2()
+#if defined(__x86_64__) || defined(_M_X64)
+#define X86_SIMD
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// the CPU has AVX2 and the OS saves the ymm registers
+bool hasAVX2();
+#endif
+
 constexpr float PI = 3.14159265359f;
 
 // It's just the Java Random class
@@ -24,6 +37,9 @@ class Random
 
     static uint64_t uniqueSeed();
 
+    // the multiplier and addend that take the seed n steps forward in one go
+    static void jump(uint64_t n, uint64_t& mul, uint64_t& add);
+
     int next(int bits);
 
 public:
@@ -44,17 +60,42 @@ public:
 
     uint64_t nextLong();
 
+    // out[i] = nextInt(bound) for i in [0, count), with a few generators interleaved.
+    // A bound of 0 gives zeros, the same as nextInt
+    void nextInts(uint32_t bound, uint32_t* out, int count);
+
 
     void setSeed(uint64_t newSeed);
+
+    // skip n steps in O(log n). Every next*() call is one step except nextLong and the
+    // vector ones, which are two
+    void advance(uint64_t n);
+
+    // a copy that's n steps ahead, so work split across threads can carry on the
+    // exact sequence a serial loop would have drawn from this one
+    Random ahead(uint64_t n) const;
+
+    // a new generator for substream `index`, seeded from this one's state. Substreams
+    // don't overlap in any practical sense and don't depend on the order they're made in
+    Random substream(uint64_t index) const;
 };
 
 // It's just Perlin from Processing
 namespace Perlin
 {
+    // fill the random table and pick the fastest batch kernel for this CPU. call once at startup
+    void init();
+
     float noise(vec2 pos);
     float noise(float x, float y);
+
+    // out[i + j * width] = noise(x0 + i * step, y0 + j * step), several samples at a time with SSE or AVX2.
+    // Fades with a polynomial instead of a cosine, so it's up to NOISE_GRID_TOLERANCE away from noise()
+    void noiseGrid(float x0, float y0, float step, int width, int height, float* out);
 }
 
+constexpr float NOISE_GRID_TOLERANCE = 1e-5f;
+
 float clamp(float val, float min, float max);
 
 bool glError();
@@ -72,7 +113,7 @@ float degrees(float rad);
 
 int roundFloat(float v);
 //float abs(float v);
-bool sign(float v);
+float sign(float v);
 float fract(float v);
 float pow(float v, int p);
 float mod(float v, float d);
@@ -51,12 +51,10 @@ vec3 vec3::sign()
 
 vec3 vec3::abs()
 {
-    using ::abs;
-
     return vec3(
-        abs(x),
-        abs(y),
-        abs(z)
+        fabsf(x),
+        fabsf(y),
+        fabsf(z)
     );
 }
 
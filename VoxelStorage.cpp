@@ -0,0 +1,171 @@
+#include "VoxelStorage.h"
+
+static int readIndex(const uint8_t* indices, const int bits, const int i)
+{
+    const int bit = i * bits;
+    return (indices[bit >> 3] >> (bit & 7)) & ((1 << bits) - 1);
+}
+
+static void writeIndex(uint8_t* indices, const int bits, const int i, const int index)
+{
+    const int bit = i * bits;
+    const int mask = ((1 << bits) - 1) << (bit & 7);
+
+    indices[bit >> 3] = (indices[bit >> 3] & ~mask) | (index << (bit & 7));
+}
+
+static int bitsForPaletteSize(const int paletteSize)
+{
+    if (paletteSize <= 2)
+        return 1;
+    if (paletteSize <= 4)
+        return 2;
+    if (paletteSize <= 16)
+        return 4;
+
+    return 8;
+}
+
+void ChunkedStorage::repack(Section& s, const int newBits)
+{
+    const int paletteCapacity = 1 << newBits;
+    const int indicesSize = SECTION_VOLUME * newBits / 8;
+
+    uint8_t* palette = new uint8_t[paletteCapacity + indicesSize]();
+    uint8_t* indices = palette + paletteCapacity;
+
+    if (s.bits == 0) // uniform section, every index points at its only block
+    {
+        palette[0] = s.block;
+        s.paletteSize = 1;
+    }
+    else
+    {
+        for (int i = 0; i < s.paletteSize; i++)
+            palette[i] = s.palette[i];
+
+        for (int i = 0; i < SECTION_VOLUME; i++)
+            writeIndex(indices, newBits, i, readIndex(s.indices, s.bits, i));
+
+        delete[] s.palette;
+    }
+
+    s.bits = newBits;
+    s.palette = palette;
+    s.indices = indices;
+}
+
+ChunkedStorage::~ChunkedStorage()
+{
+    for (int i = 0; i < SECTIONS_X * SECTIONS_Y * SECTIONS_Z; i++)
+        delete[] sections[i].palette;
+
+    delete[] sections;
+}
+
+void ChunkedStorage::set(const int x, const int y, const int z, const uint8_t block)
+{
+    Section& s = sections[(x >> 4) + (y >> 4) * SECTIONS_X + (z >> 4) * SECTIONS_X * SECTIONS_Y];
+
+    if (s.bits == 0)
+    {
+        if (s.block == block)
+            return;
+
+        repack(s, 1);
+    }
+
+    int index = 0;
+    while (index < s.paletteSize && s.palette[index] != block)
+        index++;
+
+    if (index == s.paletteSize) // new block for this section
+    {
+        if (index == 1 << s.bits)
+            repack(s, s.bits * 2);
+
+        s.palette[s.paletteSize++] = block;
+    }
+
+    writeIndex(s.indices, s.bits,
+        (x & 15) + (y & 15) * SECTION_SIZE + (z & 15) * SECTION_SIZE * SECTION_SIZE, index);
+}
+
+void ChunkedStorage::compact()
+{
+    for (int i = 0; i < SECTIONS_X * SECTIONS_Y * SECTIONS_Z; i++)
+    {
+        Section& s = sections[i];
+
+        if (s.bits == 0)
+            continue;
+
+        // find which palette entries are still referenced
+        bool used[256] = {};
+        for (int j = 0; j < SECTION_VOLUME; j++)
+            used[readIndex(s.indices, s.bits, j)] = true;
+
+        uint8_t remap[256];
+        int usedCount = 0;
+        for (int j = 0; j < s.paletteSize; j++)
+        {
+            if (used[j])
+                remap[j] = usedCount++;
+        }
+
+        if (usedCount == s.paletteSize)
+            continue;
+
+        if (usedCount == 1)
+        {
+            uint8_t block = BLOCK_AIR;
+            for (int j = 0; j < s.paletteSize; j++)
+            {
+                if (used[j])
+                    block = s.palette[j];
+            }
+
+            delete[] s.palette;
+
+            s = Section();
+            s.block = block;
+            continue;
+        }
+
+        const int newBits = bitsForPaletteSize(usedCount);
+
+        uint8_t* palette = new uint8_t[(1 << newBits) + SECTION_VOLUME * newBits / 8]();
+        uint8_t* indices = palette + (1 << newBits);
+
+        for (int j = 0; j < s.paletteSize; j++)
+        {
+            if (used[j])
+                palette[remap[j]] = s.palette[j];
+        }
+
+        for (int j = 0; j < SECTION_VOLUME; j++)
+            writeIndex(indices, newBits, j, remap[readIndex(s.indices, s.bits, j)]);
+
+        delete[] s.palette;
+
+        s.bits = newBits;
+        s.paletteSize = usedCount;
+        s.palette = palette;
+        s.indices = indices;
+    }
+}
+
+unsigned long ChunkedStorage::memoryUsage() const
+{
+    unsigned long total = sizeof(Section) * SECTIONS_X * SECTIONS_Y * SECTIONS_Z;
+
+    for (int i = 0; i < SECTIONS_X * SECTIONS_Y * SECTIONS_Z; i++)
+    {
+        const Section& s = sections[i];
+
+        if (s.bits != 0)
+            total += (1 << s.bits) + SECTION_VOLUME * s.bits / 8;
+    }
+
+    return total;
+}
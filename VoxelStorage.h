@@ -0,0 +1,260 @@
+#pragma once
+#include "Constants.h"
+
+#include <cstring>
+
+// Memory layouts for FlatStorage, each maps a block position to its index in the array
+
+// x-major then y then z (the same order as the GPU world texture)
+struct LinearLayout
+{
+    static constexpr const char* name = "linear";
+
+    // a row of blocks along x is one run of memory
+    static constexpr bool CONTIGUOUS_X = true;
+
+    static int index(const int x, const int y, const int z)
+    {
+        return x + y * WORLD_SIZE + z * WORLD_SIZE * WORLD_HEIGHT;
+    }
+};
+
+// y-major, so each (x, z) column is contiguous
+struct ColumnLayout
+{
+    static constexpr const char* name = "column";
+
+    static constexpr bool CONTIGUOUS_X = false;
+
+    static int index(const int x, const int y, const int z)
+    {
+        return y + x * WORLD_HEIGHT + z * WORLD_HEIGHT * WORLD_SIZE;
+    }
+};
+
+// Z-order curve inside WORLD_HEIGHT^3 cubes, cubes are laid out x then z
+struct MortonLayout
+{
+    static_assert((WORLD_HEIGHT & (WORLD_HEIGHT - 1)) == 0 && WORLD_SIZE % WORLD_HEIGHT == 0,
+        "MortonLayout needs a power of two WORLD_HEIGHT that divides WORLD_SIZE");
+
+    static constexpr const char* name = "morton";
+
+    static constexpr bool CONTIGUOUS_X = false;
+
+    // put two zero bits between each of the low 10 bits
+    static unsigned int spread(unsigned int v)
+    {
+        v = (v | (v << 16)) & 0x030000FF;
+        v = (v | (v << 8)) & 0x0300F00F;
+        v = (v | (v << 4)) & 0x030C30C3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    static int index(const int x, const int y, const int z)
+    {
+        constexpr unsigned int CUBE_MASK = WORLD_HEIGHT - 1;
+        constexpr int CUBE_VOLUME = WORLD_HEIGHT * WORLD_HEIGHT * WORLD_HEIGHT;
+
+        const unsigned int cube = unsigned(x) / WORLD_HEIGHT + unsigned(z) / WORLD_HEIGHT * (WORLD_SIZE / WORLD_HEIGHT);
+
+        return cube * CUBE_VOLUME + (spread(x & CUBE_MASK) | spread(y) << 1 | spread(z & CUBE_MASK) << 2);
+    }
+};
+
+// 4x4x4 tiles stored contiguously, tiles are laid out like LinearLayout
+struct TiledLayout
+{
+    static constexpr const char* name = "tiled";
+
+    static constexpr bool CONTIGUOUS_X = false;
+
+    static constexpr int TILE_SIZE = 4;
+
+    static int index(const int x, const int y, const int z)
+    {
+        const int tile = (x >> 2) + (y >> 2) * (WORLD_SIZE / TILE_SIZE) + (z >> 2) * (WORLD_SIZE / TILE_SIZE) * (WORLD_HEIGHT / TILE_SIZE);
+
+        return tile * TILE_SIZE * TILE_SIZE * TILE_SIZE + ((x & 3) | (y & 3) << 2 | (z & 3) << 4);
+    }
+};
+
+// One byte per block, ordered by Layout
+template<typename Layout>
+class FlatStorage
+{
+    uint8_t* blocks = new uint8_t[WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE];
+
+public:
+    ~FlatStorage()
+    {
+        delete[] blocks;
+    }
+
+    uint8_t get(const int x, const int y, const int z) const
+    {
+        return blocks[Layout::index(x, y, z)];
+    }
+
+    void set(const int x, const int y, const int z, const uint8_t block)
+    {
+        blocks[Layout::index(x, y, z)] = block;
+    }
+
+    // count blocks along x from (x, y, z), one memcpy/memset when the layout keeps them together
+    void readRow(const int x, const int y, const int z, const int count, uint8_t* out) const
+    {
+        if (Layout::CONTIGUOUS_X)
+        {
+            std::memcpy(out, blocks + Layout::index(x, y, z), count);
+            return;
+        }
+
+        for (int i = 0; i < count; i++)
+            out[i] = blocks[Layout::index(x + i, y, z)];
+    }
+
+    void writeRow(const int x, const int y, const int z, const int count, const uint8_t* in)
+    {
+        if (Layout::CONTIGUOUS_X)
+        {
+            std::memcpy(blocks + Layout::index(x, y, z), in, count);
+            return;
+        }
+
+        for (int i = 0; i < count; i++)
+            blocks[Layout::index(x + i, y, z)] = in[i];
+    }
+
+    void fillRow(const int x, const int y, const int z, const int count, const uint8_t block)
+    {
+        if (Layout::CONTIGUOUS_X)
+        {
+            std::memset(blocks + Layout::index(x, y, z), block, count);
+            return;
+        }
+
+        for (int i = 0; i < count; i++)
+            blocks[Layout::index(x + i, y, z)] = block;
+    }
+
+    // fn(row) over count blocks along x from (x, y, z), in place when the layout keeps them together.
+    // Otherwise over a copy, and only the blocks fn changed are written back
+    template<typename F>
+    void editRow(const int x, const int y, const int z, const int count, const F& fn)
+    {
+        if (Layout::CONTIGUOUS_X)
+        {
+            fn(blocks + Layout::index(x, y, z));
+            return;
+        }
+
+        uint8_t row[WORLD_SIZE], old[WORLD_SIZE];
+        for (int i = 0; i < count; i++)
+            row[i] = old[i] = get(x + i, y, z);
+
+        fn(row);
+
+        for (int i = 0; i < count; i++)
+            if (row[i] != old[i])
+                set(x + i, y, z, row[i]);
+    }
+
+    void compact() {}
+
+    unsigned long memoryUsage() const
+    {
+        return WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE;
+    }
+
+    // the blocks in Layout order, for code that indexes them itself
+    const uint8_t* data() const
+    {
+        return blocks;
+    }
+};
+
+constexpr int SECTION_SIZE = 16;
+constexpr int SECTION_VOLUME = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+
+constexpr int SECTIONS_X = WORLD_SIZE / SECTION_SIZE;
+constexpr int SECTIONS_Y = WORLD_HEIGHT / SECTION_SIZE;
+constexpr int SECTIONS_Z = WORLD_SIZE / SECTION_SIZE;
+
+// The world split into 16^3 sections, each storing a palette of the blocks it
+// contains plus one bit-packed palette index per block (1, 2, 4 or 8 bits).
+// A section made of a single block type has no allocation; it's just its block ID.
+class ChunkedStorage
+{
+    struct Section
+    {
+        uint8_t bits = 0; // bits per index, 0 if uniform
+        uint8_t block = BLOCK_AIR; // the whole section's block if uniform
+        unsigned short paletteSize = 0;
+
+        uint8_t* palette = nullptr; // 1 << bits entries, followed by the indices
+        uint8_t* indices = nullptr;
+    };
+
+    Section* sections = new Section[SECTIONS_X * SECTIONS_Y * SECTIONS_Z];
+
+    static void repack(Section& s, int newBits);
+
+public:
+    ~ChunkedStorage();
+
+    uint8_t get(const int x, const int y, const int z) const
+    {
+        const Section& s = sections[(x >> 4) + (y >> 4) * SECTIONS_X + (z >> 4) * SECTIONS_X * SECTIONS_Y];
+
+        if (s.bits == 0)
+            return s.block;
+
+        const int bit = ((x & 15) + (y & 15) * SECTION_SIZE + (z & 15) * SECTION_SIZE * SECTION_SIZE) * s.bits;
+        return s.palette[(s.indices[bit >> 3] >> (bit & 7)) & ((1 << s.bits) - 1)];
+    }
+
+    void set(int x, int y, int z, uint8_t block);
+
+    // count blocks along x from (x, y, z), a block at a time
+    void readRow(const int x, const int y, const int z, const int count, uint8_t* out) const
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = get(x + i, y, z);
+    }
+
+    void writeRow(const int x, const int y, const int z, const int count, const uint8_t* in)
+    {
+        for (int i = 0; i < count; i++)
+            set(x + i, y, z, in[i]);
+    }
+
+    void fillRow(const int x, const int y, const int z, const int count, const uint8_t block)
+    {
+        for (int i = 0; i < count; i++)
+            set(x + i, y, z, block);
+    }
+
+    // fn(row) over a copy of count blocks along x from (x, y, z). Only the blocks fn changed are
+    // written back, a set can mean growing a section's palette
+    template<typename F>
+    void editRow(const int x, const int y, const int z, const int count, const F& fn)
+    {
+        uint8_t row[WORLD_SIZE], old[WORLD_SIZE];
+        for (int i = 0; i < count; i++)
+            row[i] = old[i] = get(x + i, y, z);
+
+        fn(row);
+
+        for (int i = 0; i < count; i++)
+            if (row[i] != old[i])
+                set(x + i, y, z, row[i]);
+    }
+
+    // drop unused palette entries and collapse single-block sections,
+    // worth calling after large edits like world generation
+    void compact();
+
+    unsigned long memoryUsage() const;
+};
@@ -1,16 +1,237 @@
 #include "World.h"
 #include "Util.h"
+#include "DistanceField.h"
+#include "Jobs.h"
+#include "Occupancy.h"
+#include "Prefab.h"
+#include "Trace.h"
 
-uint8_t* World::world = new uint8_t[WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE];
+#include <SDL/SDL.h>
+#include <cmath>
+
+#ifdef X86_SIMD
+#include <immintrin.h>
+#endif
+
+#ifdef CHUNKED_WORLD
+ChunkedStorage World::world;
+#else
+FlatStorage<WORLD_LAYOUT> World::world;
+#endif
+
+#ifdef RAY_STATS
+long World::raycastSteps = 0;
+#endif
+
+uint8_t* World::bricks = new uint8_t[BRICKS_X * BRICKS_Y * BRICKS_Z];
+
+// how many non-air blocks are in each brick, so setBlock knows when one empties out
+static unsigned short* brickBlockCounts = new unsigned short[BRICKS_X * BRICKS_Y * BRICKS_Z];
+
+uint8_t* World::columnTops = new uint8_t[WORLD_SIZE * WORLD_SIZE];
+int World::terrainTop = WORLD_HEIGHT;
+
+// what's changed since the last takeDirty
+static DirtyRegions dirty;
+static SDL_mutex* dirtyLock = SDL_CreateMutex();
+
+static SDL_mutex* editLock = SDL_CreateMutex();
+
+void World::lockEdits()
+{
+    SDL_mutexP(editLock);
+}
+
+void World::unlockEdits()
+{
+    SDL_mutexV(editLock);
+}
+
+static void markDirty(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    SDL_mutexP(dirtyLock);
+    dirty.add({ short(x0), short(y0), short(z0), short(x1), short(y1), short(z1) });
+    SDL_mutexV(dirtyLock);
+}
+
+void World::takeDirty(DirtyRegions& into)
+{
+    SDL_mutexP(dirtyLock);
+    into.merge(dirty);
+    dirty.clear();
+    SDL_mutexV(dirtyLock);
+}
+
+// how many columns have their top at each y, so terrainTop is cheap to keep up to date
+static int columnTopCounts[WORLD_HEIGHT + 1];
+
+uint8_t* World::heightmap = new uint8_t[WORLD_SIZE * WORLD_SIZE];
+
+static int brickIndex(const int x, const int y, const int z)
+{
+    return x / BRICK_SIZE + y / BRICK_SIZE * BRICKS_X + z / BRICK_SIZE * BRICKS_X * BRICKS_Y;
+}
+
+// count the non-air blocks in a brick from scratch
+static void countBrick(const int brickX, const int brickY, const int brickZ)
+{
+    unsigned short count = 0;
+    uint8_t row[BRICK_SIZE];
+
+    for (int z = brickZ * BRICK_SIZE; z < (brickZ + 1) * BRICK_SIZE; z++)
+    {
+        for (int y = brickY * BRICK_SIZE; y < (brickY + 1) * BRICK_SIZE; y++)
+        {
+            World::world.readRow(brickX * BRICK_SIZE, y, z, BRICK_SIZE, row);
+            for (const uint8_t block : row)
+                count += block != BLOCK_AIR;
+        }
+    }
+
+    const int brick = brickX + brickY * BRICKS_X + brickZ * BRICKS_X * BRICKS_Y;
+    brickBlockCounts[brick] = count;
+    World::bricks[brick] = count != 0;
+}
+
+static void buildBricks()
+{
+    // a layer of bricks per job
+    Jobs::parallelFor(BRICKS_Z, [](const int brickZ) {
+        for (int brickY = 0; brickY < BRICKS_Y; brickY++)
+            for (int brickX = 0; brickX < BRICKS_X; brickX++)
+                countBrick(brickX, brickY, brickZ);
+    });
+}
+
+static void buildColumnTops()
+{
+    Jobs::parallelFor(WORLD_SIZE, [](const int z) {
+        for (int x = 0; x < WORLD_SIZE; x++)
+        {
+            int y = 0;
+            while (y < WORLD_HEIGHT && World::world.get(x, y, z) == BLOCK_AIR)
+                y++;
+
+            World::columnTops[x + z * WORLD_SIZE] = y;
+        }
+    });
+
+    for (int y = 0; y <= WORLD_HEIGHT; y++)
+        columnTopCounts[y] = 0;
+
+    for (int i = 0; i < WORLD_SIZE * WORLD_SIZE; i++)
+        columnTopCounts[World::columnTops[i]]++;
+
+    World::terrainTop = 0;
+    while (columnTopCounts[World::terrainTop] == 0)
+        World::terrainTop++;
+}
+
+static void setColumnTop(const int x, const int z, const int top)
+{
+    uint8_t& oldTop = World::columnTops[x + z * WORLD_SIZE];
+
+    columnTopCounts[oldTop]--;
+    columnTopCounts[top]++;
+    oldTop = top;
+
+    if (top < World::terrainTop)
+        World::terrainTop = top;
+
+    while (columnTopCounts[World::terrainTop] == 0)
+        World::terrainTop++;
+}
+
+// set a block and keep the bricks, column tops and occupancy bits in sync, returns the block that was there before
+static uint8_t storeBlock(const int x, const int y, const int z, const uint8_t block)
+{
+    const uint8_t oldBlock = World::world.get(x, y, z);
+    if (oldBlock == block)
+        return oldBlock;
+
+    World::world.set(x, y, z, block);
+
+    if ((oldBlock == BLOCK_AIR) != (block == BLOCK_AIR))
+    {
+        const int brick = brickIndex(x, y, z);
+
+        if (block == BLOCK_AIR)
+            brickBlockCounts[brick]--;
+        else
+            brickBlockCounts[brick]++;
+
+        World::bricks[brick] = brickBlockCounts[brick] != 0;
+
+        Occupancy::set(x, y, z, block != BLOCK_AIR);
+
+        const int top = World::columnTops[x + z * WORLD_SIZE];
+
+        if (block != BLOCK_AIR && y < top)
+        {
+            setColumnTop(x, z, y);
+        }
+        else if (block == BLOCK_AIR && y == top) // dug out the top, look further down
+        {
+            int newTop = y + 1;
+            while (newTop < WORLD_HEIGHT && World::world.get(x, newTop, z) == BLOCK_AIR)
+                newTop++;
+
+            setColumnTop(x, z, newTop);
+        }
+    }
+
+    return oldBlock;
+}
 
 void World::setBlock(const int x, const int y, const int z, const uint8_t block)
 {
-    world[x + y * WORLD_SIZE + z * WORLD_SIZE * WORLD_HEIGHT] = block;
+    const uint8_t oldBlock = storeBlock(x, y, z, block);
+
+#ifdef DISTANCE_FIELD
+    if (oldBlock == BLOCK_AIR && block != BLOCK_AIR)
+        DistanceField::addSolid(x, y, z);
+    else if (oldBlock != BLOCK_AIR && block == BLOCK_AIR)
+        DistanceField::update(x, y, z, x + 1, y + 1, z + 1);
+#endif
+
+    // last, so the render thread never takes a box before the distances in it are right
+    if (oldBlock != block)
+        markDirty(x, y, z, x + 1, y + 1, z + 1);
+}
+
+void World::setBlocks(const BlockEdit* edits, const int count)
+{
+    TRACE_ZONE("setBlocks");
+
+    DirtyRegions changed;
+
+    lockEdits();
+
+    for (int i = 0; i < count; i++)
+    {
+        const BlockEdit& edit = edits[i];
+
+        if (storeBlock(edit.x, edit.y, edit.z, edit.block) != edit.block)
+            changed.add({ edit.x, edit.y, edit.z, short(edit.x + 1), short(edit.y + 1), short(edit.z + 1) });
+    }
+
+#ifdef DISTANCE_FIELD
+    changed.forEach([](const DirtyRegion& r) {
+        DistanceField::update(r.x0, r.y0, r.z0, r.x1, r.y1, r.z1);
+    });
+#endif
+
+    // published once it's all up to date, like setBlock
+    SDL_mutexP(dirtyLock);
+    dirty.merge(changed);
+    SDL_mutexV(dirtyLock);
+
+    unlockEdits();
 }
 
 uint8_t World::getBlock(const int x, const int y, const int z)
 {
-    return world[x + y * WORLD_SIZE + z * WORLD_SIZE * WORLD_HEIGHT];
+    return world.get(x, y, z);
 }
 
 uint8_t World::getBlock(const vec3& pos)
@@ -24,27 +245,341 @@ bool World::isWithinWorld(const vec3& pos)
         pos.x < WORLD_SIZE && pos.y < WORLD_HEIGHT && pos.z < WORLD_SIZE;
 }
 
+uint64_t World::hash()
+{
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (int z = 0; z < WORLD_SIZE; z++)
+    {
+        for (int y = 0; y < WORLD_HEIGHT; y++)
+        {
+            for (int x = 0; x < WORLD_SIZE; x++)
+            {
+                hash ^= world.get(x, y, z);
+                hash *= 0x100000001B3;
+            }
+        }
+    }
+
+    return hash;
+}
+
+void World::readBox(const int x0, const int y0, const int z0,
+    const int width, const int height, const int depth, uint8_t* out)
+{
+    for (int z = z0; z < z0 + depth; z++)
+    {
+        for (int y = y0; y < y0 + height; y++)
+        {
+            world.readRow(x0, y, z, width, out);
+            out += width;
+        }
+    }
+}
+
+// Bulk edits write whole rows of blocks straight to storage, then bring the bricks, column tops,
+// occupancy and distance field back in line over the edited box all at once
+
+// clamp [x0, x1) x [y0, y1) x [z0, z1) to the world, false if none of it's left
+static bool clipBox(int& x0, int& y0, int& z0, int& x1, int& y1, int& z1)
+{
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    z0 = z0 < 0 ? 0 : z0;
+    x1 = x1 > WORLD_SIZE ? WORLD_SIZE : x1;
+    y1 = y1 > WORLD_HEIGHT ? WORLD_HEIGHT : y1;
+    z1 = z1 > WORLD_SIZE ? WORLD_SIZE : z1;
+
+    return x0 < x1 && y0 < y1 && z0 < z1;
+}
+
+// everything setBlock keeps up to date, for a box written straight to storage. Marks it dirty
+static void finishBox(const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    for (int brickZ = z0 / BRICK_SIZE; brickZ <= (z1 - 1) / BRICK_SIZE; brickZ++)
+        for (int brickY = y0 / BRICK_SIZE; brickY <= (y1 - 1) / BRICK_SIZE; brickY++)
+            for (int brickX = x0 / BRICK_SIZE; brickX <= (x1 - 1) / BRICK_SIZE; brickX++)
+                countBrick(brickX, brickY, brickZ);
+
+    Occupancy::refresh(x0, y0, z0, x1, y1, z1);
+
+    // nothing above the box changed, so a column whose top was above it keeps it
+    for (int z = z0; z < z1; z++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            if (World::columnTops[x + z * WORLD_SIZE] < y0)
+                continue;
+
+            int top = y0;
+            while (top < WORLD_HEIGHT && World::world.get(x, top, z) == BLOCK_AIR)
+                top++;
+
+            setColumnTop(x, z, top);
+        }
+    }
+
+#ifdef DISTANCE_FIELD
+    DistanceField::update(x0, y0, z0, x1, y1, z1);
+#endif
+
+    markDirty(x0, y0, z0, x1, y1, z1);
+}
+
+// row[i] = block where mask[i] isn't 0 (everywhere without a mask), only over air unless replace
+static void blendFill(uint8_t* row, const uint8_t* mask, const int count, const uint8_t block, const bool replace)
+{
+    int i = 0;
+
+#ifdef X86_SIMD
+    const __m128i fill = _mm_set1_epi8(char(block));
+    const __m128i air = _mm_set1_epi8(char(BLOCK_AIR));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i all = _mm_cmpeq_epi8(zero, zero);
+
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(row + i));
+
+        __m128i take = mask ? _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), zero), all) : all;
+        if (!replace)
+            take = _mm_and_si128(take, _mm_cmpeq_epi8(old, air));
+
+        _mm_storeu_si128((__m128i*)(row + i), _mm_or_si128(_mm_and_si128(take, fill), _mm_andnot_si128(take, old)));
+    }
+#endif
+
+    for (; i < count; i++)
+        if ((!mask || mask[i] != 0) && (replace || row[i] == BLOCK_AIR))
+            row[i] = block;
+}
+
+// row[i] = blocks[i] wherever blocks[i] isn't air
+static void blendSolid(uint8_t* row, const uint8_t* blocks, const int count)
+{
+    int i = 0;
+
+#ifdef X86_SIMD
+    const __m128i air = _mm_set1_epi8(char(BLOCK_AIR));
+
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(row + i));
+        const __m128i src = _mm_loadu_si128((const __m128i*)(blocks + i));
+        const __m128i keep = _mm_cmpeq_epi8(src, air);
+
+        _mm_storeu_si128((__m128i*)(row + i), _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, src)));
+    }
+#endif
+
+    for (; i < count; i++)
+        if (blocks[i] != BLOCK_AIR)
+            row[i] = blocks[i];
+}
+
+// fill [x0, x1) of the row at (y, z): a memset if replacing, a blend over the blocks there otherwise
+static void fillSpan(const int x0, const int x1, const int y, const int z, const uint8_t block, const bool replace)
+{
+    if (replace)
+    {
+        World::world.fillRow(x0, y, z, x1 - x0, block);
+        return;
+    }
+
+    uint8_t row[WORLD_SIZE];
+    World::world.readRow(x0, y, z, x1 - x0, row);
+    blendFill(row, nullptr, x1 - x0, block, false);
+    World::world.writeRow(x0, y, z, x1 - x0, row);
+}
+
+static int floorInt(const float val)
+{
+    const int i = int(val);
+    return i - (val < float(i));
+}
+
+// a shape that's convex along x, filled a row at a time. span(y, z, xa, xb) narrows [xa, xb) to
+// the part of the row inside, or returns false if none of it is
+template<typename F>
+static void fillShape(const uint8_t blockId, int x0, int y0, int z0, int x1, int y1, int z1, const bool replace, const F& span)
+{
+    if (!clipBox(x0, y0, z0, x1, y1, z1))
+        return;
+
+    World::lockEdits();
+
+    for (int z = z0; z < z1; z++)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            int xa = x0, xb = x1;
+            if (!span(y, z, xa, xb))
+                continue;
+
+            xa = xa < x0 ? x0 : xa;
+            xb = xb > x1 ? x1 : xb;
+            if (xa < xb)
+                fillSpan(xa, xb, y, z, blockId, replace);
+        }
+    }
+
+    finishBox(x0, y0, z0, x1, y1, z1);
+    World::unlockEdits();
+}
+
 void World::fillBox(const uint8_t blockId, const vec3& pos0,
     const vec3& pos1, const bool replace)
 {
-    for (int x = pos0.x; x < pos1.x; x++)
+    fillShape(blockId, pos0.x, pos0.y, pos0.z, pos1.x, pos1.y, pos1.z, replace, [](int, int, int&, int&) {
+        return true;
+    });
+}
+
+void World::fillSphere(const uint8_t blockId, const vec3& centre, const float radius, const bool replace)
+{
+    // blocks whose middles are within radius
+    fillShape(blockId, floorInt(centre.x - radius), floorInt(centre.y - radius), floorInt(centre.z - radius),
+        floorInt(centre.x + radius) + 1, floorInt(centre.y + radius) + 1, floorInt(centre.z + radius) + 1, replace,
+        [&](const int y, const int z, int& xa, int& xb) {
+            const float dy = y + 0.5f - centre.y, dz = z + 0.5f - centre.z;
+            const float left = radius * radius - dy * dy - dz * dz;
+            if (left < 0)
+                return false;
+
+            const float half = sqrtf(left);
+            xa = -floorInt(half - centre.x + 0.5f);
+            xb = floorInt(centre.x + half - 0.5f) + 1;
+            return true;
+        });
+}
+
+void World::fillCylinder(const uint8_t blockId, const vec3& base, const float radius, const int height, const bool replace)
+{
+    const int y0 = floorInt(base.y);
+
+    fillShape(blockId, floorInt(base.x - radius), y0, floorInt(base.z - radius),
+        floorInt(base.x + radius) + 1, y0 + height, floorInt(base.z + radius) + 1, replace,
+        [&](int, const int z, int& xa, int& xb) {
+            const float dz = z + 0.5f - base.z;
+            const float left = radius * radius - dz * dz;
+            if (left < 0)
+                return false;
+
+            const float half = sqrtf(left);
+            xa = -floorInt(half - base.x + 0.5f);
+            xb = floorInt(base.x + half - 0.5f) + 1;
+            return true;
+        });
+}
+
+void World::fillMask(const uint8_t blockId, const int x0, const int y0, const int z0,
+    const int width, const int height, const int depth, const uint8_t* mask, const bool replace)
+{
+    int bx0 = x0, by0 = y0, bz0 = z0, bx1 = x0 + width, by1 = y0 + height, bz1 = z0 + depth;
+    if (!clipBox(bx0, by0, bz0, bx1, by1, bz1))
+        return;
+
+    lockEdits();
+
+    uint8_t row[WORLD_SIZE];
+    for (int z = bz0; z < bz1; z++)
     {
-        for (int y = pos0.y; y < pos1.y; y++)
+        for (int y = by0; y < by1; y++)
         {
-            for (int z = pos0.z; z < pos1.z; z++)
-            {
-                if (!replace) {
-                    if (getBlock(x, y, z) != BLOCK_AIR)
-                        continue;
-                }
+            world.readRow(bx0, y, z, bx1 - bx0, row);
+            blendFill(row, mask + (bx0 - x0) + ((y - y0) + (z - z0) * height) * width, bx1 - bx0, blockId, replace);
+            world.writeRow(bx0, y, z, bx1 - bx0, row);
+        }
+    }
+
+    finishBox(bx0, by0, bz0, bx1, by1, bz1);
+    unlockEdits();
+}
+
+void World::writeBox(const int x0, const int y0, const int z0,
+    const int width, const int height, const int depth, const uint8_t* blocks, const bool pasteAir)
+{
+    int bx0 = x0, by0 = y0, bz0 = z0, bx1 = x0 + width, by1 = y0 + height, bz1 = z0 + depth;
+    if (!clipBox(bx0, by0, bz0, bx1, by1, bz1))
+        return;
 
-                setBlock(x, y, z, blockId);
+    lockEdits();
+
+    uint8_t row[WORLD_SIZE];
+    for (int z = bz0; z < bz1; z++)
+    {
+        for (int y = by0; y < by1; y++)
+        {
+            const uint8_t* in = blocks + (bx0 - x0) + ((y - y0) + (z - z0) * height) * width;
+
+            if (pasteAir)
+            {
+                world.writeRow(bx0, y, z, bx1 - bx0, in);
+                continue;
             }
+
+            world.readRow(bx0, y, z, bx1 - bx0, row);
+            blendSolid(row, in, bx1 - bx0);
+            world.writeRow(bx0, y, z, bx1 - bx0, row);
         }
     }
+
+    finishBox(bx0, by0, bz0, bx1, by1, bz1);
+    unlockEdits();
+}
+
+void World::copyBox(int x0, int y0, int z0, int width, int height, int depth,
+    const int toX, const int toY, const int toZ)
+{
+    // only the part that's in the world, moved along so it still lands where it would have,
+    // and of that only the part that lands in the world
+    int x1 = x0 + width, y1 = y0 + height, z1 = z0 + depth;
+    const int offsetX = toX - x0, offsetY = toY - y0, offsetZ = toZ - z0;
+    if (!clipBox(x0, y0, z0, x1, y1, z1))
+        return;
+
+    int tx0 = x0 + offsetX, ty0 = y0 + offsetY, tz0 = z0 + offsetZ;
+    int tx1 = x1 + offsetX, ty1 = y1 + offsetY, tz1 = z1 + offsetZ;
+    if (!clipBox(tx0, ty0, tz0, tx1, ty1, tz1))
+        return;
+
+    // a row at a time so the two boxes can overlap. Like memmove, the rows go the way that reads
+    // each one before a row's copied over it
+    const int rows = (ty1 - ty0) * (tz1 - tz0);
+    const bool backwards = offsetZ > 0 || (offsetZ == 0 && offsetY > 0);
+
+    lockEdits();
+
+    uint8_t row[WORLD_SIZE];
+    for (int i = 0; i < rows; i++)
+    {
+        const int r = backwards ? rows - 1 - i : i;
+        const int y = ty0 + r % (ty1 - ty0), z = tz0 + r / (ty1 - ty0);
+
+        world.readRow(tx0 - offsetX, y - offsetY, z - offsetZ, tx1 - tx0, row);
+        world.writeRow(tx0, y, z, tx1 - tx0, row);
+    }
+
+    finishBox(tx0, ty0, tz0, tx1, ty1, tz1);
+    unlockEdits();
 }
 
-vec3 World::raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis)
+static int clampInt(const int val, const int min, const int max)
+{
+    return val < min ? min : (val > max ? max : val);
+}
+
+// distance along the ray from origin to where it leaves voxel (or brick) [min, max) on one axis
+static float exitDist(const int min, const int max, const float origin, const float step, const float invDir)
+{
+    if (step == 0)
+        return 1e30f; // never
+
+    return (step > 0 ? max - origin : origin - min) * invDir;
+}
+
+vec3 World::raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis, uint8_t* hitBlock, int* hitCoords)
 {
     //ivec3 iOrigin = ivec3(origin); // Integer version of start vec
 
@@ -58,23 +593,150 @@ vec3 World::raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis)
     vec3 vInverted = (1.0F / dir).abs();
 
     // The distance to the closest voxel boundary in units of rayTravelDist
-    vec3 dist = origin.fract() * vec3(ijkStep);
-    dist += max(ijkStep, vec3(0));
-    dist *= vInverted;
+    vec3 dist = vec3(exitDist(i, i + 1, origin.x, ijkStep.x, vInverted.x),
+                     exitDist(j, j + 1, origin.y, ijkStep.y, vInverted.y),
+                     exitDist(k, k + 1, origin.z, ijkStep.z, vInverted.z));
 
     int axis = 0;
 
     float rayTravelDist = 0;
 
+    int occupiedX = -1, occupiedY = -1, occupiedZ = -1;
+
     while (rayTravelDist <= maxDist)
     {
         // Exit check
         if(!World::isWithinWorld(vec3(i, j, k)))
             break;
 
-        int blockHit = getBlock(vec3(i, j, k));
+#ifdef RAY_STATS
+        raycastSteps++;
+#endif
+
+        // Above the whole terrain and not heading down (y is inverted), nothing left to hit
+        if (j < terrainTop && ijkStep.y <= 0)
+            break;
+
+#ifdef DISTANCE_FIELD
+        // Nothing within d - 1 blocks of here, leap that far along the ray
+        const int leap = DistanceField::get(i, j, k) - 1;
+        if (leap > 0)
+        {
+            const float minInverted = vInverted.x < vInverted.y ? (vInverted.x < vInverted.z ? vInverted.x : vInverted.z) : (vInverted.y < vInverted.z ? vInverted.y : vInverted.z);
+            rayTravelDist += leap * minInverted;
+
+            // clamped to the empty cube we just crossed, in case of rounding
+            const vec3 leapPos = origin + dir * rayTravelDist;
+            i = clampInt(int(leapPos.x), i - leap, i + leap);
+            j = clampInt(int(leapPos.y), j - leap, j + leap);
+            k = clampInt(int(leapPos.z), k - leap, k + leap);
+
+            dist = vec3(exitDist(i, i + 1, origin.x, ijkStep.x, vInverted.x),
+                        exitDist(j, j + 1, origin.y, ijkStep.y, vInverted.y),
+                        exitDist(k, k + 1, origin.z, ijkStep.z, vInverted.z));
+
+            continue;
+        }
+#endif
+
+        // Empty cell, jump straight to where the ray leaves it. Try the biggest cells first,
+        // unless we're still in the 4^3 cell we last found blocks in
+        int cellSize = 0;
+        if ((i >> 2) != occupiedX || (j >> 2) != occupiedY || (k >> 2) != occupiedZ)
+        {
+            for (int level = OCCUPANCY_LEVELS - 1; level > 0; level--)
+            {
+                if (!Occupancy::cell(level, i >> (2 * level), j >> (2 * level), k >> (2 * level)))
+                {
+                    cellSize = 1 << (2 * level);
+                    break;
+                }
+            }
+
+            if (cellSize == 0)
+            {
+                occupiedX = i >> 2;
+                occupiedY = j >> 2;
+                occupiedZ = k >> 2;
+            }
+        }
+
+        if (cellSize != 0)
+        {
+            const int cellX = i & ~(cellSize - 1);
+            const int cellY = j & ~(cellSize - 1);
+            const int cellZ = k & ~(cellSize - 1);
+
+            // Distance to the cell's far side on each axis
+            const float exitX = exitDist(cellX, cellX + cellSize, origin.x, ijkStep.x, vInverted.x);
+            const float exitY = exitDist(cellY, cellY + cellSize, origin.y, ijkStep.y, vInverted.y);
+            const float exitZ = exitDist(cellZ, cellZ + cellSize, origin.z, ijkStep.z, vInverted.z);
+
+            rayTravelDist = exitX < exitY ? (exitX < exitZ ? exitX : exitZ) : (exitY < exitZ ? exitY : exitZ);
+
+            // Land in the voxel we exit into, clamped to the cell on the other axes to stay safe from rounding
+            const vec3 exitPos = origin + dir * rayTravelDist;
+            i = clampInt(int(exitPos.x), cellX, cellX + cellSize - 1);
+            j = clampInt(int(exitPos.y), cellY, cellY + cellSize - 1);
+            k = clampInt(int(exitPos.z), cellZ, cellZ + cellSize - 1);
+
+            if (rayTravelDist == exitX)
+            {
+                i = ijkStep.x > 0 ? cellX + cellSize : cellX - 1;
+                axis = 0;
+            }
+            else if (rayTravelDist == exitY)
+            {
+                j = ijkStep.y > 0 ? cellY + cellSize : cellY - 1;
+                axis = 1;
+            }
+            else
+            {
+                k = ijkStep.z > 0 ? cellZ + cellSize : cellZ - 1;
+                axis = 2;
+            }
+
+            dist = vec3(exitDist(i, i + 1, origin.x, ijkStep.x, vInverted.x),
+                        exitDist(j, j + 1, origin.y, ijkStep.y, vInverted.y),
+                        exitDist(k, k + 1, origin.z, ijkStep.z, vInverted.z));
+
+            continue;
+        }
+
+        // Above the highest block in this column. If we're still above it where we leave the column,
+        // go straight to the next one
+        const int columnTop = columnTops[i + k * WORLD_SIZE];
+        if (j < columnTop)
+        {
+            const float columnExit = dist.x < dist.z ? dist.x : dist.z;
+            const float exitY = origin.y + dir.y * columnExit;
+
+            if (exitY < columnTop)
+            {
+                rayTravelDist = columnExit;
+
+                if (dist.x < dist.z)
+                {
+                    i += ijkStep.x;
+                    dist.x += vInverted.x;
+                    axis = 0;
+                }
+                else
+                {
+                    k += ijkStep.z;
+                    dist.z += vInverted.z;
+                    axis = 2;
+                }
+
+                // somewhere between where we were and the column top, or above the world
+                j = clampInt(exitY < 0 ? -1 : int(exitY), ijkStep.y > 0 ? j : -1, ijkStep.y > 0 ? columnTop - 1 : j);
+                dist.y = exitDist(j, j + 1, origin.y, ijkStep.y, vInverted.y);
 
-        if (blockHit != BLOCK_AIR)
+                continue;
+            }
+        }
+
+        if (Occupancy::solid(i, j, k))
         {
             vec3 hitPos = origin + dir * rayTravelDist;
 
@@ -82,6 +744,16 @@ vec3 World::raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis)
             if(dir[hitAxis] > 0.0F)
                 hitAxis += 3;
 
+            if (hitBlock)
+                *hitBlock = getBlock(i, j, k);
+
+            if (hitCoords)
+            {
+                hitCoords[0] = i;
+                hitCoords[1] = j;
+                hitCoords[2] = k;
+            }
+
             return hitPos;// origin + dir * (rayTravelDist - 0.01f);
         }
 
@@ -135,6 +807,300 @@ vec3 World::raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis)
     return vec3(-1); // no hit
 }
 
+#if defined(X86_SIMD) && !defined(CHUNKED_WORLD)
+#define RAYCAST_SIMD
+
+// exitDist for 8 rays. forward/still are the lanes whose step is > 0 / == 0
+TARGET_AVX2 static __m256 exitDist8(const __m256i min, const __m256 origin, const __m256 forward,
+    const __m256 still, const __m256 invDir, const int size)
+{
+    const __m256 lo = _mm256_cvtepi32_ps(min);
+    const __m256 hi = _mm256_add_ps(lo, _mm256_set1_ps(float(size)));
+
+    const __m256 dist = _mm256_blendv_ps(_mm256_sub_ps(origin, lo), _mm256_sub_ps(hi, origin), forward);
+
+    return _mm256_blendv_ps(_mm256_mul_ps(dist, invDir), _mm256_set1_ps(1e30f), still);
+}
+
+// the byte at base[index] in each lane, 0 in lanes outside mask. Gathers the dword it's in
+TARGET_AVX2 static __m256i gatherBytes(const uint8_t* base, __m256i index, const __m256i mask)
+{
+    index = _mm256_and_si256(index, mask);
+
+    const __m256i dwords = _mm256_i32gather_epi32((const int*)base, _mm256_srli_epi32(index, 2), 4);
+    const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(3)), 3);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(dwords, shift), _mm256_and_si256(mask, _mm256_set1_epi32(0xFF)));
+}
+
+// Layout::index for 8 blocks, one lane at a time unless the layout is linear
+template<typename Layout>
+TARGET_AVX2 static __m256i blockIndex8(const __m256i x, const __m256i y, const __m256i z)
+{
+    alignas(32) int xs[8], ys[8], zs[8];
+    _mm256_store_si256((__m256i*)xs, x);
+    _mm256_store_si256((__m256i*)ys, y);
+    _mm256_store_si256((__m256i*)zs, z);
+
+    for (int lane = 0; lane < 8; lane++)
+        xs[lane] = Layout::index(xs[lane], ys[lane], zs[lane]);
+
+    return _mm256_load_si256((const __m256i*)xs);
+}
+
+template<>
+TARGET_AVX2 __m256i blockIndex8<LinearLayout>(const __m256i x, const __m256i y, const __m256i z)
+{
+    const __m256i yz = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(WORLD_SIZE)),
+        _mm256_mullo_epi32(z, _mm256_set1_epi32(WORLD_SIZE * WORLD_HEIGHT)));
+
+    return _mm256_add_epi32(x, yz);
+}
+
+// raycast for 8 rays, lanes >= lanes are left out. Skips empty bricks instead of walking the occupancy
+// levels and doesn't look at columnTops, the steps in between are the same
+TARGET_AVX2 static void raycast8(const int lanes, const float* ox, const float* oy, const float* oz,
+    const float* dx, const float* dy, const float* dz, const float maxDist,
+    float* hx, float* hy, float* hz, int* hitAxes, uint8_t* hitBlocks)
+{
+    const __m256 zeroF = _mm256_setzero_ps();
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i seven = _mm256_set1_epi32(BRICK_SIZE - 1);
+
+    const __m256 originX = _mm256_loadu_ps(ox), originY = _mm256_loadu_ps(oy), originZ = _mm256_loadu_ps(oz);
+    const __m256 dirX = _mm256_loadu_ps(dx), dirY = _mm256_loadu_ps(dy), dirZ = _mm256_loadu_ps(dz);
+
+    const __m256 forwardX = _mm256_cmp_ps(dirX, zeroF, _CMP_GT_OQ);
+    const __m256 forwardY = _mm256_cmp_ps(dirY, zeroF, _CMP_GT_OQ);
+    const __m256 forwardZ = _mm256_cmp_ps(dirZ, zeroF, _CMP_GT_OQ);
+    const __m256 backX = _mm256_cmp_ps(dirX, zeroF, _CMP_LT_OQ);
+    const __m256 backY = _mm256_cmp_ps(dirY, zeroF, _CMP_LT_OQ);
+    const __m256 backZ = _mm256_cmp_ps(dirZ, zeroF, _CMP_LT_OQ);
+    const __m256 stillX = _mm256_cmp_ps(dirX, zeroF, _CMP_EQ_OQ);
+    const __m256 stillY = _mm256_cmp_ps(dirY, zeroF, _CMP_EQ_OQ);
+    const __m256 stillZ = _mm256_cmp_ps(dirZ, zeroF, _CMP_EQ_OQ);
+
+    // 1 or -1 (0 if the ray doesn't move on that axis), the compares are -1 where true
+    const __m256i stepX = _mm256_sub_epi32(_mm256_castps_si256(backX), _mm256_castps_si256(forwardX));
+    const __m256i stepY = _mm256_sub_epi32(_mm256_castps_si256(backY), _mm256_castps_si256(forwardY));
+    const __m256i stepZ = _mm256_sub_epi32(_mm256_castps_si256(backZ), _mm256_castps_si256(forwardZ));
+
+    const __m256 invX = _mm256_andnot_ps(signBit, _mm256_div_ps(_mm256_set1_ps(1.0f), dirX));
+    const __m256 invY = _mm256_andnot_ps(signBit, _mm256_div_ps(_mm256_set1_ps(1.0f), dirY));
+    const __m256 invZ = _mm256_andnot_ps(signBit, _mm256_div_ps(_mm256_set1_ps(1.0f), dirZ));
+
+    __m256i i = _mm256_cvttps_epi32(originX), j = _mm256_cvttps_epi32(originY), k = _mm256_cvttps_epi32(originZ);
+
+    __m256 distX = exitDist8(i, originX, forwardX, stillX, invX, 1);
+    __m256 distY = exitDist8(j, originY, forwardY, stillY, invY, 1);
+    __m256 distZ = exitDist8(k, originZ, forwardZ, stillZ, invZ, 1);
+
+    __m256 travelled = zeroF;
+    __m256i axis = zero;
+
+    // above the terrain and not heading down is a miss, like in raycast
+    const __m256i skyTop = _mm256_set1_epi32(World::terrainTop);
+    const __m256i notDown = _mm256_cmpgt_epi32(_mm256_set1_epi32(1), stepY);
+
+    __m256i active = _mm256_cmpgt_epi32(_mm256_set1_epi32(lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    __m256 hitX = _mm256_set1_ps(-1), hitY = hitX, hitZ = hitX;
+    __m256i hitAxis = _mm256_set1_epi32(-1), hitBlock = zero;
+
+    const __m256 maxTravel = _mm256_set1_ps(maxDist);
+    const uint8_t* blocks = World::world.data();
+
+    for (;;)
+    {
+        __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zero, i), _mm256_cmpgt_epi32(zero, j)),
+            _mm256_cmpgt_epi32(zero, k));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(i, _mm256_set1_epi32(WORLD_SIZE - 1)));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(j, _mm256_set1_epi32(WORLD_HEIGHT - 1)));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(k, _mm256_set1_epi32(WORLD_SIZE - 1)));
+        outside = _mm256_or_si256(outside, _mm256_and_si256(_mm256_cmpgt_epi32(skyTop, j), notDown));
+
+        active = _mm256_and_si256(active, _mm256_castps_si256(_mm256_cmp_ps(travelled, maxTravel, _CMP_LE_OQ)));
+        active = _mm256_andnot_si256(outside, active);
+
+        if (_mm256_testz_si256(active, active))
+            break;
+
+#ifdef RAY_STATS
+        for (int lanesLeft = _mm256_movemask_ps(_mm256_castsi256_ps(active)); lanesLeft != 0; lanesLeft &= lanesLeft - 1)
+            World::raycastSteps++;
+#endif
+
+        const __m256i brick = _mm256_add_epi32(_mm256_add_epi32(_mm256_srai_epi32(i, 3),
+            _mm256_mullo_epi32(_mm256_srai_epi32(j, 3), _mm256_set1_epi32(BRICKS_X))),
+            _mm256_mullo_epi32(_mm256_srai_epi32(k, 3), _mm256_set1_epi32(BRICKS_X * BRICKS_Y)));
+
+        const __m256i brickEmpty = _mm256_and_si256(active, _mm256_cmpeq_epi32(gatherBytes(World::bricks, brick, active), zero));
+        const __m256i inBrick = _mm256_andnot_si256(brickEmpty, active);
+
+        const __m256i block = gatherBytes(blocks, blockIndex8<WORLD_LAYOUT>(i, j, k), inBrick);
+        const __m256i solid = _mm256_andnot_si256(_mm256_cmpeq_epi32(block, zero), inBrick);
+        const __m256i stepping = _mm256_andnot_si256(solid, inBrick);
+
+        if (!_mm256_testz_si256(solid, solid))
+        {
+            const __m256 solidF = _mm256_castsi256_ps(solid);
+            hitX = _mm256_blendv_ps(hitX, _mm256_add_ps(originX, _mm256_mul_ps(dirX, travelled)), solidF);
+            hitY = _mm256_blendv_ps(hitY, _mm256_add_ps(originY, _mm256_mul_ps(dirY, travelled)), solidF);
+            hitZ = _mm256_blendv_ps(hitZ, _mm256_add_ps(originZ, _mm256_mul_ps(dirZ, travelled)), solidF);
+            hitAxis = _mm256_blendv_epi8(hitAxis, axis, solid);
+            hitBlock = _mm256_blendv_epi8(hitBlock, block, solid);
+
+            active = _mm256_andnot_si256(solid, active);
+        }
+
+        // empty brick, jump to where the ray leaves it like raycast does for occupancy cells
+        if (!_mm256_testz_si256(brickEmpty, brickEmpty))
+        {
+            const __m256i cellX = _mm256_andnot_si256(seven, i);
+            const __m256i cellY = _mm256_andnot_si256(seven, j);
+            const __m256i cellZ = _mm256_andnot_si256(seven, k);
+
+            const __m256 exitX = exitDist8(cellX, originX, forwardX, stillX, invX, BRICK_SIZE);
+            const __m256 exitY = exitDist8(cellY, originY, forwardY, stillY, invY, BRICK_SIZE);
+            const __m256 exitZ = exitDist8(cellZ, originZ, forwardZ, stillZ, invZ, BRICK_SIZE);
+
+            const __m256 exit = _mm256_min_ps(exitX, _mm256_min_ps(exitY, exitZ));
+
+            const __m256i viaX = _mm256_castps_si256(_mm256_cmp_ps(exit, exitX, _CMP_EQ_OQ));
+            const __m256i viaY = _mm256_andnot_si256(viaX, _mm256_castps_si256(_mm256_cmp_ps(exit, exitY, _CMP_EQ_OQ)));
+            const __m256i viaZ = _mm256_andnot_si256(_mm256_or_si256(viaX, viaY), _mm256_set1_epi32(-1));
+
+            // land in the voxel we exit into, clamped to the brick on the other axes
+            __m256i newI = _mm256_cvttps_epi32(_mm256_add_ps(originX, _mm256_mul_ps(dirX, exit)));
+            __m256i newJ = _mm256_cvttps_epi32(_mm256_add_ps(originY, _mm256_mul_ps(dirY, exit)));
+            __m256i newK = _mm256_cvttps_epi32(_mm256_add_ps(originZ, _mm256_mul_ps(dirZ, exit)));
+            newI = _mm256_min_epi32(_mm256_max_epi32(newI, cellX), _mm256_or_si256(cellX, seven));
+            newJ = _mm256_min_epi32(_mm256_max_epi32(newJ, cellY), _mm256_or_si256(cellY, seven));
+            newK = _mm256_min_epi32(_mm256_max_epi32(newK, cellZ), _mm256_or_si256(cellZ, seven));
+
+            const __m256i eight = _mm256_set1_epi32(BRICK_SIZE), minusOne = _mm256_set1_epi32(-1);
+            newI = _mm256_blendv_epi8(newI, _mm256_add_epi32(cellX, _mm256_blendv_epi8(minusOne, eight, _mm256_castps_si256(forwardX))), viaX);
+            newJ = _mm256_blendv_epi8(newJ, _mm256_add_epi32(cellY, _mm256_blendv_epi8(minusOne, eight, _mm256_castps_si256(forwardY))), viaY);
+            newK = _mm256_blendv_epi8(newK, _mm256_add_epi32(cellZ, _mm256_blendv_epi8(minusOne, eight, _mm256_castps_si256(forwardZ))), viaZ);
+
+            const __m256i newAxis = _mm256_or_si256(_mm256_and_si256(viaY, _mm256_set1_epi32(1)), _mm256_and_si256(viaZ, _mm256_set1_epi32(2)));
+
+            const __m256 jumpF = _mm256_castsi256_ps(brickEmpty);
+            i = _mm256_blendv_epi8(i, newI, brickEmpty);
+            j = _mm256_blendv_epi8(j, newJ, brickEmpty);
+            k = _mm256_blendv_epi8(k, newK, brickEmpty);
+            axis = _mm256_blendv_epi8(axis, newAxis, brickEmpty);
+            travelled = _mm256_blendv_ps(travelled, exit, jumpF);
+
+            distX = _mm256_blendv_ps(distX, exitDist8(i, originX, forwardX, stillX, invX, 1), jumpF);
+            distY = _mm256_blendv_ps(distY, exitDist8(j, originY, forwardY, stillY, invY, 1), jumpF);
+            distZ = _mm256_blendv_ps(distZ, exitDist8(k, originZ, forwardZ, stillZ, invZ, 1), jumpF);
+        }
+
+        // step to the closest voxel boundary, ties go the same way as in raycast
+        const __m256i yFirst = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(distY, distX, _CMP_LT_OQ), _mm256_cmp_ps(distY, distZ, _CMP_LT_OQ)));
+        const __m256i xFirst = _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(distY, distX, _CMP_LT_OQ)),
+            _mm256_castps_si256(_mm256_cmp_ps(distX, distZ, _CMP_LT_OQ)));
+
+        const __m256i moveY = _mm256_and_si256(stepping, yFirst);
+        const __m256i moveX = _mm256_and_si256(stepping, xFirst);
+        const __m256i moveZ = _mm256_andnot_si256(_mm256_or_si256(yFirst, xFirst), stepping);
+        const __m256 moveXF = _mm256_castsi256_ps(moveX), moveYF = _mm256_castsi256_ps(moveY), moveZF = _mm256_castsi256_ps(moveZ);
+
+        i = _mm256_add_epi32(i, _mm256_and_si256(stepX, moveX));
+        j = _mm256_add_epi32(j, _mm256_and_si256(stepY, moveY));
+        k = _mm256_add_epi32(k, _mm256_and_si256(stepZ, moveZ));
+
+        travelled = _mm256_blendv_ps(travelled, distX, moveXF);
+        travelled = _mm256_blendv_ps(travelled, distY, moveYF);
+        travelled = _mm256_blendv_ps(travelled, distZ, moveZF);
+
+        distX = _mm256_add_ps(distX, _mm256_and_ps(invX, moveXF));
+        distY = _mm256_add_ps(distY, _mm256_and_ps(invY, moveYF));
+        distZ = _mm256_add_ps(distZ, _mm256_and_ps(invZ, moveZF));
+
+        axis = _mm256_blendv_epi8(axis, zero, moveX);
+        axis = _mm256_blendv_epi8(axis, _mm256_set1_epi32(1), moveY);
+        axis = _mm256_blendv_epi8(axis, _mm256_set1_epi32(2), moveZ);
+    }
+
+    // +3 when the ray was going the positive way along the axis it hit, misses stay at -1
+    const __m256 forwardOnAxis = _mm256_blendv_ps(_mm256_blendv_ps(forwardX, forwardY, _mm256_castsi256_ps(_mm256_cmpeq_epi32(hitAxis, _mm256_set1_epi32(1)))),
+        forwardZ, _mm256_castsi256_ps(_mm256_cmpeq_epi32(hitAxis, _mm256_set1_epi32(2))));
+    const __m256i plusThree = _mm256_andnot_si256(_mm256_cmpgt_epi32(zero, hitAxis), _mm256_castps_si256(forwardOnAxis));
+    hitAxis = _mm256_add_epi32(hitAxis, _mm256_and_si256(plusThree, _mm256_set1_epi32(3)));
+
+    alignas(32) float outX[8], outY[8], outZ[8];
+    alignas(32) int outAxis[8], outBlock[8];
+    _mm256_store_ps(outX, hitX);
+    _mm256_store_ps(outY, hitY);
+    _mm256_store_ps(outZ, hitZ);
+    _mm256_store_si256((__m256i*)outAxis, hitAxis);
+    _mm256_store_si256((__m256i*)outBlock, hitBlock);
+
+    for (int lane = 0; lane < lanes; lane++)
+    {
+        hx[lane] = outX[lane];
+        hy[lane] = outY[lane];
+        hz[lane] = outZ[lane];
+        hitAxes[lane] = outAxis[lane];
+        hitBlocks[lane] = uint8_t(outBlock[lane]);
+    }
+}
+#endif
+
+void World::raycastBatch(const int count, const Vec3Array& origins, const Vec3Array& dirs, const float maxDist,
+    const Vec3Array& hits, int* hitAxes, uint8_t* hitBlocks)
+{
+    int done = 0;
+
+#ifdef RAYCAST_SIMD
+    static const bool avx2 = hasAVX2();
+    if (avx2)
+    {
+        for (; done + 8 <= count; done += 8)
+        {
+            raycast8(8, origins.x + done, origins.y + done, origins.z + done, dirs.x + done, dirs.y + done, dirs.z + done, maxDist,
+                hits.x + done, hits.y + done, hits.z + done, hitAxes + done, hitBlocks + done);
+        }
+
+        // pad the last few rays out to 8, the extra lanes are switched off
+        if (done < count)
+        {
+            float ox[8] = {}, oy[8] = {}, oz[8] = {}, dx[8] = {}, dy[8] = {}, dz[8] = {};
+            for (int lane = 0; done + lane < count; lane++)
+            {
+                ox[lane] = origins.x[done + lane];
+                oy[lane] = origins.y[done + lane];
+                oz[lane] = origins.z[done + lane];
+                dx[lane] = dirs.x[done + lane];
+                dy[lane] = dirs.y[done + lane];
+                dz[lane] = dirs.z[done + lane];
+            }
+
+            raycast8(count - done, ox, oy, oz, dx, dy, dz, maxDist,
+                hits.x + done, hits.y + done, hits.z + done, hitAxes + done, hitBlocks + done);
+            done = count;
+        }
+    }
+#endif
+
+    for (; done < count; done++)
+    {
+        int axis = -1;
+        uint8_t block = BLOCK_AIR;
+        const vec3 hit = raycast(vec3(origins.x[done], origins.y[done], origins.z[done]),
+            vec3(dirs.x[done], dirs.y[done], dirs.z[done]), maxDist, axis, &block);
+
+        hits.x[done] = hit.x;
+        hits.y[done] = hit.y;
+        hits.z[done] = hit.z;
+        hitAxes[done] = axis;
+        hitBlocks[done] = block;
+    }
+}
+
 void World::generateWorld()
 {
     Random rand;
@@ -148,7 +1114,13 @@ constexpr float maxTerrainHeight = WORLD_HEIGHT / 2.0f;
 #ifdef CLASSIC // classic worldgen
 void World::generateWorld(uint64_t seed)
 {
+    TRACE_ZONE("generateWorld");
+
     Random rand = Random(seed);
+
+#ifdef DISTANCE_FIELD
+    DistanceField::invalidate(); // rebuilt at the end
+#endif
     for (int x = WORLD_SIZE; x >= 0; x--) {
         for (int y = 0; y < WORLD_HEIGHT; y++) {
             for (int z = 0; z < WORLD_SIZE; z++) {
@@ -162,21 +1134,88 @@ void World::generateWorld(uint64_t seed)
                 if (x == WORLD_SIZE)
                     continue;
 
-                setBlock(x, y, z, block);
+                world.set(x, y, z, block);
             }
         }
     }
+
+    world.compact();
+    buildBricks();
+    buildColumnTops();
+    Occupancy::build();
+#ifdef DISTANCE_FIELD
+    DistanceField::build();
+#endif
 }
 #else // new worldgen
 constexpr int stoneDepth = 5;
 
-void World::generateWorld(uint64_t seed)
+// at most one tree per TREE_CELL^2 cell, and a tree never reaches outside its cell
+constexpr int TREE_CELL = 8;
+
+// worldgen runs one job per REGION_WIDTH wide slab of the world. A slab holds whole storage
+// sections and tree cells, so regions never touch each other's blocks
+constexpr int REGION_WIDTH = SECTION_SIZE;
+
+static_assert(REGION_WIDTH % TREE_CELL == 0 && WORLD_SIZE % REGION_WIDTH == 0, "regions must hold whole tree cells");
+
+// splitmix64 over the world seed and cell position, so every tree cell gets
+// its own random stream no matter which thread gets to it first
+static uint64_t cellSeed(const uint64_t seed, const int x, const int z)
 {
-    Random rand = Random(seed);
+    uint64_t h = seed + (uint64_t(x) << 32 | uint64_t(z)) * 0x9E3779B97F4A7C15;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+    return h ^ (h >> 31);
+}
 
-    for (int x = WORLD_SIZE; x >= 0; x--) {
+static void placeTree(Random& rand, const int x, const int z)
+{
+    const vec2 treePos = rand.nextIVec2(2) + vec2(x, z);
+
+    const int terrainHeight = World::heightmap[int(treePos.x) + int(treePos.y) * WORLD_SIZE] - 1;
+    const Prefab& tree = Prefabs::trees[rand.nextInt(Prefabs::TREE_VARIANTS)];
+
+    Prefabs::stamp(tree, rand, treePos.x, terrainHeight, treePos.y);
+}
+
+static_assert(WORLD_SIZE % HEIGHTMAP_STEP == 0, "the heightmap grid must line up with the world's edge");
+
+// terrain noise samples along each side of the coarse grid, the last one sits on the far edge
+constexpr int HEIGHTMAP_SAMPLES = WORLD_SIZE / HEIGHTMAP_STEP + 1;
+
+static float heightmapNoise[HEIGHTMAP_SAMPLES * HEIGHTMAP_SAMPLES];
+
+// noise at x / 32, z / 32 on every HEIGHTMAP_STEP-th column, bilinearly interpolated in between
+static void buildHeightmap()
+{
+    Perlin::noiseGrid(0, 0, HEIGHTMAP_STEP / 32.f, HEIGHTMAP_SAMPLES, HEIGHTMAP_SAMPLES, heightmapNoise);
+
+    Jobs::parallelFor(WORLD_SIZE, [](const int z) {
+        const float* row0 = heightmapNoise + z / HEIGHTMAP_STEP * HEIGHTMAP_SAMPLES;
+        const float* row1 = row0 + HEIGHTMAP_SAMPLES;
+        const float tz = float(z % HEIGHTMAP_STEP) / HEIGHTMAP_STEP;
+
+        for (int x = 0; x < WORLD_SIZE; x++) {
+            const int i = x / HEIGHTMAP_STEP;
+            const float tx = float(x % HEIGHTMAP_STEP) / HEIGHTMAP_STEP;
+
+            const float noise0 = row0[i] + (row0[i + 1] - row0[i]) * tx;
+            const float noise1 = row1[i] + (row1[i + 1] - row1[i]) * tx;
+            const float noise = noise0 + (noise1 - noise0) * tz;
+
+            World::heightmap[x + z * WORLD_SIZE] = roundFloat(maxTerrainHeight + noise * 10.0f);
+        }
+    });
+}
+
+static void generateRegion(const uint64_t seed, const int region)
+{
+    const int regionX = region * REGION_WIDTH;
+
+    for (int x = regionX; x < regionX + REGION_WIDTH; x++) {
         for (int z = 0; z < WORLD_SIZE; z++) {
-            const int terrainHeight = roundFloat(maxTerrainHeight + Perlin::noise(x / 32.f, z / 32.f) * 10.0f);
+            const int terrainHeight = World::heightmap[x + z * WORLD_SIZE];
 
             for (int y = 0; y < WORLD_HEIGHT; y++) {
                 uint8_t block;
@@ -190,71 +1229,43 @@ void World::generateWorld(uint64_t seed)
                 else
                     block = BLOCK_AIR;
 
-                setBlock(x, y, z, block);
+                // straight to storage, the acceleration structures are rebuilt once we're done
+                World::world.set(x, y, z, block);
             }
         }
     }
 
-    // populate trees
-    for (int x = 4; x < WORLD_SIZE - 4; x += 8) {
-        for (int z = 4; z < WORLD_SIZE - 4; z += 8) {
-            if (rand.nextInt(4) == 0) // spawn tree
-            {
-                const vec2 treePos = rand.nextIVec2(2) + vec2(x, z);
-
-                const int terrainHeight = int(roundFloat(maxTerrainHeight + Perlin::noise(treePos / 32.f) * 10.0f)) - 1;
-                const int trunkHeight = 4 + rand.nextInt(2); // min 4 max 5
-
-                // fill trunk
-                for (int y = terrainHeight; y >= terrainHeight - trunkHeight; y--)
-                {
-                    setBlock(treePos.x, y, treePos.y, BLOCK_WOOD);
-                }
-
-                // fill base foliage
-                fillBox(BLOCK_LEAVES,
-                    vec3(treePos.x - 2, terrainHeight - trunkHeight + 1, treePos.y - 2),
-                    vec3(treePos.x + 3, terrainHeight - trunkHeight + 3, treePos.y + 3), false);
-
-                // fill crown
-                fillBox(BLOCK_LEAVES,
-                    vec3(treePos.x - 1, terrainHeight - trunkHeight - 1, treePos.y - 1),
-                    vec3(treePos.x + 2, terrainHeight - trunkHeight + 1, treePos.y + 2), false);
-
-                // cut out corners randomly
-                for (int i = 0; i < 4; i++)
-                {
-                    // binary counting, so we cover all values
-                    int bit0 = (i >> 0 & 0b01) * 2 - 1;
-                    int bit1 = (i >> 1 & 0b01) * 2 - 1;
-
-
-                    // base foliage
-                    const vec2 foliagePos = vec2(treePos.x + (2 * bit0), treePos.y + (2 * bit1));
+    // populate trees, leaving the world's edge clear
+    for (int x = regionX + TREE_CELL / 2; x < regionX + REGION_WIDTH && x < WORLD_SIZE - TREE_CELL / 2; x += TREE_CELL) {
+        for (int z = TREE_CELL / 2; z < WORLD_SIZE - TREE_CELL / 2; z += TREE_CELL) {
+            Random rand = Random(cellSeed(seed, x, z));
 
+            if (rand.nextInt(4) == 0) // spawn tree
+                placeTree(rand, x, z);
+        }
+    }
+}
 
-                    int cornerStyle = rand.nextInt(7);
-
-                    if ((cornerStyle == 0) || (cornerStyle == 2)) // cut out top
-                       setBlock(foliagePos.x, terrainHeight - trunkHeight + 1, foliagePos.y, BLOCK_AIR);
-
-                    if ((cornerStyle == 1) || (cornerStyle == 2)) // cut out bottom
-                        setBlock(foliagePos.x, terrainHeight - trunkHeight + 2, foliagePos.y, BLOCK_AIR);
-
+void World::generateWorld(const uint64_t seed)
+{
+    TRACE_ZONE("generateWorld");
 
-                    // crown
-                    const vec2 crownPos = vec2(treePos.x + bit0, treePos.y + bit1);
+#ifdef DISTANCE_FIELD
+    DistanceField::invalidate(); // rebuilt at the end
+#endif
 
-                    cornerStyle = rand.nextInt(5);
+    buildHeightmap();
 
-                    if (cornerStyle == 0) // cut out bottom 1/10 times
-                        setBlock(crownPos.x, terrainHeight - trunkHeight, crownPos.y, BLOCK_AIR);
+    Jobs::parallelFor(WORLD_SIZE / REGION_WIDTH, [seed](const int region) {
+        generateRegion(seed, region);
+    });
 
-                    // always cut crown top
-                    setBlock(crownPos.x, terrainHeight - trunkHeight - 1, crownPos.y, BLOCK_AIR);
-                }
-            }
-        }
-    }
+    world.compact();
+    buildBricks();
+    buildColumnTops();
+    Occupancy::build();
+#ifdef DISTANCE_FIELD
+    DistanceField::build();
+#endif
 }
 #endif
\ No newline at end of file
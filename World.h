@@ -1,22 +1,109 @@
 #pragma once
 #include "Constants.h"
+#include "DirtyRegions.h"
+#include "VoxelStorage.h"
 
 namespace World
 {
-    extern uint8_t* world;
+    // one block to set, for setBlocks
+    struct BlockEdit
+    {
+        short x, y, z;
+        uint8_t block;
+    };
+
+    // one float array per component, for passing lots of vectors around at once
+    struct Vec3Array
+    {
+        float* x;
+        float* y;
+        float* z;
+    };
+
+#ifdef CHUNKED_WORLD
+    extern ChunkedStorage world;
+#else
+    extern FlatStorage<WORLD_LAYOUT> world;
+#endif
+
+    // one byte per brick, 0 if it's all air. kept up to date by setBlock.
+    // ordered like the world texture so it can be uploaded as is
+    extern uint8_t* bricks;
+
+    // y of the topmost non-air block in each (x, z) column, WORLD_HEIGHT if it's all air.
+    // indexed x + z * WORLD_SIZE, kept up to date by setBlock
+    extern uint8_t* columnTops;
+
+    // the smallest of columnTops, i.e. the highest point of the terrain
+    extern int terrainTop;
+
+    // y of the grass block in each (x, z) column as generateWorld laid it out, before trees
+    // and edits. indexed x + z * WORLD_SIZE, for decoration passes (not filled by CLASSIC)
+    extern uint8_t* heightmap;
+
+#ifdef RAY_STATS
+    // loop iterations done by raycast so far, for comparing acceleration structures
+    extern long raycastSteps;
+#endif
 
     void setBlock(int x, int y, int z, uint8_t block);
 
+    // setBlock on each edit in order, but the dirty regions and distance field are only
+    // updated once for the lot, per box of edits close together
+    void setBlocks(const BlockEdit* edits, int count);
+
+    // held by setBlocks and the bulk edits while they write. The thread that edits the world
+    // reads it as it likes, any other thread holds this while it reads so an edit can't land
+    // halfway through
+    void lockEdits();
+    void unlockEdits();
+
+    // add the boxes setBlock and the bulk edits changed since the last call to into. Safe to call
+    // while another thread edits, the edits either make this call or the next one
+    void takeDirty(DirtyRegions& into);
+
     uint8_t getBlock(int x, int y, int z);
 
     uint8_t getBlock(const vec3& pos);
 
     bool isWithinWorld(const vec3& pos);
 
+    // of every block in the world, same world in, same hash out
+    uint64_t hash();
+
+    // copy a box of blocks into out, x-major then y then z (like glTexSubImage3D expects)
+    void readBox(int x0, int y0, int z0, int width, int height, int depth, uint8_t* out);
+
+    // Bulk edits. These write a row of blocks at a time and mark one dirty region per call.
+    // Anything outside the world is left out. Without replace, only air is filled in
+
+    // [pos0, pos1)
     void fillBox(uint8_t blockId, const vec3& pos0,
         const vec3& pos1, bool replace);
 
-    vec3 raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis);
+    // the blocks whose middles are within radius of centre
+    void fillSphere(uint8_t blockId, const vec3& centre, float radius, bool replace);
+
+    // upright, the blocks whose middles are within radius of base's x and z, from base.y to base.y + height
+    void fillCylinder(uint8_t blockId, const vec3& base, float radius, int height, bool replace);
+
+    // the blocks of the box where mask isn't 0. mask is ordered like readBox
+    void fillMask(uint8_t blockId, int x0, int y0, int z0, int width, int height, int depth,
+        const uint8_t* mask, bool replace);
+
+    // paste blocks from readBox back in at x0, y0, z0. Air in blocks is left out unless pasteAir
+    void writeBox(int x0, int y0, int z0, int width, int height, int depth, const uint8_t* blocks, bool pasteAir);
+
+    // clone a box of blocks to toX, toY, toZ. The two can overlap
+    void copyBox(int x0, int y0, int z0, int width, int height, int depth, int toX, int toY, int toZ);
+
+    // hitBlock gets the block that was hit and hitCoords its x, y and z, if given
+    vec3 raycast(vec3 origin, vec3 dir, float maxDist, int& hitAxis, uint8_t* hitBlock = nullptr, int* hitCoords = nullptr);
+
+    // raycast count rays at once. Misses come back as a hit at -1 with hitAxes -1 and BLOCK_AIR.
+    // Traces 8 rays at a time with AVX2 on a flat world, one at a time otherwise
+    void raycastBatch(int count, const Vec3Array& origins, const Vec3Array& dirs, float maxDist,
+        const Vec3Array& hits, int* hitAxes, uint8_t* hitBlocks);
 
     void generateWorld(); // randomize seed
     void generateWorld(uint64_t seed);
@@ -0,0 +1,221 @@
+#include "Bench.h"
+
+#include "Jobs.h"
+#include "Util.h"
+#include "World.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+volatile long Bench::sink = 0;
+
+const char* Bench::tracePath = nullptr;
+const char* Bench::jsonPath = nullptr;
+
+int Bench::failures = 0;
+
+// everything reported so far, in order, for --json
+struct Result
+{
+    const char* group;
+    char name[64];
+
+    // timings, in ns per operation
+    long opsPerCall;
+    int repetitions;
+    int warmUps;
+    double mean, stddev, min, max;
+
+    // values
+    const char* unit; // nullptr for timings
+    double value;
+};
+
+static std::vector<Result> results;
+static const char* currentGroup = "";
+
+double Bench::seconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Bench::report(const char* name, const double seconds, const long ops)
+{
+    report(name, &seconds, 1, ops, 0);
+}
+
+void Bench::report(const char* name, const double* seconds, const int repetitions, const long opsPerCall, const int warmUps)
+{
+    Result result = {};
+    result.group = currentGroup;
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.opsPerCall = opsPerCall;
+    result.repetitions = repetitions;
+    result.warmUps = warmUps;
+
+    double sum = 0;
+    result.min = 1e300;
+    for (int i = 0; i < repetitions; i++)
+    {
+        const double ns = seconds[i] * 1e9 / opsPerCall;
+        sum += ns;
+        result.min = ns < result.min ? ns : result.min;
+        result.max = ns > result.max ? ns : result.max;
+    }
+    result.mean = sum / repetitions;
+
+    // sample standard deviation
+    double squares = 0;
+    for (int i = 0; i < repetitions; i++)
+    {
+        const double ns = seconds[i] * 1e9 / opsPerCall;
+        squares += (ns - result.mean) * (ns - result.mean);
+    }
+    result.stddev = repetitions > 1 ? sqrt(squares / (repetitions - 1)) : 0;
+
+    results.push_back(result);
+
+    printf("%-40s %10.2f ns/op %10.2f Mops/s", name, result.mean, 1e3 / result.mean);
+    if (repetitions > 1)
+        printf("  +-%.1f%%", result.stddev / result.mean * 100);
+    printf("\n");
+}
+
+void Bench::value(const char* name, const double value, const char* unit)
+{
+    Result result = {};
+    result.group = currentGroup;
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    result.unit = unit;
+    result.value = value;
+
+    results.push_back(result);
+}
+
+// one result per line, always in the same order with the same keys, so runs diff cleanly
+static void writeJson(FILE* out)
+{
+#ifdef DISTANCE_FIELD
+    const bool distanceField = true;
+#else
+    const bool distanceField = false;
+#endif
+
+#ifdef CHUNKED_WORLD
+    const char* layout = "chunked";
+#else
+    const char* layout = WORLD_LAYOUT::name;
+#endif
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"threads\": %d,\n", Jobs::threadCount());
+    fprintf(out, "  \"layout\": \"%s\",\n", layout);
+    fprintf(out, "  \"distance_field\": %s,\n", distanceField ? "true" : "false");
+    fprintf(out, "  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+
+        fprintf(out, "    { \"group\": \"%s\", \"name\": \"%s\", ", r.group, r.name);
+        if (r.unit != nullptr)
+        {
+            fprintf(out, "\"value\": %.6g, \"unit\": \"%s\" }", r.value, r.unit);
+        }
+        else
+        {
+            fprintf(out, "\"ops_per_rep\": %ld, \"repetitions\": %d, \"warm_ups\": %d, "
+                "\"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f }",
+                r.opsPerCall, r.repetitions, r.warmUps, r.mean, r.stddev, r.min, r.max);
+        }
+
+        fprintf(out, "%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+struct BenchGroup
+{
+    const char* name;
+    void (*run)();
+};
+
+static const BenchGroup groups[] = {
+    { "storage", benchStorage },
+    { "layout", benchLayout },
+    { "steps", benchRaySteps },
+    { "worldgen", benchWorldgen },
+    { "perlin", benchPerlin },
+    { "random", benchRandom },
+    { "textures", benchTextures },
+    { "cpurender", benchCpuRender },
+    { "raybatch", benchRaycastBatch },
+    { "frame", benchFrame },
+    { "primitives", benchPrimitives },
+    { "collision", benchCollision },
+    { "entities", benchEntities },
+    { "broadphase", benchBroadphase },
+    { "dirty", benchDirtyRegions },
+    { "edits", benchEdits },
+    { "regions", benchRegionEdits },
+    { "prefabs", benchPrefabs },
+};
+
+// run every group, or only the ones named on the command line. --json <file> saves the results
+int main(int argc, char** argv)
+{
+    Jobs::init();
+    Perlin::init();
+
+    // the options take the argument after them, everything else names a group
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; i++)
+    {
+        const char** option = strcmp(argv[i], "--trace") == 0 ? &Bench::tracePath :
+            strcmp(argv[i], "--json") == 0 ? &Bench::jsonPath : nullptr;
+
+        if (option == nullptr)
+            names.push_back(argv[i]);
+        else if (i + 1 < argc)
+            *option = argv[++i];
+    }
+
+    for (const BenchGroup& group : groups)
+    {
+        bool selected = names.empty();
+        for (const char* name : names)
+            selected |= strcmp(name, group.name) == 0;
+
+        if (selected)
+        {
+            currentGroup = group.name;
+            group.run();
+        }
+    }
+
+    if (Bench::jsonPath != nullptr)
+    {
+        FILE* out = fopen(Bench::jsonPath, "w");
+        if (out == nullptr)
+        {
+            printf("can't write %s\n", Bench::jsonPath);
+            return 1;
+        }
+
+        writeJson(out);
+        fclose(out);
+    }
+
+    if (Bench::failures != 0)
+    {
+        printf("%d checks FAILED\n", Bench::failures);
+        return 1;
+    }
+
+    return 0;
+}
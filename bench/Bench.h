@@ -0,0 +1,72 @@
+#pragma once
+
+// Microbenchmark helpers for the Minecraft4k_bench target.
+// This is built with regular compiler flags, not under the 4k size constraints.
+
+namespace Bench
+{
+    // monotonic wall clock in seconds
+    double seconds();
+
+    // written to by benchmarks so the compiler can't throw their work away
+    extern volatile long sink;
+
+    // --trace <file> on the command line, an InputTrace recording for the frame group
+    extern const char* tracePath;
+
+    // --json <file> on the command line, where to write every result when the run is over
+    extern const char* jsonPath;
+
+    // checks that came out wrong. Each group adds its own, main exits with 1 if there are any
+    extern int failures;
+
+    // one timing of ops operations, for benchmarks that run and time themselves
+    void report(const char* name, double seconds, long ops);
+
+    // the per-operation mean, spread and range of several timed repetitions of opsPerCall operations.
+    // Printed, and kept for the --json results
+    void report(const char* name, const double* seconds, int repetitions, long opsPerCall, int warmUps);
+
+    // a number that isn't a timing of operations (a percentile, a frame rate...), for the --json results.
+    // Not printed, the benchmark prints it its own way
+    void value(const char* name, double value, const char* unit);
+
+    // call fn once to warm up, then time `repetitions` calls of it one by one.
+    // fn should do opsPerCall operations, the result is reported per operation
+    template<typename F>
+    void run(const char* name, const long opsPerCall, const int repetitions, F fn)
+    {
+        fn();
+
+        double* times = new double[repetitions];
+        for (int i = 0; i < repetitions; i++)
+        {
+            const double start = seconds();
+            fn();
+            times[i] = seconds() - start;
+        }
+
+        report(name, times, repetitions, opsPerCall, 1);
+
+        delete[] times;
+    }
+}
+
+void benchStorage();
+void benchLayout();
+void benchRaySteps();
+void benchWorldgen();
+void benchPerlin();
+void benchRandom();
+void benchTextures();
+void benchCpuRender();
+void benchRaycastBatch();
+void benchFrame();
+void benchPrimitives();
+void benchCollision();
+void benchEntities();
+void benchBroadphase();
+void benchDirtyRegions();
+void benchEdits();
+void benchRegionEdits();
+void benchPrefabs();
@@ -0,0 +1,149 @@
+#include "Bench.h"
+
+#include "Broadphase.h"
+#include "Entities.h"
+#include "Util.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+constexpr int MAX_PER_QUERY = 64;
+
+// queries checked against testing every entity, per size
+constexpr int CHECKED_QUERIES = 1000;
+
+constexpr float QUERY_MARGIN = 0.5f; // boxes are each entity's own, this much bigger
+constexpr float QUERY_RADIUS = 3.0f;
+
+static int mismatches = 0;
+
+// entities of a few sizes standing about on the terrain
+static void spawnBodies(const int count)
+{
+    Entities::clear();
+
+    Random rand(6);
+    for (int i = 0; i < count; i++)
+    {
+        const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const vec3 half = vec3(0.3f, 0.8f, 0.3f) * (0.5f + rand.nextFloat() * 2);
+
+        Entities::spawn(vec3(x + rand.nextFloat(), World::columnTops[x + z * WORLD_SIZE] - half.y, z + rand.nextFloat()), half, 0);
+    }
+}
+
+// the answer to query q, by testing every entity
+template<typename F>
+static void checkQuery(const char* what, const int q, const int* out, const int found, const F& test)
+{
+    int expected[MAX_PER_QUERY];
+    int expectedCount = 0;
+    for (int i = 0; i < Entities::count(); i++)
+    {
+        if (test(i))
+        {
+            if (expectedCount < MAX_PER_QUERY)
+                expected[expectedCount] = i;
+            expectedCount++;
+        }
+    }
+
+    int got[MAX_PER_QUERY];
+    std::copy(out, out + std::min(found, MAX_PER_QUERY), got);
+    std::sort(got, got + std::min(found, MAX_PER_QUERY));
+
+    const bool same = found == expectedCount &&
+        (found > MAX_PER_QUERY || std::equal(got, got + found, expected));
+
+    if (!same)
+    {
+        printf("Broadphase MISMATCH: %s query %d found %d entities, should be %d\n", what, q, found, expectedCount);
+        mismatches++;
+    }
+}
+
+// Broadphase::build and a box and a radius query per entity, for 1k, 10k and 100k entities
+void benchBroadphase()
+{
+    World::generateWorld(18295169L);
+
+    const int counts[] = { 1000, 10000, 100000 };
+    for (const int count : counts)
+    {
+        char label[64];
+        spawnBodies(count);
+
+        snprintf(label, sizeof(label), "Broadphase::build %dk", count / 1000);
+        Bench::run(label, count, 10, []() {
+            Broadphase::build();
+        });
+
+        Collision::Box* boxes = new Collision::Box[count];
+        vec3* centres = new vec3[count];
+        float* radii = new float[count];
+        int* out = new int[long(count) * MAX_PER_QUERY];
+        int* found = new int[count];
+
+        for (int i = 0; i < count; i++)
+        {
+            centres[i] = vec3(Entities::posX[i], Entities::posY[i], Entities::posZ[i]);
+            const vec3 half = vec3(Entities::halfX[i], Entities::halfY[i], Entities::halfZ[i]) + vec3(QUERY_MARGIN);
+            boxes[i] = { centres[i] - half, centres[i] + half };
+            radii[i] = QUERY_RADIUS;
+        }
+
+        snprintf(label, sizeof(label), "Broadphase::queryBoxes %dk", count / 1000);
+        Bench::run(label, count, 10, [&]() {
+            Broadphase::queryBoxes(count, boxes, out, found, MAX_PER_QUERY);
+        });
+
+        long pairs = 0;
+        for (int q = 0; q < count; q++)
+            pairs += found[q] - 1;
+
+        for (int q = 0; q < CHECKED_QUERIES; q++)
+        {
+            const Collision::Box& box = boxes[q];
+            checkQuery("box", q, out + long(q) * MAX_PER_QUERY, found[q], [&](const int i) {
+                using namespace Entities;
+                return posX[i] - halfX[i] < box.max.x && posX[i] + halfX[i] > box.min.x &&
+                       posY[i] - halfY[i] < box.max.y && posY[i] + halfY[i] > box.min.y &&
+                       posZ[i] - halfZ[i] < box.max.z && posZ[i] + halfZ[i] > box.min.z;
+            });
+        }
+
+        snprintf(label, sizeof(label), "Broadphase::queryRadii %dk", count / 1000);
+        Bench::run(label, count, 10, [&]() {
+            Broadphase::queryRadii(count, centres, radii, out, found, MAX_PER_QUERY);
+        });
+
+        for (int q = 0; q < CHECKED_QUERIES; q++)
+        {
+            const vec3 c = centres[q];
+            checkQuery("radius", q, out + long(q) * MAX_PER_QUERY, found[q], [&](const int i) {
+                using namespace Entities;
+                const float dx = std::max(0.0f, std::abs(c.x - posX[i]) - halfX[i]);
+                const float dy = std::max(0.0f, std::abs(c.y - posY[i]) - halfY[i]);
+                const float dz = std::max(0.0f, std::abs(c.z - posZ[i]) - halfZ[i]);
+                return dx * dx + dy * dy + dz * dz <= QUERY_RADIUS * QUERY_RADIUS;
+            });
+        }
+
+        printf("%d entities, %.2f neighbours per box query\n", count, double(pairs) / count);
+
+        delete[] boxes;
+        delete[] centres;
+        delete[] radii;
+        delete[] out;
+        delete[] found;
+    }
+
+    Entities::clear();
+    Broadphase::build();
+
+    Bench::failures += mismatches;
+    printf("Broadphase %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
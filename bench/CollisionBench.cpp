@@ -0,0 +1,223 @@
+#include "Bench.h"
+
+#include "Collision.h"
+#include "Jobs.h"
+#include "Occupancy.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+
+constexpr int BODY_COUNT = 1 << 16;
+
+// the player's box
+constexpr vec3 BODY_SIZE = vec3(0.6f, 1.6f, 0.6f);
+
+// an air room with a one block thick wall across it at WALL_X, for the tunnelling check
+constexpr int ROOM_X = 100, ROOM_Y = 20, ROOM_Z = 100;
+constexpr int ROOM_SIZE = 32;
+constexpr int WALL_X = ROOM_X + ROOM_SIZE / 2;
+
+// how far ahead Hit::time may put the wall, in blocks
+constexpr float TIME_TOLERANCE = 1e-3f;
+
+static int mismatches = 0;
+
+static int floorInt(const float val)
+{
+    const int i = int(val);
+    return i - (val < float(i));
+}
+
+static int ceilInt(const float val)
+{
+    const int i = int(val);
+    return i + (val > float(i));
+}
+
+// does the box overlap a block (or the walls around the world)? looked up block by block
+static bool insideBlocks(const Collision::Box& box)
+{
+    for (int z = floorInt(box.min.z); z < ceilInt(box.max.z); z++)
+        for (int y = floorInt(box.min.y); y < ceilInt(box.max.y); y++)
+            for (int x = floorInt(box.min.x); x < ceilInt(box.max.x); x++)
+                if (y >= 0 && (!World::isWithinWorld(vec3(x, y, z)) || World::getBlock(x, y, z) != BLOCK_AIR))
+                    return true;
+
+    return false;
+}
+
+// what collidePlayer did before Collision: try the whole move on each axis in turn, skip it if the
+// box would end up in a block. Moves that jump clean over something get through
+static void probeMove(Collision::Box& box, const vec3& motion)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const vec3 offset(motion.x * (axis == 0), motion.y * (axis == 1), motion.z * (axis == 2));
+        const vec3 min = box.min + offset, max = box.max + offset;
+
+        const bool colliding = max.y >= 0 &&
+            (min.x < 0 || min.z < 0 || max.x >= WORLD_SIZE || max.y >= WORLD_HEIGHT || max.z >= WORLD_SIZE ||
+             Occupancy::any(int(min.x), min.y < 0 ? 0 : int(min.y), int(min.z), int(max.x), int(max.y), int(max.z)));
+
+        if (!colliding)
+        {
+            box.min = min;
+            box.max = max;
+        }
+    }
+}
+
+// bodies running at the wall at every speed from walking to way more than a block per tick
+static void checkTunnelling()
+{
+    World::fillBox(BLOCK_AIR, vec3(ROOM_X, ROOM_Y, ROOM_Z), vec3(ROOM_X + ROOM_SIZE, ROOM_Y + ROOM_SIZE, ROOM_Z + ROOM_SIZE), true);
+    World::fillBox(BLOCK_STONE, vec3(WALL_X, ROOM_Y, ROOM_Z), vec3(WALL_X + 1, ROOM_Y + ROOM_SIZE, ROOM_Z + ROOM_SIZE), true);
+
+    int runs = 0, probeTunnelled = 0;
+
+    for (float speed = 0.25f; speed <= 8; speed *= 2)
+    {
+        for (int start = 0; start < 64; start++)
+        {
+            // somewhere up to a block and a bit before the wall, at an angle
+            const float gap = start / 48.0f;
+            const vec3 min(WALL_X - gap - BODY_SIZE.x, ROOM_Y + 8.0f, ROOM_Z + 8.0f + start / 64.0f);
+            const vec3 motion(speed, 0, speed * 0.25f);
+
+            Collision::Box box = { min, min + BODY_SIZE };
+            const Collision::Hit hit = Collision::sweep(box, motion);
+
+            if (gap < speed && (hit.axis != 0 || hit.normal != -1 || fabsf(hit.time * speed - gap) > TIME_TOLERANCE))
+            {
+                printf("Collision MISMATCH: %.2f blocks from the wall at %.2f blocks/tick, hit axis %d normal %d after %.4f blocks\n",
+                    gap, speed, hit.axis, hit.normal, hit.time * speed);
+                mismatches++;
+            }
+
+            Collision::move(box, motion);
+            if (box.max.x > WALL_X)
+            {
+                printf("Collision MISMATCH: %.2f blocks from the wall at %.2f blocks/tick went through it\n", gap, speed);
+                mismatches++;
+            }
+
+            Collision::Box probed = { min, min + BODY_SIZE };
+            probeMove(probed, motion);
+            if (probed.min.x >= WALL_X + 1)
+                probeTunnelled++;
+
+            runs++;
+        }
+    }
+
+    printf("old per-axis probe went through a one block wall %d times out of %d\n", probeTunnelled, runs);
+}
+
+// bodies somewhere on the terrain, moving a bit or a lot in any direction
+static void randomBodies(Collision::Box* boxes, vec3* motions, const float speed, const int seed)
+{
+    Random rand(seed);
+
+    for (int i = 0; i < BODY_COUNT; i++)
+    {
+        do
+        {
+            const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+            const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+
+            const vec3 min(x + rand.nextFloat() * 0.4f, World::columnTops[x + z * WORLD_SIZE] - 2.0f - rand.nextFloat() * 4, z + rand.nextFloat() * 0.4f);
+            boxes[i] = { min, min + BODY_SIZE };
+        } while (insideBlocks(boxes[i]));
+
+        motions[i] = vec3(rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f) * (2 * speed);
+    }
+}
+
+// nothing may end up inside a block, or further than it was asked to go
+static void checkBodies(const Collision::Box* boxes, const vec3* motions)
+{
+    int bad = 0;
+
+    for (int i = 0; i < BODY_COUNT; i++)
+    {
+        Collision::Box box = boxes[i];
+        Collision::move(box, motions[i]);
+
+        const vec3 moved = box.min - boxes[i].min;
+        const bool overshot = fabsf(moved.x) > fabsf(motions[i].x) + Collision::SKIN ||
+            fabsf(moved.y) > fabsf(motions[i].y) + Collision::SKIN ||
+            fabsf(moved.z) > fabsf(motions[i].z) + Collision::SKIN;
+
+        if (overshot || insideBlocks(box))
+            bad++;
+    }
+
+    if (bad != 0)
+    {
+        printf("Collision MISMATCH: %d of %d bodies ended up in a block or overshot\n", bad, BODY_COUNT);
+        mismatches++;
+    }
+}
+
+// Collision::move on walking and fast bodies, serial and on every thread, against the old probe. In collisions per second
+void benchCollision()
+{
+    World::generateWorld(18295169L);
+
+    Collision::Box* start = new Collision::Box[BODY_COUNT];
+    Collision::Box* boxes = new Collision::Box[BODY_COUNT];
+    vec3* motions = new vec3[BODY_COUNT];
+
+    const float speeds[] = { 0.2f, 4.0f };
+    const char* const names[] = { "walking", "fast" };
+
+    for (int s = 0; s < 2; s++)
+    {
+        char label[64];
+        randomBodies(start, motions, speeds[s], 3 + s);
+        checkBodies(start, motions);
+
+        snprintf(label, sizeof(label), "Collision::move %s bodies", names[s]);
+        Bench::run(label, BODY_COUNT, 10, [&]() {
+            for (int i = 0; i < BODY_COUNT; i++)
+            {
+                boxes[i] = start[i];
+                Collision::move(boxes[i], motions[i]);
+            }
+            Bench::sink = long(boxes[BODY_COUNT - 1].min.x);
+        });
+
+        snprintf(label, sizeof(label), "Collision::move %s bodies, %d threads", names[s], Jobs::threadCount());
+        Bench::run(label, BODY_COUNT, 10, [&]() {
+            Jobs::parallelFor(BODY_COUNT / 1024, [&](const int chunk) {
+                for (int i = chunk * 1024; i < chunk * 1024 + 1024; i++)
+                {
+                    boxes[i] = start[i];
+                    Collision::move(boxes[i], motions[i]);
+                }
+            });
+            Bench::sink = long(boxes[BODY_COUNT - 1].min.x);
+        });
+
+        snprintf(label, sizeof(label), "old per-axis probe %s bodies", names[s]);
+        Bench::run(label, BODY_COUNT, 10, [&]() {
+            for (int i = 0; i < BODY_COUNT; i++)
+            {
+                boxes[i] = start[i];
+                probeMove(boxes[i], motions[i]);
+            }
+            Bench::sink = long(boxes[BODY_COUNT - 1].min.x);
+        });
+    }
+
+    checkTunnelling();
+
+    Bench::failures += mismatches;
+    printf("Collision %s\n", mismatches == 0 ? "ok" : "FAILED");
+
+    delete[] start;
+    delete[] boxes;
+    delete[] motions;
+}
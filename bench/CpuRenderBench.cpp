@@ -0,0 +1,73 @@
+#include "Bench.h"
+
+#include "CpuRenderer.h"
+#include "Jobs.h"
+#include "TextureGenerator.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+
+// the default SCR_DETAIL resolution
+constexpr int FRAME_WIDTH = 856;
+constexpr int FRAME_HEIGHT = 480;
+
+constexpr int FRAMES = 5;
+
+// CpuRenderer::render on 1, 2, 4... threads, in rays per second
+void benchCpuRender()
+{
+    char label[64];
+
+    World::generateWorld(18295169L);
+
+    int* textureAtlas = new int[ATLAS_WIDTH * ATLAS_HEIGHT]();
+    buildTextureAtlas(151910774187927L, textureAtlas);
+    CpuRenderer::init(textureAtlas);
+    delete[] textureAtlas;
+
+    // standing on the terrain in the middle of the world, looking a little down, at midday
+    CpuRenderer::Uniforms uniforms;
+    uniforms.position = vec3(256.5f, World::columnTops[256 + 256 * WORLD_SIZE] - 2.5f, 256.5f);
+    uniforms.cosYaw = cosf(0.7f);
+    uniforms.sinYaw = sinf(0.7f);
+    uniforms.cosPitch = cosf(-0.3f);
+    uniforms.sinPitch = sinf(-0.3f);
+    uniforms.frustumDiv = vec2(FRAME_WIDTH * 90.0f / 214, FRAME_HEIGHT * 90.0f / 120);
+    uniforms.lightDirection = vec3::normalize(vec3(-0.35f, -0.7f, 0.6f));
+    uniforms.skyColor = YC_DAY;
+    uniforms.ambColor = AC_DAY;
+    uniforms.sunColor = SC_DAY;
+
+    double singleThreadRate = 0;
+
+    for (int threads = 1;; threads *= 2)
+    {
+        if (threads > Jobs::threadCount())
+            threads = Jobs::threadCount();
+
+        Jobs::setThreadLimit(threads);
+
+        CpuRenderer::render(uniforms, FRAME_WIDTH, FRAME_HEIGHT); // warm up
+
+        long rays = 0;
+        const double start = Bench::seconds();
+        for (int i = 0; i < FRAMES; i++)
+            rays += CpuRenderer::render(uniforms, FRAME_WIDTH, FRAME_HEIGHT);
+        const double seconds = Bench::seconds() - start;
+
+        snprintf(label, sizeof(label), "CpuRenderer %d threads (rays)", threads);
+        Bench::report(label, seconds, rays);
+
+        const double rate = rays / seconds;
+        if (threads == 1)
+            singleThreadRate = rate;
+
+        printf("%.1f fps, %.2fx one thread\n", FRAMES / seconds, rate / singleThreadRate);
+
+        if (threads == Jobs::threadCount())
+            break;
+    }
+
+    Jobs::setThreadLimit(0);
+}
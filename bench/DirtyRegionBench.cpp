@@ -0,0 +1,226 @@
+#include "Bench.h"
+
+#include "DirtyRegions.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cstdio>
+
+constexpr int EDIT_OPS = 1 << 16;
+
+// edits anywhere in the world
+constexpr int SCATTERED_EDITS = 1000;
+
+// a tunnel dug like the player digs, a few blocks per tick
+constexpr int TUNNEL_TICKS = 200;
+
+static int mismatches = 0;
+
+static bool covers(const DirtyRegions& dirty, const int x, const int y, const int z)
+{
+    bool covered = false;
+    dirty.forEach([&](const DirtyRegion& r) {
+        covered = covered || (x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1 && z >= r.z0 && z < r.z1);
+    });
+
+    return covered;
+}
+
+static long coveredVolume(const DirtyRegions& dirty)
+{
+    long volume = 0;
+    dirty.forEach([&](const DirtyRegion& r) { volume += r.volume(); });
+    return volume;
+}
+
+// flip blocks along a walk (or all over the world) and check takeDirty covers every one
+static void checkEdits(const char* what, const bool tunnel)
+{
+    int* xs = new int[TUNNEL_TICKS * 12 + SCATTERED_EDITS];
+    int* ys = new int[TUNNEL_TICKS * 12 + SCATTERED_EDITS];
+    int* zs = new int[TUNNEL_TICKS * 12 + SCATTERED_EDITS];
+    int edits = 0;
+
+    DirtyRegions dirty;
+    World::takeDirty(dirty); // start clean
+    dirty.clear();
+
+    Random rand(8);
+    if (tunnel)
+    {
+        // the 12 points tick() clears around the player, walking a block every 5 ticks
+        for (int t = 0; t < TUNNEL_TICKS; t++)
+        {
+            const vec3 pos(200.5f + t * 0.2f, 30.5f, 200.5f + t * 0.05f);
+            for (int i = 0; i < 12; i++)
+            {
+                xs[edits] = int(pos.x + (i & 1) * 0.6f - 0.3f);
+                ys[edits] = int(pos.y + float((i >> 2) - 1) * 0.8f + 0.65f);
+                zs[edits] = int(pos.z + (i >> 1 & 1) * 0.6f - 0.3f);
+                edits++;
+            }
+        }
+    }
+    else
+    {
+        for (; edits < SCATTERED_EDITS; edits++)
+        {
+            xs[edits] = rand.nextInt(WORLD_SIZE);
+            ys[edits] = rand.nextInt(WORLD_HEIGHT);
+            zs[edits] = rand.nextInt(WORLD_SIZE);
+        }
+    }
+
+    for (int i = 0; i < edits; i++)
+    {
+        const uint8_t block = World::getBlock(xs[i], ys[i], zs[i]) == BLOCK_AIR ? BLOCK_STONE : BLOCK_AIR;
+        World::setBlock(xs[i], ys[i], zs[i], block);
+    }
+
+    World::takeDirty(dirty);
+
+    int missed = 0;
+    for (int i = 0; i < edits; i++)
+        missed += !covers(dirty, xs[i], ys[i], zs[i]);
+
+    if (missed != 0)
+    {
+        printf("DirtyRegions MISMATCH: %s, %d of %d edited blocks not in any region\n", what, missed, edits);
+        mismatches++;
+    }
+
+    // at worst each edit gets a brick to itself
+    if (coveredVolume(dirty) > long(edits) * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+    {
+        printf("DirtyRegions MISMATCH: %s, %ld blocks uploaded for %d edits\n", what, coveredVolume(dirty), edits);
+        mismatches++;
+    }
+
+    printf("%s: %d edits -> %d regions and %d bricks covering %ld blocks\n", what, edits, dirty.count, dirty.brickCount, coveredVolume(dirty));
+
+    // the loose bricks have to come out whole and leave none behind
+    const long brickVolume = long(dirty.brickCount) * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    long taken = 0;
+
+    DirtyRegion piece;
+    while (dirty.takeBricks(UPLOAD_BUDGET, piece))
+        taken += piece.volume();
+
+    if (taken != brickVolume || dirty.brickCount != 0)
+    {
+        printf("DirtyRegions MISMATCH: %s, took %ld of %ld blocks of bricks\n", what, taken, brickVolume);
+        mismatches++;
+    }
+
+    delete[] xs;
+    delete[] ys;
+    delete[] zs;
+}
+
+// a box too big for one frame has to come out as whole slabs that tile it, none over budget
+static void checkSlabs()
+{
+    DirtyRegions dirty;
+    World::takeDirty(dirty);
+    dirty.clear();
+
+    World::fillBox(BLOCK_STONE, vec3(10, 5, 10), vec3(300, 60, 400), true);
+    World::takeDirty(dirty);
+
+    if (dirty.count != 1)
+    {
+        printf("DirtyRegions MISMATCH: fillBox came out as %d regions\n", dirty.count);
+        mismatches++;
+        return;
+    }
+
+    DirtyRegion region = dirty.regions[0];
+    const long volume = region.volume();
+    int nextZ = region.z0;
+    long taken = 0;
+    int frames = 0;
+
+    DirtyRegion piece;
+    while (region.z0 < region.z1 && takeSlabs(region, UPLOAD_BUDGET, piece))
+    {
+        if (piece.z0 != nextZ || piece.volume() > UPLOAD_BUDGET || piece.x0 != 10 || piece.x1 != 300 || piece.y0 != 5 || piece.y1 != 60)
+        {
+            printf("DirtyRegions MISMATCH: slab %d..%d doesn't follow on or is over budget\n", piece.z0, piece.z1);
+            mismatches++;
+        }
+
+        nextZ = piece.z1;
+        taken += piece.volume();
+        frames++;
+    }
+
+    if (taken != volume)
+    {
+        printf("DirtyRegions MISMATCH: slabs add up to %ld of %ld blocks\n", taken, volume);
+        mismatches++;
+    }
+
+    printf("a %ld block fillBox uploads over %d frames at %d bytes a frame\n", volume, frames, UPLOAD_BUDGET);
+}
+
+// DirtyRegions::add, setBlock with the tracking and filling a frame's staging buffer
+void benchDirtyRegions()
+{
+    World::generateWorld(18295169L);
+
+    checkEdits("tunnel", true);
+    checkEdits("scattered", false);
+    checkSlabs();
+
+    DirtyRegions dirty;
+    Random rand(9);
+
+    int* coords = new int[EDIT_OPS * 3];
+    for (int i = 0; i < EDIT_OPS; i++)
+    {
+        // around a player digging about
+        coords[i * 3] = 200 + rand.nextInt(16);
+        coords[i * 3 + 1] = 20 + rand.nextInt(16);
+        coords[i * 3 + 2] = 200 + rand.nextInt(16);
+    }
+
+    Bench::run("DirtyRegions::add nearby blocks", EDIT_OPS, 10, [&]() {
+        for (int i = 0; i < EDIT_OPS; i++)
+        {
+            // a frame's worth at a time
+            if ((i & 63) == 0)
+                dirty.clear();
+
+            const short x = short(coords[i * 3]), y = short(coords[i * 3 + 1]), z = short(coords[i * 3 + 2]);
+            dirty.add({ x, y, z, short(x + 1), short(y + 1), short(z + 1) });
+        }
+        Bench::sink = dirty.count;
+    });
+
+    Bench::run("World::setBlock with dirty tracking", EDIT_OPS, 10, [&]() {
+        for (int i = 0; i < EDIT_OPS; i++)
+            World::setBlock(coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2], (i & 1) ? BLOCK_STONE : BLOCK_AIR);
+
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    // the CPU half of a frame's upload, filling the staging buffer
+    uint8_t* staging = new uint8_t[UPLOAD_BUDGET];
+    DirtyRegion whole = { 0, 0, 0, WORLD_SIZE, WORLD_HEIGHT, WORLD_SIZE };
+    Bench::run("World::readBox UPLOAD_BUDGET (bytes)", UPLOAD_BUDGET, 10, [&]() {
+        DirtyRegion piece;
+        takeSlabs(whole, UPLOAD_BUDGET, piece);
+        if (whole.z0 == whole.z1)
+            whole.z0 = 0;
+
+        World::readBox(piece.x0, piece.y0, piece.z0, piece.x1 - piece.x0, piece.y1 - piece.y0, piece.z1 - piece.z0, staging);
+        Bench::sink = staging[0];
+    });
+
+    delete[] staging;
+    delete[] coords;
+
+    Bench::failures += mismatches;
+    printf("DirtyRegions %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
@@ -0,0 +1,278 @@
+#include "Bench.h"
+
+#include "Game.h"
+#include "Player.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// eyes checked against walking the ray block by block, and timed
+constexpr int PICKS = 1 << 14;
+
+// edits checked for coming out the same batched as one at a time
+constexpr int CHECKED_EDITS = 4000;
+
+// what a tick's batch would hold when the queue's full
+constexpr int BATCH_SIZE = EDIT_QUEUE_SIZE;
+
+constexpr int EDIT_OPS = BATCH_SIZE * 64;
+
+static int mismatches = 0;
+
+// the first non-air block along the ray within maxDist, one block boundary at a time
+static bool walkRay(const vec3& origin, const vec3& dir, const float maxDist, int* cell)
+{
+    const float start[3] = { origin.x, origin.y, origin.z };
+    const float d[3] = { dir.x, dir.y, dir.z };
+
+    int pos[3] = { int(origin.x), int(origin.y), int(origin.z) };
+    int step[3];
+    float next[3], delta[3];
+
+    for (int a = 0; a < 3; a++)
+    {
+        step[a] = d[a] > 0 ? 1 : -1;
+        delta[a] = fabsf(1.0f / d[a]);
+        next[a] = (d[a] > 0 ? pos[a] + 1 - start[a] : start[a] - pos[a]) * delta[a];
+    }
+
+    float travelled = 0;
+    while (travelled <= maxDist)
+    {
+        if (!World::isWithinWorld(vec3(pos[0], pos[1], pos[2])))
+            return false;
+
+        if (World::getBlock(pos[0], pos[1], pos[2]) != BLOCK_AIR)
+        {
+            memcpy(cell, pos, sizeof(pos));
+            return true;
+        }
+
+        // same tie break as World::raycast
+        const int a = next[1] < next[0] ? (next[1] < next[2] ? 1 : 2) : (next[0] < next[2] ? 0 : 2);
+        pos[a] += step[a];
+        travelled = next[a];
+        next[a] += delta[a];
+    }
+
+    return false;
+}
+
+// eyes standing a little above the terrain, looking anywhere
+static void randomEyes(vec3* eyes, vec3* dirs)
+{
+    Random rand(10);
+
+    for (int i = 0; i < PICKS; i++)
+    {
+        const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+
+        eyes[i] = vec3(x + rand.nextFloat(), World::columnTops[x + z * WORLD_SIZE] - 1.0f - rand.nextFloat() * 3, z + rand.nextFloat());
+
+        // the same as turnCamera and pickBlocks work it out
+        const float yaw = (rand.nextFloat() * 2 - 1) * PI;
+        const float pitch = (rand.nextFloat() - 0.5f) * PI;
+        dirs[i] = vec3(cosf(pitch) * sinf(yaw), -sinf(pitch), cosf(pitch) * cosf(yaw));
+    }
+}
+
+// raycast picks the same block as the walk, and the block to place in is in front of it
+static void checkPicks(const vec3* eyes, const vec3* dirs)
+{
+    int hits = 0;
+
+    for (int i = 0; i < PICKS; i++)
+    {
+        int axis = -1;
+        int coords[3];
+        World::raycast(eyes[i], dirs[i], PLAYER_REACH, axis, nullptr, coords);
+
+        int expected[3];
+        const bool hit = walkRay(eyes[i], dirs[i], PLAYER_REACH, expected);
+
+        if (hit != (axis >= 0) || (hit && memcmp(coords, expected, sizeof(coords)) != 0))
+        {
+            printf("Edits MISMATCH: pick %d hit %d (%d, %d, %d), the walk hit %d (%d, %d, %d)\n", i,
+                axis >= 0, coords[0], coords[1], coords[2], hit, expected[0], expected[1], expected[2]);
+            mismatches++;
+            continue;
+        }
+
+        if (!hit)
+            continue;
+
+        hits++;
+
+        // the cell the ray came from, unless the eye is in the block itself
+        coords[axis % 3] += axis >= 3 ? -1 : 1;
+        const vec3 place(coords[0], coords[1], coords[2]);
+        const bool eyeInside = int(eyes[i].x) == expected[0] && int(eyes[i].y) == expected[1] && int(eyes[i].z) == expected[2];
+
+        if (!eyeInside && World::isWithinWorld(place) && World::getBlock(place) != BLOCK_AIR)
+        {
+            printf("Edits MISMATCH: pick %d would place into a block at (%d, %d, %d)\n", i, coords[0], coords[1], coords[2]);
+            mismatches++;
+        }
+    }
+
+    printf("%d of %d picks within reach hit a block\n", hits, PICKS);
+}
+
+// edits all over the world and bunched up, some of them to the same block
+static void randomEdits(World::BlockEdit* edits, const int count, const int seed)
+{
+    Random rand(seed);
+
+    for (int i = 0; i < count; i++)
+    {
+        const bool nearby = i % 4 != 0;
+        edits[i].x = short(nearby ? 200 + rand.nextInt(8) : rand.nextInt(WORLD_SIZE));
+        edits[i].y = short(nearby ? 20 + rand.nextInt(8) : rand.nextInt(WORLD_HEIGHT));
+        edits[i].z = short(nearby ? 200 + rand.nextInt(8) : rand.nextInt(WORLD_SIZE));
+        edits[i].block = rand.nextInt(3) == 0 ? BLOCK_AIR : BLOCK_STONE;
+    }
+}
+
+// setBlocks has to leave the blocks, column tops and bricks as the same setBlock calls
+static void checkBatch()
+{
+    World::BlockEdit* edits = new World::BlockEdit[CHECKED_EDITS];
+    randomEdits(edits, CHECKED_EDITS, 11);
+
+    uint8_t* columnTops = new uint8_t[WORLD_SIZE * WORLD_SIZE];
+    uint8_t* bricks = new uint8_t[BRICKS_X * BRICKS_Y * BRICKS_Z];
+
+    World::generateWorld(18295169L);
+    for (int i = 0; i < CHECKED_EDITS; i++)
+        World::setBlock(edits[i].x, edits[i].y, edits[i].z, edits[i].block);
+
+    const uint64_t oneAtATime = World::hash();
+    const int terrainTop = World::terrainTop;
+    memcpy(columnTops, World::columnTops, WORLD_SIZE * WORLD_SIZE);
+    memcpy(bricks, World::bricks, BRICKS_X * BRICKS_Y * BRICKS_Z);
+
+    World::generateWorld(18295169L);
+    for (int i = 0; i < CHECKED_EDITS; i += BATCH_SIZE)
+        World::setBlocks(edits + i, CHECKED_EDITS - i < BATCH_SIZE ? CHECKED_EDITS - i : BATCH_SIZE);
+
+    if (World::hash() != oneAtATime || World::terrainTop != terrainTop ||
+        memcmp(columnTops, World::columnTops, WORLD_SIZE * WORLD_SIZE) != 0 ||
+        memcmp(bricks, World::bricks, BRICKS_X * BRICKS_Y * BRICKS_Z) != 0)
+    {
+        printf("Edits MISMATCH: setBlocks left a different world to setBlock\n");
+        mismatches++;
+    }
+
+    delete[] edits;
+    delete[] columnTops;
+    delete[] bricks;
+}
+
+// a full queue of placements in a tick has to go through as one box to upload, and no more than
+// EDIT_QUEUE_SIZE may wait
+static void checkQueue()
+{
+    // a room for the player and a wall of blocks next to them
+    const vec3 room(300, 20, 300);
+    World::fillBox(BLOCK_AIR, room, room + vec3(16), true);
+    playerPos = room + vec3(2.5f, 8, 2.5f);
+    playerVelocity = vec3(0);
+
+    DirtyRegions dirty;
+    World::takeDirty(dirty);
+    dirty.clear();
+
+    int queued = 0;
+    for (int i = 0; i < EDIT_QUEUE_SIZE + 8; i++)
+        queued += queueEdit({ short(room.x + 8 + i % 8), short(room.y + 4 + i / 8 % 8), short(room.z + 8), BLOCK_BRICKS });
+
+    if (queued != EDIT_QUEUE_SIZE)
+    {
+        printf("Edits MISMATCH: queued %d edits, should stop at %d\n", queued, EDIT_QUEUE_SIZE);
+        mismatches++;
+    }
+
+    tick();
+    World::takeDirty(dirty);
+
+    int placed = 0;
+    for (int i = 0; i < EDIT_QUEUE_SIZE; i++)
+        placed += World::getBlock(room.x + 8 + i % 8, room.y + 4 + i / 8 % 8, room.z + 8) == BLOCK_BRICKS;
+
+    if (placed != EDIT_QUEUE_SIZE || dirty.count != 1)
+    {
+        printf("Edits MISMATCH: a tick placed %d of %d queued blocks as %d dirty regions\n", placed, EDIT_QUEUE_SIZE, dirty.count);
+        mismatches++;
+    }
+
+    // the player's own block can't be placed into
+    queueEdit({ short(playerPos.x), short(playerPos.y + 1), short(playerPos.z), BLOCK_BRICKS });
+    tick();
+    if (World::getBlock(playerPos.x, playerPos.y + 1, playerPos.z) != BLOCK_AIR)
+    {
+        printf("Edits MISMATCH: placed a block inside the player\n");
+        mismatches++;
+    }
+
+    printf("a tick of %d rapid-fire edits uploads as %d region\n", EDIT_QUEUE_SIZE, dirty.count);
+}
+
+// picking under the crosshair, and World::setBlock one at a time against tick sized setBlocks batches
+void benchEdits()
+{
+    World::generateWorld(18295169L);
+
+    vec3* eyes = new vec3[PICKS];
+    vec3* dirs = new vec3[PICKS];
+    randomEyes(eyes, dirs);
+
+    checkPicks(eyes, dirs);
+
+    Bench::run("World::raycast pick within PLAYER_REACH", PICKS, 10, [&]() {
+        long hits = 0;
+        for (int i = 0; i < PICKS; i++)
+        {
+            int axis = -1;
+            int coords[3];
+            World::raycast(eyes[i], dirs[i], PLAYER_REACH, axis, nullptr, coords);
+            hits += axis >= 0;
+        }
+        Bench::sink = hits;
+    });
+
+    delete[] eyes;
+    delete[] dirs;
+
+    checkBatch();
+    checkQueue();
+
+    World::BlockEdit* edits = new World::BlockEdit[EDIT_OPS];
+    randomEdits(edits, EDIT_OPS, 12);
+
+    DirtyRegions dirty;
+
+    Bench::run("World::setBlock one edit at a time", EDIT_OPS, 10, [&]() {
+        for (int i = 0; i < EDIT_OPS; i++)
+            World::setBlock(edits[i].x, edits[i].y, edits[i].z, edits[i].block);
+
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    Bench::run("World::setBlocks a tick's queue at a time", EDIT_OPS, 10, [&]() {
+        for (int i = 0; i < EDIT_OPS; i += BATCH_SIZE)
+            World::setBlocks(edits + i, BATCH_SIZE);
+
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    delete[] edits;
+
+    Bench::failures += mismatches;
+    printf("Edits %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
@@ -0,0 +1,137 @@
+#include "Bench.h"
+
+#include "Entities.h"
+#include "Jobs.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cstdio>
+#include <cstring>
+
+// what a tick has to fit in
+constexpr double TICK_BUDGET = 0.010;
+
+constexpr int TICKS = 20;
+
+static int mismatches = 0;
+
+static void check(const bool ok, const char* what)
+{
+    if (!ok)
+    {
+        printf("Entities MISMATCH: %s\n", what);
+        mismatches++;
+    }
+}
+
+static void checkHandles()
+{
+    Entities::clear();
+
+    const Entities::Handle a = Entities::spawn(vec3(1), vec3(0.3f), 0);
+    const Entities::Handle b = Entities::spawn(vec3(2), vec3(0.3f), 0);
+    const Entities::Handle c = Entities::spawn(vec3(3), vec3(0.3f), 0);
+
+    Entities::despawn(a);
+    check(!Entities::alive(a), "despawned entity still alive");
+    check(Entities::alive(b) && Entities::alive(c) && Entities::count() == 2, "despawn took others with it");
+    check(Entities::posX[Entities::indexOf(c)] == 3 && Entities::posX[Entities::indexOf(b)] == 2, "despawn mixed up the others");
+
+    // a's slot again, under a new generation
+    const Entities::Handle d = Entities::spawn(vec3(4), vec3(0.3f), 0);
+    check(d.slot == a.slot && d.generation != a.generation, "slot not reused");
+    check(!Entities::alive(a) && Entities::posX[Entities::indexOf(d)] == 4, "stale handle reached the new entity");
+
+    Entities::despawn(a);
+    check(Entities::alive(d), "despawning a stale handle despawned the new entity");
+
+    while (Entities::count() < MAX_ENTITIES)
+        Entities::spawn(vec3(5), vec3(0.3f), 0);
+    check(!Entities::alive(Entities::spawn(vec3(6), vec3(0.3f), 0)), "spawned past MAX_ENTITIES");
+
+    Entities::clear();
+    check(Entities::count() == 0 && !Entities::alive(b) && !Entities::alive(d), "clear left entities alive");
+}
+
+// player sized bodies falling onto the terrain and wandering about
+static void spawnBodies(const int count)
+{
+    Entities::clear();
+
+    Random rand(5);
+    for (int i = 0; i < count; i++)
+    {
+        const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+
+        const vec3 pos(x + 0.5f, World::columnTops[x + z * WORLD_SIZE] - 1.0f - rand.nextFloat() * 8, z + 0.5f);
+        const Entities::Handle entity = Entities::spawn(pos, vec3(0.3f, 0.8f, 0.3f), Entities::ENTITY_GRAVITY | Entities::ENTITY_COLLIDES);
+
+        const int e = Entities::indexOf(entity);
+        Entities::velX[e] = (rand.nextFloat() - 0.5f) * 0.4f;
+        Entities::velZ[e] = (rand.nextFloat() - 0.5f) * 0.4f;
+    }
+}
+
+static uint64_t positionHash()
+{
+    uint64_t hash = 0;
+    for (int i = 0; i < Entities::count(); i++)
+    {
+        uint32_t bits[3];
+        memcpy(&bits[0], &Entities::posX[i], 4);
+        memcpy(&bits[1], &Entities::posY[i], 4);
+        memcpy(&bits[2], &Entities::posZ[i], 4);
+        hash = (hash ^ bits[0] ^ uint64_t(bits[1]) << 21 ^ uint64_t(bits[2]) << 42) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Entities::update on 10k to 100k bodies, in entities per second and against the 10 ms tick
+void benchEntities()
+{
+    World::generateWorld(18295169L);
+
+    checkHandles();
+
+    // the job split mustn't change anything
+    spawnBodies(50000);
+    Jobs::setThreadLimit(1);
+    for (int i = 0; i < TICKS; i++)
+        Entities::update();
+    const uint64_t serialHash = positionHash();
+
+    spawnBodies(50000);
+    Jobs::setThreadLimit(0);
+    for (int i = 0; i < TICKS; i++)
+        Entities::update();
+    check(positionHash() == serialHash, "update on all threads came out different to one thread");
+
+    const int counts[] = { 10000, 50000, 100000 };
+    for (const int count : counts)
+    {
+        char label[64];
+        snprintf(label, sizeof(label), "Entities::update %dk entities", count / 1000);
+
+        spawnBodies(count);
+        Entities::update(); // warm up
+
+        const double start = Bench::seconds();
+        for (int i = 0; i < TICKS; i++)
+            Entities::update();
+        const double seconds = (Bench::seconds() - start) / TICKS;
+
+        Bench::report(label, seconds * TICKS, long(count) * TICKS);
+
+        snprintf(label, sizeof(label), "Entities::update %dk entities tick", count / 1000);
+        Bench::value(label, seconds * 1000, "ms");
+
+        printf("%.2f ms per tick on %d threads, %s the %.0f ms budget\n", seconds * 1000, Jobs::threadCount(),
+            seconds <= TICK_BUDGET ? "within" : "over", TICK_BUDGET * 1000);
+    }
+
+    Entities::clear();
+
+    Bench::failures += mismatches;
+    printf("Entities %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
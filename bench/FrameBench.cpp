@@ -0,0 +1,216 @@
+#include "Bench.h"
+
+#include "CpuRenderer.h"
+#include "Game.h"
+#include "InputTrace.h"
+#include "Player.h"
+#include "TextureGenerator.h"
+#include "Util.h"
+#include "World.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// what run() renders at by default (SCR_DETAIL 2)
+constexpr int FRAME_WIDTH = 428;
+constexpr int FRAME_HEIGHT = 240;
+constexpr float FOV = 90.0f;
+
+// replays run at a steady 60 fps of game time, however long the frames really take
+constexpr float FRAME_LENGTH = 1000.0f / 60;
+
+// noon, so there are shadows to trace
+constexpr float START_TIME = 3 * PI / 2 * 10000;
+
+constexpr int BUILT_IN_FRAMES = 300;
+
+// five seconds of walking forward with a new direction every second, strafing, looking up
+// and down and jumping now and then. Used when there's no --trace
+static InputFrame* builtInTrace(int& frameCount)
+{
+    Random rand(1);
+
+    InputFrame* frames = new InputFrame[BUILT_IN_FRAMES];
+    int turn = 0;
+
+    for (int i = 0; i < BUILT_IN_FRAMES; i++)
+    {
+        if (i % 60 == 0)
+            turn = int(rand.nextInt(21)) - 10;
+
+        frames[i].mouseX = short(turn);
+        frames[i].mouseY = short(i % 120 < 60 ? 1 : -1);
+        frames[i].keys = KEY_FORWARD | (i % 90 < 10 ? KEY_JUMP : 0) | (i % 240 >= 180 ? KEY_LEFT : 0);
+    }
+
+    frameCount = BUILT_IN_FRAMES;
+    return frames;
+}
+
+struct ReplayStats
+{
+    double* frameTimes; // seconds, one per frame
+    double* tickTimes; // seconds, one per tick
+    int tickCount;
+    long rays;
+    double seconds;
+};
+
+// run() without the window: the same input, sky, ticks and picking, and a CPU render per frame
+static void replay(const InputFrame* frames, const int frameCount, const uint64_t seed, ReplayStats& stats)
+{
+    World::generateWorld(seed);
+
+    resetGame();
+
+    float frameTime = START_TIME;
+    startTicks(frameTime);
+
+    stats.tickCount = 0;
+    stats.rays = 0;
+
+    const double start = Bench::seconds();
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        const double frameStart = Bench::seconds();
+
+        frameTime += FRAME_LENGTH;
+
+        applyInput(frames[frame]);
+        updateSky(frameTime);
+
+        // each of the frame's ticks gets their average
+        const double ticksStart = Bench::seconds();
+        const int ticks = runTicks(frameTime);
+        const double tickTime = (Bench::seconds() - ticksStart) / (ticks > 0 ? ticks : 1);
+
+        for (int i = 0; i < ticks; i++)
+            stats.tickTimes[stats.tickCount++] = tickTime;
+
+        pickBlocks(frames[frame], renderPos, frameTime);
+
+        CpuRenderer::Uniforms uniforms;
+        uniforms.position = renderPos;
+        uniforms.cosYaw = cosYaw;
+        uniforms.cosPitch = cosPitch;
+        uniforms.sinYaw = sinYaw;
+        uniforms.sinPitch = sinPitch;
+        uniforms.frustumDiv = vec2(FRAME_WIDTH * FOV / 214, FRAME_HEIGHT * FOV / 120);
+        uniforms.lightDirection = lightDirection;
+        uniforms.skyColor = skyColor;
+        uniforms.ambColor = ambColor;
+        uniforms.sunColor = sunColor;
+
+        stats.rays += CpuRenderer::render(uniforms, FRAME_WIDTH, FRAME_HEIGHT);
+
+        stats.frameTimes[frame] = Bench::seconds() - frameStart;
+    }
+
+    stats.seconds = Bench::seconds() - start;
+}
+
+static void printPercentiles(const char* name, double* times, const int count)
+{
+    if (count == 0)
+        return;
+
+    std::sort(times, times + count);
+
+    const auto percentile = [&](const double p) {
+        return times[std::min(count - 1, int(p * count))] * 1000;
+    };
+
+    printf("%-40s p50 %7.3f ms  p95 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+        name, percentile(0.5), percentile(0.95), percentile(0.99), times[count - 1] * 1000);
+
+    char label[64];
+    const char* names[] = { "p50", "p95", "p99" };
+    const double ps[] = { 0.5, 0.95, 0.99 };
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(label, sizeof(label), "%s %s", name, names[i]);
+        Bench::value(label, percentile(ps[i]), "ms");
+    }
+}
+
+// after a stall runTicks should run MAX_TICKS_PER_FRAME ticks and drop the rest, not all of them
+static void checkTickBudget()
+{
+    const long overruns = tickOverruns;
+    const long dropped = droppedTicks;
+
+    startTicks(0);
+    const int stallTicks = runTicks(1000);
+    const int nextTicks = runTicks(1000 + TICK_LENGTH / 2);
+
+    if (stallTicks != MAX_TICKS_PER_FRAME || nextTicks != 0 || tickOverruns != overruns + 1 || droppedTicks <= dropped)
+    {
+        printf("tick budget MISMATCH: %d ticks after a 1 s stall, %d the frame after\n", stallTicks, nextTicks);
+        Bench::failures++;
+    }
+
+    tickOverruns = overruns;
+    droppedTicks = dropped;
+}
+
+// a recorded (or the built-in) input trace played back headless at a fixed timestep.
+// Frame and tick time percentiles and overall throughput, for catching regressions on CI
+void benchFrame()
+{
+    uint64_t seed = RECORDING_SEED;
+    int frameCount = 0;
+    InputFrame* frames = nullptr;
+
+    if (Bench::tracePath != nullptr)
+    {
+        frames = InputTrace::load(Bench::tracePath, seed, frameCount);
+        if (frames == nullptr)
+        {
+            printf("frame: can't read the trace %s\n", Bench::tracePath);
+            return;
+        }
+    }
+    else
+        frames = builtInTrace(frameCount);
+
+    World::generateWorld(seed);
+    checkTickBudget();
+
+    int* textureAtlas = new int[ATLAS_WIDTH * ATLAS_HEIGHT]();
+    buildTextureAtlas(151910774187927L, textureAtlas);
+    CpuRenderer::init(textureAtlas);
+    delete[] textureAtlas;
+
+    ReplayStats stats;
+    stats.frameTimes = new double[frameCount];
+    stats.tickTimes = new double[int(frameCount * FRAME_LENGTH / TICK_LENGTH) + 2];
+
+    // once to warm up, and to check the replay ends up in the same place every time
+    replay(frames, frameCount, seed, stats);
+    const vec3 firstPos = playerPos;
+    const uint64_t firstHash = World::hash();
+
+    replay(frames, frameCount, seed, stats);
+
+    if (playerPos.x != firstPos.x || playerPos.y != firstPos.y || playerPos.z != firstPos.z || World::hash() != firstHash)
+    {
+        printf("frame replay MISMATCH: two replays of the same trace ended differently\n");
+        Bench::failures++;
+    }
+
+    printf("replayed %d frames, %d ticks, ended at (%.2f, %.2f, %.2f), %ld tick overruns\n",
+        frameCount, stats.tickCount, playerPos.x, playerPos.y, playerPos.z, tickOverruns);
+
+    printPercentiles("frame time", stats.frameTimes, frameCount);
+    printPercentiles("tick time", stats.tickTimes, stats.tickCount);
+
+    Bench::report("replay (rays)", stats.seconds, stats.rays);
+    printf("%.1f fps, %.1f ticks/s\n", frameCount / stats.seconds, stats.tickCount / stats.seconds);
+
+    Bench::value("fps", frameCount / stats.seconds, "frames/s");
+
+    delete[] stats.frameTimes;
+    delete[] stats.tickTimes;
+    delete[] frames;
+}
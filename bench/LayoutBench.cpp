@@ -0,0 +1,106 @@
+#include "Bench.h"
+
+#include "Player.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cstdio>
+
+#ifdef CHUNKED_WORLD
+static const char* layoutName = "chunked";
+#else
+static const char* layoutName = WORLD_LAYOUT::name;
+#endif
+
+constexpr int FILL_BOXES = 256;
+constexpr int COLLISIONS = 1 << 18;
+constexpr int RAYS = 1 << 16;
+
+// y of the first solid block in the column, WORLD_HEIGHT if there's none
+static int surfaceHeight(const int x, const int z)
+{
+    int y = 0;
+    while (y < WORLD_HEIGHT && World::getBlock(x, y, z) == BLOCK_AIR)
+        y++;
+
+    return y;
+}
+
+void benchLayout()
+{
+    char label[64];
+    Random rand(1);
+
+    snprintf(label, sizeof(label), "%s generateWorld", layoutName);
+    Bench::run(label, 1, 2, []() {
+        World::generateWorld(18295169L);
+    });
+
+    // random 16^3 boxes, filled and then dug out again
+    vec3* boxes = new vec3[FILL_BOXES];
+    for (int i = 0; i < FILL_BOXES; i++)
+        boxes[i] = vec3(rand.nextInt(WORLD_SIZE - 16), rand.nextInt(WORLD_HEIGHT - 16), rand.nextInt(WORLD_SIZE - 16));
+
+    snprintf(label, sizeof(label), "%s fillBox 16^3 (per block)", layoutName);
+    Bench::run(label, FILL_BOXES * 16 * 16 * 16 * 2, 5, [&]() {
+        for (int i = 0; i < FILL_BOXES; i++)
+            World::fillBox(BLOCK_STONE, boxes[i], boxes[i] + vec3(16), true);
+        for (int i = 0; i < FILL_BOXES; i++)
+            World::fillBox(BLOCK_AIR, boxes[i], boxes[i] + vec3(16), true);
+    });
+
+    // restore the terrain for the next benchmarks
+    World::generateWorld(18295169L);
+
+    // players standing on the surface, moving in random directions
+    vec3* positions = new vec3[COLLISIONS];
+    vec3* velocities = new vec3[COLLISIONS];
+    for (int i = 0; i < COLLISIONS; i++)
+    {
+        const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+
+        positions[i] = vec3(x + 0.5f, surfaceHeight(x, z) - 1.0f, z + 0.5f);
+        velocities[i] = vec3(rand.nextFloat() - 0.5f, rand.nextFloat() * 0.1f - 0.05f, rand.nextFloat() - 0.5f) * 0.4f;
+    }
+
+    snprintf(label, sizeof(label), "%s collidePlayer", layoutName);
+    Bench::run(label, COLLISIONS, 5, [&]() {
+        for (int i = 0; i < COLLISIONS; i++)
+        {
+            playerPos = positions[i];
+            playerVelocity = velocities[i];
+            collidePlayer();
+        }
+        Bench::sink = long(playerPos.x);
+    });
+
+    // rays from just above the surface in random directions
+    vec3* origins = new vec3[RAYS];
+    vec3* directions = new vec3[RAYS];
+    for (int i = 0; i < RAYS; i++)
+    {
+        const int x = rand.nextInt(WORLD_SIZE);
+        const int z = rand.nextInt(WORLD_SIZE);
+
+        origins[i] = vec3(x + rand.nextFloat(), surfaceHeight(x, z) - 1.5f, z + rand.nextFloat());
+        directions[i] = vec3(rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f).normalized();
+    }
+
+    snprintf(label, sizeof(label), "%s raycast", layoutName);
+    Bench::run(label, RAYS, 5, [&]() {
+        int hits = 0;
+        for (int i = 0; i < RAYS; i++)
+        {
+            int hitAxis;
+            hits += World::raycast(origins[i], directions[i], RENDER_DIST, hitAxis).x >= 0;
+        }
+        Bench::sink = hits;
+    });
+
+    delete[] boxes;
+    delete[] positions;
+    delete[] velocities;
+    delete[] origins;
+    delete[] directions;
+}
@@ -0,0 +1,43 @@
+#include "Bench.h"
+
+#include "Util.h"
+
+#include <cmath>
+#include <cstdio>
+
+// the worldgen terrain grid
+constexpr int GRID_SIZE = WORLD_SIZE;
+constexpr float GRID_STEP = 1 / 32.f;
+
+void benchPerlin()
+{
+    float* scalar = new float[GRID_SIZE * GRID_SIZE];
+    float* batched = new float[GRID_SIZE * GRID_SIZE];
+
+    Bench::run("Perlin::noise (samples)", GRID_SIZE * GRID_SIZE, 5, [&]() {
+        for (int j = 0; j < GRID_SIZE; j++)
+            for (int i = 0; i < GRID_SIZE; i++)
+                scalar[i + j * GRID_SIZE] = Perlin::noise(i * GRID_STEP, j * GRID_STEP);
+    });
+
+    Bench::run("Perlin::noiseGrid (samples)", GRID_SIZE * GRID_SIZE, 5, [&]() {
+        Perlin::noiseGrid(0, 0, GRID_STEP, GRID_SIZE, GRID_SIZE, batched);
+    });
+
+    // odd sized rows go through the kernels' tails
+    Bench::run("Perlin::noiseGrid 13 wide (samples)", 13 * GRID_SIZE, 5, [&]() {
+        Perlin::noiseGrid(0, 0, GRID_STEP, 13, GRID_SIZE, batched);
+    });
+
+    Perlin::noiseGrid(0, 0, GRID_STEP, GRID_SIZE, GRID_SIZE, batched);
+
+    float maxError = 0;
+    for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+        maxError = fmaxf(maxError, fabsf(batched[i] - scalar[i]));
+
+    printf("noiseGrid max error %g (tolerance %g)%s\n", maxError, NOISE_GRID_TOLERANCE,
+        maxError <= NOISE_GRID_TOLERANCE ? "" : " EXCEEDED");
+
+    delete[] scalar;
+    delete[] batched;
+}
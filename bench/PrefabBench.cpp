@@ -0,0 +1,136 @@
+#include "Bench.h"
+
+#include "Prefab.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cstdio>
+
+// worldgen's TREE_CELL, a tree in every cell of the world
+constexpr int CELL = 8;
+constexpr int CELLS = (WORLD_SIZE / CELL) * (WORLD_SIZE / CELL);
+
+// forests planted and timed per way of planting them, after one to warm up
+constexpr int TIMED_FORESTS = 10;
+
+static int mismatches = 0;
+
+// how worldgen placed trees before prefabs, a block at a time
+static void fillAir(const uint8_t blockId, const int x0, const int y0, const int z0, const int x1, const int y1, const int z1)
+{
+    for (int x = x0; x < x1; x++)
+        for (int y = y0; y < y1; y++)
+            for (int z = z0; z < z1; z++)
+                if (World::world.get(x, y, z) == BLOCK_AIR)
+                    World::world.set(x, y, z, blockId);
+}
+
+static void placeTreeBlocks(Random& rand, const int x, const int z)
+{
+    const vec2 treePos = rand.nextIVec2(2) + vec2(x, z);
+
+    const int terrainHeight = World::heightmap[int(treePos.x) + int(treePos.y) * WORLD_SIZE] - 1;
+    const int trunkHeight = 4 + rand.nextInt(2);
+
+    for (int y = terrainHeight; y >= terrainHeight - trunkHeight; y--)
+        World::world.set(treePos.x, y, treePos.y, BLOCK_WOOD);
+
+    fillAir(BLOCK_LEAVES,
+        treePos.x - 2, terrainHeight - trunkHeight + 1, treePos.y - 2,
+        treePos.x + 3, terrainHeight - trunkHeight + 3, treePos.y + 3);
+
+    fillAir(BLOCK_LEAVES,
+        treePos.x - 1, terrainHeight - trunkHeight - 1, treePos.y - 1,
+        treePos.x + 2, terrainHeight - trunkHeight + 1, treePos.y + 2);
+
+    for (int i = 0; i < 4; i++)
+    {
+        const int bit0 = (i >> 0 & 0b01) * 2 - 1;
+        const int bit1 = (i >> 1 & 0b01) * 2 - 1;
+
+        const vec2 foliagePos = vec2(treePos.x + (2 * bit0), treePos.y + (2 * bit1));
+        int cornerStyle = rand.nextInt(7);
+
+        if ((cornerStyle == 0) || (cornerStyle == 2))
+            World::world.set(foliagePos.x, terrainHeight - trunkHeight + 1, foliagePos.y, BLOCK_AIR);
+
+        if ((cornerStyle == 1) || (cornerStyle == 2))
+            World::world.set(foliagePos.x, terrainHeight - trunkHeight + 2, foliagePos.y, BLOCK_AIR);
+
+        const vec2 crownPos = vec2(treePos.x + bit0, treePos.y + bit1);
+        cornerStyle = rand.nextInt(5);
+
+        if (cornerStyle == 0)
+            World::world.set(crownPos.x, terrainHeight - trunkHeight, crownPos.y, BLOCK_AIR);
+
+        World::world.set(crownPos.x, terrainHeight - trunkHeight - 1, crownPos.y, BLOCK_AIR);
+    }
+}
+
+// the same as World.cpp's placeTree
+static void stampTree(Random& rand, const int x, const int z)
+{
+    const vec2 treePos = rand.nextIVec2(2) + vec2(x, z);
+
+    const int terrainHeight = World::heightmap[int(treePos.x) + int(treePos.y) * WORLD_SIZE] - 1;
+    const Prefab& tree = Prefabs::trees[rand.nextInt(Prefabs::TREE_VARIANTS)];
+
+    Prefabs::stamp(tree, rand, treePos.x, terrainHeight, treePos.y);
+}
+
+// a tree in every cell, each with its own stream like worldgen's cells
+template<typename F>
+static void decorate(const int seed, const F& placeTree)
+{
+    for (int i = 0; i < CELLS; i++)
+    {
+        Random rand(uint64_t(seed) * CELLS + i);
+        placeTree(rand, CELL / 2 + i % (WORLD_SIZE / CELL) * CELL, CELL / 2 + i / (WORLD_SIZE / CELL) * CELL);
+    }
+}
+
+// trees stamped from prefabs against placed a block at a time, on top of worldgen's own trees
+void benchPrefabs()
+{
+    // a few different forests, so every variant and cut comes up plenty
+    for (int seed = 1; seed <= 3; seed++)
+    {
+        World::generateWorld(18295169L);
+        decorate(seed, placeTreeBlocks);
+        const uint64_t blockByBlock = World::hash();
+
+        World::generateWorld(18295169L);
+        decorate(seed, stampTree);
+
+        if (World::hash() != blockByBlock)
+        {
+            printf("Prefabs MISMATCH: stamped forest %d came out different to placing it a block at a time\n", seed);
+            mismatches++;
+        }
+    }
+
+    // onto a fresh world each time, like worldgen does, so the trees aren't already there
+    const char* names[] = { "tree a block at a time, every cell", "Prefabs::stamp tree, every cell" };
+    for (int stamped = 0; stamped < 2; stamped++)
+    {
+        double times[TIMED_FORESTS];
+        for (int i = -1; i < TIMED_FORESTS; i++)
+        {
+            World::generateWorld(18295169L);
+
+            const double start = Bench::seconds();
+            if (stamped)
+                decorate(1, stampTree);
+            else
+                decorate(1, placeTreeBlocks);
+
+            if (i >= 0)
+                times[i] = Bench::seconds() - start;
+        }
+
+        Bench::report(names[stamped], times, TIMED_FORESTS, CELLS, 1);
+    }
+
+    Bench::failures += mismatches;
+    printf("Prefabs %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
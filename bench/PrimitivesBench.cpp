@@ -0,0 +1,215 @@
+#include "Bench.h"
+
+#include "Player.h"
+#include "Shader.h"
+#include "TextureGenerator.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+constexpr int RANDOM_OPS = 1 << 20;
+
+constexpr int BOX_SIZE = 16;
+
+constexpr int RAY_COUNT = 214 * 120; // a frame at SCR_DETAIL 0
+
+constexpr int COLLIDE_OPS = 1 << 16;
+
+// the uniforms renderGPU sets every frame
+static const char* const uniformNames[] = { "S", "t", "c.cY", "c.cP", "c.sY", "c.sP", "c.fD", "c.P", "l", "k", "a", "s", "h" };
+constexpr int UNIFORM_COUNT = sizeof(uniformNames) / sizeof(uniformNames[0]);
+
+struct Coords
+{
+    int x[RANDOM_OPS];
+    int y[RANDOM_OPS];
+    int z[RANDOM_OPS];
+};
+
+static void benchBlocks(const Coords& coords)
+{
+    Bench::run("World::getBlock random", RANDOM_OPS, 10, [&]() {
+        long sum = 0;
+        for (int i = 0; i < RANDOM_OPS; i++)
+            sum += World::getBlock(coords.x[i], coords.y[i], coords.z[i]);
+        Bench::sink = sum;
+    });
+
+    // setBlock keeps the bricks, column tops and occupancy up to date too.
+    // save the blocks and put them back so the world doesn't change
+    uint8_t* saved = new uint8_t[RANDOM_OPS];
+    for (int i = 0; i < RANDOM_OPS; i++)
+        saved[i] = World::getBlock(coords.x[i], coords.y[i], coords.z[i]);
+
+    Bench::run("World::setBlock random", RANDOM_OPS * 2, 10, [&]() {
+        for (int i = 0; i < RANDOM_OPS; i++)
+            World::setBlock(coords.x[i], coords.y[i], coords.z[i], BLOCK_STONE);
+        for (int i = RANDOM_OPS - 1; i >= 0; i--)
+            World::setBlock(coords.x[i], coords.y[i], coords.z[i], saved[i]);
+    });
+
+    delete[] saved;
+
+    // a box of air at the terrain surface, filled in and dug out again
+    const vec3 pos0 = vec3(WORLD_SIZE / 2, World::terrainTop, WORLD_SIZE / 2);
+    const vec3 pos1 = pos0 + vec3(BOX_SIZE);
+
+    uint8_t* box = new uint8_t[BOX_SIZE * BOX_SIZE * BOX_SIZE];
+    World::readBox(int(pos0.x), int(pos0.y), int(pos0.z), BOX_SIZE, BOX_SIZE, BOX_SIZE, box);
+
+    Bench::run("World::fillBox 16^3 (blocks)", BOX_SIZE * BOX_SIZE * BOX_SIZE * 2, 20, [&]() {
+        World::fillBox(BLOCK_STONE, pos0, pos1, true);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+    });
+
+    for (int z = 0; z < BOX_SIZE; z++)
+        for (int y = 0; y < BOX_SIZE; y++)
+            for (int x = 0; x < BOX_SIZE; x++)
+                World::setBlock(int(pos0.x) + x, int(pos0.y) + y, int(pos0.z) + z, box[x + (y + z * BOX_SIZE) * BOX_SIZE]);
+
+    delete[] box;
+}
+
+static void benchRaycast()
+{
+    // the primary rays of a frame from above the middle of the world
+    const vec3 origin = vec3(256.5f, World::columnTops[256 + 256 * WORLD_SIZE] - 2.5f, 256.5f);
+    vec3* dirs = new vec3[RAY_COUNT];
+
+    for (int ray = 0; ray < RAY_COUNT; ray++)
+    {
+        const float frustumX = (ray % 214 - 107) / 90.0f;
+        const float frustumY = (ray / 214 - 60) / 90.0f;
+        const float temp = cosf(-0.3f) + frustumY * sinf(-0.3f);
+
+        dirs[ray] = vec3(frustumX * cosf(0.7f) + temp * sinf(0.7f), frustumY * cosf(-0.3f) - sinf(-0.3f),
+            temp * cosf(0.7f) - frustumX * sinf(0.7f)).normalized();
+    }
+
+    Bench::run("World::raycast camera rays", RAY_COUNT, 10, [&]() {
+        int hitAxis = 0;
+        float sum = 0;
+        for (int ray = 0; ray < RAY_COUNT; ray++)
+            sum += World::raycast(origin, dirs[ray], RENDER_DIST, hitAxis).y;
+        Bench::sink = long(sum);
+    });
+
+    delete[] dirs;
+}
+
+static void benchCollide()
+{
+    // standing on the terrain somewhere, moving a bit in any direction
+    Random rand(2);
+    vec3* positions = new vec3[COLLIDE_OPS];
+    vec3* velocities = new vec3[COLLIDE_OPS];
+
+    for (int i = 0; i < COLLIDE_OPS; i++)
+    {
+        const int x = 1 + rand.nextInt(WORLD_SIZE - 2);
+        const int z = 1 + rand.nextInt(WORLD_SIZE - 2);
+
+        positions[i] = vec3(x + 0.5f, World::columnTops[x + z * WORLD_SIZE] - 1.5f, z + 0.5f);
+        velocities[i] = vec3(rand.nextFloat() - 0.5f, rand.nextFloat() * 0.2f, rand.nextFloat() - 0.5f) * 0.4f;
+    }
+
+    const vec3 oldPos = playerPos, oldVelocity = playerVelocity;
+
+    Bench::run("collidePlayer", COLLIDE_OPS, 10, [&]() {
+        for (int i = 0; i < COLLIDE_OPS; i++)
+        {
+            playerPos = positions[i];
+            playerVelocity = velocities[i];
+            collidePlayer();
+        }
+        Bench::sink = long(playerPos.x);
+    });
+
+    playerPos = oldPos;
+    playerVelocity = oldVelocity;
+
+    delete[] positions;
+    delete[] velocities;
+}
+
+static void benchNoiseAndRandom(const Coords& coords)
+{
+    Bench::run("Perlin::noise random points", RANDOM_OPS, 5, [&]() {
+        float sum = 0;
+        for (int i = 0; i < RANDOM_OPS; i++)
+            sum += Perlin::noise(coords.x[i] * 0.0625f, coords.z[i] * 0.0625f);
+        Bench::sink = long(sum);
+    });
+
+    Random rand(3);
+    Bench::run("Random::nextInt(100)", RANDOM_OPS, 10, [&]() {
+        long sum = 0;
+        for (int i = 0; i < RANDOM_OPS; i++)
+            sum += rand.nextInt(100);
+        Bench::sink = sum;
+    });
+}
+
+// one benchmark per hot engine primitive, for tracking them across commits with --json
+void benchPrimitives()
+{
+    char label[64];
+
+    // a few seeds, terrain and trees differ enough between them to change the cost
+    const uint64_t seeds[] = { 18295169L, 1L, 424242L };
+    for (const uint64_t seed : seeds)
+    {
+        snprintf(label, sizeof(label), "generateWorld seed %lu", (unsigned long)seed);
+        Bench::run(label, 1, 3, [&]() {
+            World::generateWorld(seed);
+        });
+    }
+
+    World::generateWorld(18295169L);
+
+    Coords* coords = new Coords;
+    Random rand(1);
+    for (int i = 0; i < RANDOM_OPS; i++)
+    {
+        coords->x[i] = rand.nextInt(WORLD_SIZE);
+        coords->y[i] = rand.nextInt(WORLD_HEIGHT);
+        coords->z[i] = rand.nextInt(WORLD_SIZE);
+    }
+
+    benchBlocks(*coords);
+    benchRaycast();
+    benchCollide();
+    benchNoiseAndRandom(*coords);
+
+    delete coords;
+
+    // the CPU half of generateTextures, the upload needs a GL context
+    int* atlas = new int[ATLAS_WIDTH * ATLAS_HEIGHT]();
+    Bench::run("buildTextureAtlas", 1, 10, [&]() {
+        buildTextureAtlas(151910774187927L, atlas);
+    });
+    Bench::run("loadTextureAtlas (cached)", 1, 10, [&]() {
+        loadTextureAtlas(151910774187927L, atlas);
+    });
+    delete[] atlas;
+
+    // what cacheUniforms would have found in the raytracing shader
+    Shader shader;
+    for (const char* name : uniformNames)
+        shader.cacheUniform(name, strlen(name));
+
+    int lengths[UNIFORM_COUNT];
+    for (int i = 0; i < UNIFORM_COUNT; i++)
+        lengths[i] = strlen(uniformNames[i]);
+
+    Bench::run("Shader::getUniformLocation", UNIFORM_COUNT * 10000, 10, [&]() {
+        long sum = 0;
+        for (int n = 0; n < 10000; n++)
+            for (int i = 0; i < UNIFORM_COUNT; i++)
+                sum += shader.getUniformLocation(uniformNames[i], lengths[i]);
+        Bench::sink = sum;
+    });
+}
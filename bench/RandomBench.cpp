@@ -0,0 +1,124 @@
+#include "Bench.h"
+
+#include "Jobs.h"
+#include "Util.h"
+
+#include <cstdio>
+
+constexpr int VALUE_COUNT = 1 << 20;
+
+// values drawn in parallel chunks have to come out as if one loop drew them all
+constexpr int CHUNK_SIZE = VALUE_COUNT / 64;
+
+static int mismatches = 0;
+
+static void check(const bool ok, const char* what)
+{
+    if (!ok)
+    {
+        printf("Random parity MISMATCH: %s\n", what);
+        mismatches++;
+    }
+}
+
+static void checkParity(uint32_t* serial, uint32_t* bulk)
+{
+    // the first values of java.util.Random for these seeds
+    check(int(Random(0).nextInt()) == -1155484576, "new Random(0).nextInt()");
+    check(int(Random(42).nextInt()) == -1170105035, "new Random(42).nextInt()");
+    check(long(Random(0).nextLong()) == -4962768465676381896L, "new Random(0).nextLong()");
+
+    const uint64_t skips[] = { 0, 1, 2, 3, 1000, 123457, 1 << 22 };
+    for (const uint64_t n : skips)
+    {
+        Random stepped(7);
+        for (uint64_t i = 0; i < n; i++)
+            stepped.nextInt();
+
+        Random skipped(7);
+        skipped.advance(n);
+
+        check(stepped.nextLong() == skipped.nextLong(), "advance(n) vs n calls");
+    }
+
+    // powers of two (and 0) take a different path, odd counts go through the tail
+    const uint32_t bounds[] = { 0, 2, 7, 16, 1000, 1 << 30, 2147483647 };
+    const int counts[] = { 0, 3, 4, 5, VALUE_COUNT - 1 };
+    for (const uint32_t bound : bounds)
+    {
+        for (const int count : counts)
+        {
+            Random a(9);
+            for (int i = 0; i < count; i++)
+                serial[i] = a.nextInt(bound);
+
+            Random b(9);
+            b.nextInts(bound, bulk, count);
+
+            bool same = a.nextInt() == b.nextInt();
+            for (int i = 0; i < count; i++)
+                same &= serial[i] == bulk[i];
+
+            check(same, "nextInts vs nextInt loop");
+        }
+    }
+
+    const Random base(18295169L);
+
+    Random a = base;
+    a.nextInts(1000, serial, VALUE_COUNT);
+
+    Jobs::parallelFor(VALUE_COUNT / CHUNK_SIZE, [&](const int chunk) {
+        Random b = base.ahead(uint64_t(chunk) * CHUNK_SIZE);
+        b.nextInts(1000, bulk + chunk * CHUNK_SIZE, CHUNK_SIZE);
+    });
+
+    bool same = true;
+    for (int i = 0; i < VALUE_COUNT; i++)
+        same &= serial[i] == bulk[i];
+
+    check(same, "parallel chunks from ahead() vs one serial loop");
+
+    check(base.substream(0).nextLong() != base.substream(1).nextLong(), "substreams 0 and 1");
+    check(base.substream(5).nextLong() == base.substream(5).nextLong(), "substream(5) twice");
+
+    Bench::failures += mismatches;
+    printf("Random parity %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
+
+void benchRandom()
+{
+    uint32_t* serial = new uint32_t[VALUE_COUNT];
+    uint32_t* bulk = new uint32_t[VALUE_COUNT];
+
+    checkParity(serial, bulk);
+
+    Random rand(1);
+
+    Bench::run("Random::nextInt(7) loop", VALUE_COUNT, 10, [&]() {
+        for (int i = 0; i < VALUE_COUNT; i++)
+            serial[i] = rand.nextInt(7);
+    });
+
+    Bench::run("Random::nextInts(7)", VALUE_COUNT, 10, [&]() {
+        rand.nextInts(7, bulk, VALUE_COUNT);
+    });
+
+    Bench::run("Random::nextInt(16) loop", VALUE_COUNT, 10, [&]() {
+        for (int i = 0; i < VALUE_COUNT; i++)
+            serial[i] = rand.nextInt(16);
+    });
+
+    Bench::run("Random::nextInts(16)", VALUE_COUNT, 10, [&]() {
+        rand.nextInts(16, bulk, VALUE_COUNT);
+    });
+
+    Bench::run("Random::advance(2^40 + i)", 1 << 16, 10, [&]() {
+        for (int i = 0; i < 1 << 16; i++)
+            rand.advance((uint64_t(1) << 40) + i);
+        Bench::sink = rand.nextInt();
+    });
+
+    delete[] serial;
+    delete[] bulk;
+}
@@ -0,0 +1,114 @@
+#include "Bench.h"
+
+#include "DistanceField.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+
+// the same rays getPixel in raytrace.comp casts, at SCR_DETAIL 0
+constexpr int FRAME_WIDTH = 214;
+constexpr int FRAME_HEIGHT = 120;
+constexpr float FRUSTUM_DIV = 90.0f; // SCR_RES * FOV / defaultRes
+
+constexpr int CAMERAS = 16;
+
+static const vec3 lightDirection = vec3(0.866025404f, -0.866025404f, 0.866025404f);
+
+struct Camera
+{
+    vec3 pos;
+    float yaw, pitch;
+};
+
+// cast one frame's primary and shadow rays, counting the steps each kind takes
+static void renderFrame(const Camera& camera, long& primarySteps, long& shadowSteps, long& shadowRays)
+{
+    const float cY = cosf(camera.yaw), sY = sinf(camera.yaw);
+    const float cP = cosf(camera.pitch), sP = sinf(camera.pitch);
+
+    for (int py = 0; py < FRAME_HEIGHT; py++)
+    {
+        for (int px = 0; px < FRAME_WIDTH; px++)
+        {
+            const float frustumX = (px - 0.5f * FRAME_WIDTH) / FRUSTUM_DIV;
+            const float frustumY = (py - 0.5f * FRAME_HEIGHT) / FRUSTUM_DIV;
+
+            const float temp = cP + frustumY * sP;
+            const vec3 rayDir = vec3(frustumX * cY + temp * sY, frustumY * cP - sP, temp * cY - frustumX * sY).normalized();
+
+            int hitAxis;
+            long steps = World::raycastSteps;
+            const vec3 hitPos = World::raycast(camera.pos, rayDir, RENDER_DIST, hitAxis);
+            primarySteps += World::raycastSteps - steps;
+
+            if (hitPos.x < 0)
+                continue;
+
+            // step back out of the block like the shader does before tracing towards the sun
+            steps = World::raycastSteps;
+            World::raycast(hitPos - rayDir * 0.01f, lightDirection, RENDER_DIST / 2, hitAxis);
+            shadowSteps += World::raycastSteps - steps;
+            shadowRays++;
+        }
+    }
+}
+
+// how many ray march iterations a frame costs. Build with DISTANCE_FIELD
+// (Minecraft4k_bench_df) to compare against the other acceleration structures alone
+void benchRaySteps()
+{
+#ifdef DISTANCE_FIELD
+    const char* accel = "df";
+#else
+    const char* accel = "no df";
+#endif
+
+    char label[64];
+
+    World::generateWorld(18295169L);
+
+#ifdef DISTANCE_FIELD
+    Bench::run("distance field build", 1, 3, []() {
+        DistanceField::build();
+    });
+
+    // digging a block out recomputes the area around it
+    Bench::run("distance field update 1 block", 1, 100, []() {
+        World::setBlock(WORLD_SIZE / 2, WORLD_HEIGHT / 2, WORLD_SIZE / 2, BLOCK_AIR);
+        World::setBlock(WORLD_SIZE / 2, WORLD_HEIGHT / 2, WORLD_SIZE / 2, BLOCK_STONE);
+    });
+#endif
+
+    // cameras standing on the surface looking around, slightly down like a player would
+    Camera cameras[CAMERAS];
+    Random rand(1);
+    for (int i = 0; i < CAMERAS; i++)
+    {
+        const int x = RENDER_DIST + rand.nextInt(WORLD_SIZE - RENDER_DIST * 2);
+        const int z = RENDER_DIST + rand.nextInt(WORLD_SIZE - RENDER_DIST * 2);
+
+        int y = 0;
+        while (y < WORLD_HEIGHT && World::getBlock(x, y, z) == BLOCK_AIR)
+            y++;
+
+        cameras[i] = { vec3(x + 0.5f, y - 1.8f, z + 0.5f), rand.nextFloat() * 6.2831853f, rand.nextFloat() * 0.6f - 0.4f };
+    }
+
+    long primarySteps = 0, shadowSteps = 0, shadowRays = 0;
+    for (const Camera& camera : cameras)
+        renderFrame(camera, primarySteps, shadowSteps, shadowRays);
+
+    const long primaryRays = long(CAMERAS) * FRAME_WIDTH * FRAME_HEIGHT;
+    printf("%s: %.2f steps per primary ray, %.2f steps per shadow ray\n", accel,
+        double(primarySteps) / primaryRays, double(shadowSteps) / shadowRays);
+
+    snprintf(label, sizeof(label), "%s frame rays (per pixel)", accel);
+    Bench::run(label, primaryRays, 2, [&]() {
+        long ignored = 0;
+        for (const Camera& camera : cameras)
+            renderFrame(camera, ignored, ignored, ignored);
+        Bench::sink = ignored;
+    });
+}
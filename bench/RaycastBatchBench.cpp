@@ -0,0 +1,156 @@
+#include "Bench.h"
+
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+
+// the same rays getPixel in raytrace.comp casts, at SCR_DETAIL 0
+constexpr int FRAME_WIDTH = 214;
+constexpr int FRAME_HEIGHT = 120;
+constexpr float FRUSTUM_DIV = 90.0f; // SCR_RES * FOV / defaultRes
+
+constexpr int RAY_COUNT = FRAME_WIDTH * FRAME_HEIGHT;
+
+// hit positions can be a rounding error apart, the jumps over empty space take different routes
+constexpr float HIT_TOLERANCE = 1e-3f;
+
+struct Rays
+{
+    float data[9][RAY_COUNT];
+
+    World::Vec3Array origins = { data[0], data[1], data[2] };
+    World::Vec3Array dirs = { data[3], data[4], data[5] };
+    World::Vec3Array hits = { data[6], data[7], data[8] };
+
+    int hitAxes[RAY_COUNT];
+    uint8_t hitBlocks[RAY_COUNT];
+
+    void set(const int ray, const vec3& origin, const vec3& dir)
+    {
+        origins.x[ray] = origin.x;
+        origins.y[ray] = origin.y;
+        origins.z[ray] = origin.z;
+        dirs.x[ray] = dir.x;
+        dirs.y[ray] = dir.y;
+        dirs.z[ray] = dir.z;
+    }
+};
+
+// one frame of camera rays from above the middle of the world, neighbours go almost the same way
+static void cameraRays(Rays& rays)
+{
+    const vec3 pos = vec3(256.5f, World::columnTops[256 + 256 * WORLD_SIZE] - 2.5f, 256.5f);
+    const float cY = cosf(0.7f), sY = sinf(0.7f);
+    const float cP = cosf(-0.3f), sP = sinf(-0.3f);
+
+    for (int py = 0; py < FRAME_HEIGHT; py++)
+    {
+        for (int px = 0; px < FRAME_WIDTH; px++)
+        {
+            const float frustumX = (px - 0.5f * FRAME_WIDTH) / FRUSTUM_DIV;
+            const float frustumY = (py - 0.5f * FRAME_HEIGHT) / FRUSTUM_DIV;
+
+            const float temp = cP + frustumY * sP;
+            const vec3 dir = vec3(frustumX * cY + temp * sY, frustumY * cP - sP, temp * cY - frustumX * sY).normalized();
+
+            rays.set(px + py * FRAME_WIDTH, pos, dir);
+        }
+    }
+}
+
+// rays from anywhere between the sky and the terrain, going anywhere
+static void randomRays(Rays& rays)
+{
+    Random rand(3);
+
+    for (int ray = 0; ray < RAY_COUNT; ray++)
+    {
+        const vec3 origin = vec3(rand.nextFloat() * WORLD_SIZE, rand.nextFloat() * WORLD_HEIGHT / 2, rand.nextFloat() * WORLD_SIZE);
+        const vec3 dir = vec3(rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f, rand.nextFloat() - 0.5f).normalized();
+
+        rays.set(ray, origin, dir);
+    }
+}
+
+static void castScalar(Rays& rays)
+{
+    for (int ray = 0; ray < RAY_COUNT; ray++)
+    {
+        int axis = -1;
+        uint8_t block = BLOCK_AIR;
+        const vec3 hit = World::raycast(vec3(rays.origins.x[ray], rays.origins.y[ray], rays.origins.z[ray]),
+            vec3(rays.dirs.x[ray], rays.dirs.y[ray], rays.dirs.z[ray]), RENDER_DIST, axis, &block);
+
+        rays.hits.x[ray] = hit.x;
+        rays.hits.y[ray] = hit.y;
+        rays.hits.z[ray] = hit.z;
+        rays.hitAxes[ray] = axis;
+        rays.hitBlocks[ray] = block;
+    }
+}
+
+static void castBatch(Rays& rays)
+{
+    World::raycastBatch(RAY_COUNT, rays.origins, rays.dirs, RENDER_DIST, rays.hits, rays.hitAxes, rays.hitBlocks);
+}
+
+static int countMismatches(const Rays& a, const Rays& b)
+{
+    int mismatches = 0;
+    for (int ray = 0; ray < RAY_COUNT; ray++)
+    {
+        const bool same = fabsf(a.hits.x[ray] - b.hits.x[ray]) < HIT_TOLERANCE &&
+            fabsf(a.hits.y[ray] - b.hits.y[ray]) < HIT_TOLERANCE &&
+            fabsf(a.hits.z[ray] - b.hits.z[ray]) < HIT_TOLERANCE &&
+            a.hitAxes[ray] == b.hitAxes[ray] && a.hitBlocks[ray] == b.hitBlocks[ray];
+
+        mismatches += !same;
+    }
+
+    return mismatches;
+}
+
+// World::raycastBatch against a loop of World::raycast, on a camera's rays and on random ones
+void benchRaycastBatch()
+{
+    char label[64];
+
+    World::generateWorld(18295169L);
+
+    Rays* scalar = new Rays;
+    Rays* batch = new Rays;
+
+    void (*const makeRays[])(Rays&) = { cameraRays, randomRays };
+    const char* names[] = { "camera", "random" };
+
+    for (int set = 0; set < 2; set++)
+    {
+        makeRays[set](*scalar);
+        makeRays[set](*batch);
+
+        castScalar(*scalar);
+        castBatch(*batch);
+
+        const int mismatches = countMismatches(*scalar, *batch);
+        if (mismatches != 0)
+        {
+            printf("raycastBatch MISMATCH: %d of %d %s rays\n", mismatches, RAY_COUNT, names[set]);
+            Bench::failures++;
+        }
+
+        snprintf(label, sizeof(label), "raycast loop, %s rays", names[set]);
+        Bench::run(label, RAY_COUNT, 10, [&]() {
+            castScalar(*scalar);
+        });
+
+        snprintf(label, sizeof(label), "raycastBatch, %s rays", names[set]);
+        Bench::run(label, RAY_COUNT, 10, [&]() {
+            castBatch(*batch);
+        });
+    }
+
+    delete scalar;
+    delete batch;
+}
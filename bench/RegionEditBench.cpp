@@ -0,0 +1,399 @@
+#include "Bench.h"
+
+#include "DistanceField.h"
+#include "Occupancy.h"
+#include "Util.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// the box the timings fill and copy about, a big build or a chunk of terrain
+constexpr int BOX_X = 64, BOX_Y = 32, BOX_Z = 64;
+constexpr int BOX_VOLUME = BOX_X * BOX_Y * BOX_Z;
+
+constexpr float BLAST_RADIUS = 16.0f;
+
+static int mismatches = 0;
+
+static long occupancyWords(const int level)
+{
+    return long(Occupancy::wordsX(level)) * Occupancy::wordsY(level) * Occupancy::wordsZ(level);
+}
+
+// everything the bulk edits have to keep the same as setBlock would
+struct WorldState
+{
+    uint64_t hash;
+    int terrainTop;
+    uint8_t* columnTops = new uint8_t[WORLD_SIZE * WORLD_SIZE];
+    uint8_t* bricks = new uint8_t[BRICKS_X * BRICKS_Y * BRICKS_Z];
+    uint64_t* occupancy[OCCUPANCY_LEVELS];
+
+    WorldState()
+    {
+        for (int level = 0; level < OCCUPANCY_LEVELS; level++)
+            occupancy[level] = new uint64_t[occupancyWords(level)];
+    }
+
+    ~WorldState()
+    {
+        delete[] columnTops;
+        delete[] bricks;
+        for (uint64_t* words : occupancy)
+            delete[] words;
+    }
+
+    void save()
+    {
+        hash = World::hash();
+        terrainTop = World::terrainTop;
+        memcpy(columnTops, World::columnTops, WORLD_SIZE * WORLD_SIZE);
+        memcpy(bricks, World::bricks, BRICKS_X * BRICKS_Y * BRICKS_Z);
+        for (int level = 0; level < OCCUPANCY_LEVELS; level++)
+            memcpy(occupancy[level], Occupancy::levels[level], occupancyWords(level) * sizeof(uint64_t));
+    }
+
+    // what's different to the world now, nullptr if nothing
+    const char* compare() const
+    {
+        if (hash != World::hash())
+            return "blocks";
+        if (terrainTop != World::terrainTop || memcmp(columnTops, World::columnTops, WORLD_SIZE * WORLD_SIZE) != 0)
+            return "column tops";
+        if (memcmp(bricks, World::bricks, BRICKS_X * BRICKS_Y * BRICKS_Z) != 0)
+            return "bricks";
+        for (int level = 0; level < OCCUPANCY_LEVELS; level++)
+            if (memcmp(occupancy[level], Occupancy::levels[level], occupancyWords(level) * sizeof(uint64_t)) != 0)
+                return "occupancy";
+
+        return nullptr;
+    }
+};
+
+// what each bulk edit should do, a setBlock at a time
+static void setIn(const int x, const int y, const int z, const uint8_t block, const bool replace)
+{
+    if (World::isWithinWorld(vec3(x, y, z)) && (replace || World::getBlock(x, y, z) == BLOCK_AIR))
+        World::setBlock(x, y, z, block);
+}
+
+static void boxByBlock(const uint8_t block, const vec3& pos0, const vec3& pos1, const bool replace)
+{
+    for (int x = pos0.x; x < pos1.x; x++)
+        for (int y = pos0.y; y < pos1.y; y++)
+            for (int z = pos0.z; z < pos1.z; z++)
+                setIn(x, y, z, block, replace);
+}
+
+static void sphereByBlock(const uint8_t block, const vec3& centre, const float radius, const bool replace)
+{
+    for (int z = int(centre.z - radius) - 1; z <= int(centre.z + radius) + 1; z++)
+    {
+        for (int y = int(centre.y - radius) - 1; y <= int(centre.y + radius) + 1; y++)
+        {
+            for (int x = int(centre.x - radius) - 1; x <= int(centre.x + radius) + 1; x++)
+            {
+                const vec3 d = vec3(x + 0.5f, y + 0.5f, z + 0.5f) - centre;
+                if (d.x * d.x + d.y * d.y + d.z * d.z <= radius * radius)
+                    setIn(x, y, z, block, replace);
+            }
+        }
+    }
+}
+
+static void cylinderByBlock(const uint8_t block, const vec3& base, const float radius, const int height, const bool replace)
+{
+    for (int z = int(base.z - radius) - 1; z <= int(base.z + radius) + 1; z++)
+    {
+        for (int y = int(base.y); y < int(base.y) + height; y++)
+        {
+            for (int x = int(base.x - radius) - 1; x <= int(base.x + radius) + 1; x++)
+            {
+                const float dx = x + 0.5f - base.x, dz = z + 0.5f - base.z;
+                if (dx * dx + dz * dz <= radius * radius)
+                    setIn(x, y, z, block, replace);
+            }
+        }
+    }
+}
+
+static void maskByBlock(const uint8_t block, const int x0, const int y0, const int z0,
+    const int width, const int height, const int depth, const uint8_t* mask, const bool replace)
+{
+    for (int z = 0; z < depth; z++)
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                if (mask[x + (y + z * height) * width] != 0)
+                    setIn(x0 + x, y0 + y, z0 + z, block, replace);
+}
+
+static void writeByBlock(const int x0, const int y0, const int z0,
+    const int width, const int height, const int depth, const uint8_t* blocks, const bool pasteAir)
+{
+    for (int z = 0; z < depth; z++)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const uint8_t block = blocks[x + (y + z * height) * width];
+                if (pasteAir || block != BLOCK_AIR)
+                    setIn(x0 + x, y0 + y, z0 + z, block, true);
+            }
+        }
+    }
+}
+
+// every kind of bulk edit, some of them hanging off the edge of the world. byBlock does
+// them through setBlock instead
+static void runEdits(const bool byBlock, const uint8_t* mask, uint8_t* scratch, int* regionCounts)
+{
+    int edit = 0;
+    DirtyRegions dirty;
+
+    // how many regions the last edit marked
+    const auto counted = [&]() {
+        dirty.clear();
+        World::takeDirty(dirty);
+        regionCounts[edit++] = dirty.count;
+    };
+
+    World::takeDirty(dirty); // start clean
+
+    if (byBlock)
+        boxByBlock(BLOCK_STONE, vec3(100, 10, 100), vec3(140, 40, 130), true);
+    else
+        World::fillBox(BLOCK_STONE, vec3(100, 10, 100), vec3(140, 40, 130), true);
+    counted();
+
+    if (byBlock)
+        boxByBlock(BLOCK_LEAVES, vec3(90, 0, 90), vec3(150, 50, 150), false);
+    else
+        World::fillBox(BLOCK_LEAVES, vec3(90, 0, 90), vec3(150, 50, 150), false);
+    counted();
+
+    if (byBlock)
+        sphereByBlock(BLOCK_AIR, vec3(120.3f, 25.7f, 115.2f), 9.5f, true);
+    else
+        World::fillSphere(BLOCK_AIR, vec3(120.3f, 25.7f, 115.2f), 9.5f, true);
+    counted();
+
+    if (byBlock)
+        sphereByBlock(BLOCK_STONE, vec3(2, 30, 3), 6, false);
+    else
+        World::fillSphere(BLOCK_STONE, vec3(2, 30, 3), 6, false);
+    counted();
+
+    if (byBlock)
+        cylinderByBlock(BLOCK_WOOD, vec3(200.5f, 5, 200.5f), 3.2f, 30, true);
+    else
+        World::fillCylinder(BLOCK_WOOD, vec3(200.5f, 5, 200.5f), 3.2f, 30, true);
+    counted();
+
+    if (byBlock)
+        maskByBlock(BLOCK_BRICKS, 300, 30, 300, 37, 19, 23, mask, false);
+    else
+        World::fillMask(BLOCK_BRICKS, 300, 30, 300, 37, 19, 23, mask, false);
+    counted();
+
+    if (byBlock)
+        maskByBlock(BLOCK_BRICKS, WORLD_SIZE - 12, WORLD_HEIGHT - 9, WORLD_SIZE - 7, 37, 19, 23, mask, true);
+    else
+        World::fillMask(BLOCK_BRICKS, WORLD_SIZE - 12, WORLD_HEIGHT - 9, WORLD_SIZE - 7, 37, 19, 23, mask, true);
+    counted();
+
+    // copy, paste with and without the air, clone onto itself
+    World::readBox(110, 15, 105, 20, 20, 20, scratch);
+
+    if (byBlock)
+        writeByBlock(250, 20, 250, 20, 20, 20, scratch, false);
+    else
+        World::writeBox(250, 20, 250, 20, 20, 20, scratch, false);
+    counted();
+
+    if (byBlock)
+        writeByBlock(260, 30, 240, 20, 20, 20, scratch, true);
+    else
+        World::writeBox(260, 30, 240, 20, 20, 20, scratch, true);
+    counted();
+
+    if (byBlock)
+    {
+        World::readBox(100, 10, 100, 40, 30, 30, scratch);
+        writeByBlock(110, 15, 105, 40, 30, 30, scratch, true);
+    }
+    else
+    {
+        World::copyBox(100, 10, 100, 40, 30, 30, 110, 15, 105);
+    }
+    counted();
+
+    // onto itself in the same z, and back the other way off the edge of the world
+    if (byBlock)
+    {
+        World::readBox(100, 10, 100, 40, 30, 30, scratch);
+        writeByBlock(104, 18, 100, 40, 30, 30, scratch, true);
+    }
+    else
+    {
+        World::copyBox(100, 10, 100, 40, 30, 30, 104, 18, 100);
+    }
+    counted();
+
+    if (byBlock)
+    {
+        World::readBox(0, 5, 10, 30, 20, 30, scratch);
+        writeByBlock(-3, 2, 2, 30, 20, 30, scratch, true);
+    }
+    else
+    {
+        World::copyBox(0, 5, 10, 30, 20, 30, -3, 2, 2);
+    }
+    counted();
+}
+
+constexpr int EDITS = 12;
+
+static void checkEdits()
+{
+    uint8_t* mask = new uint8_t[37 * 19 * 23];
+    Random rand(13);
+    for (int i = 0; i < 37 * 19 * 23; i++)
+        mask[i] = rand.nextInt(3) == 0;
+
+    uint8_t* scratch = new uint8_t[40 * 30 * 30];
+    int bulkRegions[EDITS], blockRegions[EDITS];
+
+    WorldState bulk;
+    World::generateWorld(18295169L);
+    runEdits(false, mask, scratch, bulkRegions);
+    bulk.save();
+
+#ifdef DISTANCE_FIELD
+    // against the whole field worked out again
+    uint8_t* distances = new uint8_t[WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE];
+    memcpy(distances, DistanceField::distances, WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE);
+    DistanceField::build();
+
+    if (memcmp(distances, DistanceField::distances, WORLD_SIZE * WORLD_HEIGHT * WORLD_SIZE) != 0)
+    {
+        printf("RegionEdits MISMATCH: the bulk edits left a different distance field to building it again\n");
+        mismatches++;
+    }
+    delete[] distances;
+#endif
+
+    World::generateWorld(18295169L);
+#ifdef DISTANCE_FIELD
+    // setBlock's distance field updates would take minutes here, and aren't what's being checked
+    DistanceField::invalidate();
+#endif
+    runEdits(true, mask, scratch, blockRegions);
+
+    const char* different = bulk.compare();
+    if (different)
+    {
+        printf("RegionEdits MISMATCH: the bulk edits left different %s to setBlock\n", different);
+        mismatches++;
+    }
+
+    for (int i = 0; i < EDITS; i++)
+    {
+        if (bulkRegions[i] != 1)
+        {
+            printf("RegionEdits MISMATCH: bulk edit %d marked %d dirty regions\n", i, bulkRegions[i]);
+            mismatches++;
+        }
+    }
+
+    delete[] mask;
+    delete[] scratch;
+}
+
+// the bulk edits against setBlock loops, in blocks per second. Each fills and then empties the box
+void benchRegionEdits()
+{
+    checkEdits();
+
+    World::generateWorld(18295169L);
+
+    const vec3 pos0(200, 16, 200);
+    const vec3 pos1 = pos0 + vec3(BOX_X, BOX_Y, BOX_Z);
+    DirtyRegions dirty;
+
+    // what fillBox did before, x outermost. Not with the distance field, which setBlock
+    // updates a block at a time and would take minutes
+#ifndef DISTANCE_FIELD
+    Bench::run("setBlock loop 64x32x64 box (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        boxByBlock(BLOCK_STONE, pos0, pos1, true);
+        boxByBlock(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+#endif
+
+    Bench::run("World::fillBox 64x32x64 (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        World::fillBox(BLOCK_STONE, pos0, pos1, true);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    Bench::run("World::fillBox 64x32x64 air only (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        World::fillBox(BLOCK_STONE, pos0, pos1, false);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    const vec3 blast = pos0 + vec3(BOX_X, BOX_Y, BOX_Z) * 0.5f;
+    const long blastVolume = long(4.0f / 3 * PI * BLAST_RADIUS * BLAST_RADIUS * BLAST_RADIUS);
+
+#ifndef DISTANCE_FIELD
+    Bench::run("sphere setBlock loop r16 (blocks)", blastVolume * 2, 5, [&]() {
+        sphereByBlock(BLOCK_STONE, blast, BLAST_RADIUS, true);
+        sphereByBlock(BLOCK_AIR, blast, BLAST_RADIUS, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+#endif
+
+    Bench::run("World::fillSphere r16 (blocks)", blastVolume * 2, 5, [&]() {
+        World::fillSphere(BLOCK_STONE, blast, BLAST_RADIUS, true);
+        World::fillSphere(BLOCK_AIR, blast, BLAST_RADIUS, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    // a chunk of terrain to paste about
+    uint8_t* terrain = new uint8_t[BOX_VOLUME];
+    World::readBox(100, WORLD_HEIGHT - BOX_Y, 100, BOX_X, BOX_Y, BOX_Z, terrain);
+
+    Bench::run("World::writeBox 64x32x64 (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        World::writeBox(pos0.x, pos0.y, pos0.z, BOX_X, BOX_Y, BOX_Z, terrain, true);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    Bench::run("World::writeBox 64x32x64 without air (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        World::writeBox(pos0.x, pos0.y, pos0.z, BOX_X, BOX_Y, BOX_Z, terrain, false);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    Bench::run("World::copyBox 64x32x64 (blocks)", BOX_VOLUME * 2, 5, [&]() {
+        World::copyBox(100, WORLD_HEIGHT - BOX_Y, 100, BOX_X, BOX_Y, BOX_Z, pos0.x, pos0.y, pos0.z);
+        World::fillBox(BLOCK_AIR, pos0, pos1, true);
+        World::takeDirty(dirty);
+        dirty.clear();
+    });
+
+    delete[] terrain;
+
+    Bench::failures += mismatches;
+    printf("RegionEdits %s\n", mismatches == 0 ? "ok" : "FAILED");
+}
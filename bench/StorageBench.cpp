@@ -0,0 +1,83 @@
+#include "Bench.h"
+
+#include "Util.h"
+#include "World.h"
+
+#include <cstdio>
+
+constexpr int RANDOM_OPS = 1 << 20;
+
+struct Coords
+{
+    int x[RANDOM_OPS];
+    int y[RANDOM_OPS];
+    int z[RANDOM_OPS];
+};
+
+template<typename Storage>
+static void benchStorage(const char* name, Storage& storage, const Coords& coords)
+{
+    char label[64];
+
+    // copy the generated world in, like generateWorld would have written it
+    for (int z = 0; z < WORLD_SIZE; z++)
+        for (int y = 0; y < WORLD_HEIGHT; y++)
+            for (int x = 0; x < WORLD_SIZE; x++)
+                storage.set(x, y, z, World::getBlock(x, y, z));
+    storage.compact();
+
+    printf("%s: %lu KiB resident\n", name, storage.memoryUsage() / 1024);
+
+    snprintf(label, sizeof(label), "%s get sequential", name);
+    Bench::run(label, long(WORLD_SIZE) * WORLD_HEIGHT * WORLD_SIZE, 3, [&]() {
+        long sum = 0;
+        for (int z = 0; z < WORLD_SIZE; z++)
+            for (int y = 0; y < WORLD_HEIGHT; y++)
+                for (int x = 0; x < WORLD_SIZE; x++)
+                    sum += storage.get(x, y, z);
+        Bench::sink = sum;
+    });
+
+    snprintf(label, sizeof(label), "%s get random", name);
+    Bench::run(label, RANDOM_OPS, 10, [&]() {
+        long sum = 0;
+        for (int i = 0; i < RANDOM_OPS; i++)
+            sum += storage.get(coords.x[i], coords.y[i], coords.z[i]);
+        Bench::sink = sum;
+    });
+
+    // dig and refill the same random blocks so every repetition does the same work
+    snprintf(label, sizeof(label), "%s set random", name);
+    Bench::run(label, RANDOM_OPS * 2, 10, [&]() {
+        for (int i = 0; i < RANDOM_OPS; i++)
+            storage.set(coords.x[i], coords.y[i], coords.z[i], BLOCK_AIR);
+        for (int i = 0; i < RANDOM_OPS; i++)
+            storage.set(coords.x[i], coords.y[i], coords.z[i], BLOCK_STONE);
+    });
+
+    printf("%s: %lu KiB resident after edits\n", name, storage.memoryUsage() / 1024);
+}
+
+void benchStorage()
+{
+    World::generateWorld(18295169L);
+
+    Coords* coords = new Coords;
+    Random rand(1);
+    for (int i = 0; i < RANDOM_OPS; i++)
+    {
+        coords->x[i] = rand.nextInt(WORLD_SIZE);
+        coords->y[i] = rand.nextInt(WORLD_HEIGHT);
+        coords->z[i] = rand.nextInt(WORLD_SIZE);
+    }
+
+    FlatStorage<WORLD_LAYOUT>* flat = new FlatStorage<WORLD_LAYOUT>;
+    benchStorage(WORLD_LAYOUT::name, *flat, *coords);
+    delete flat;
+
+    ChunkedStorage* chunked = new ChunkedStorage;
+    benchStorage("chunked", *chunked, *coords);
+    delete chunked;
+
+    delete coords;
+}
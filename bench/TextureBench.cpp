@@ -0,0 +1,56 @@
+#include "Bench.h"
+
+#include "Constants.h"
+#include "Jobs.h"
+#include "TextureGenerator.h"
+
+#include <cstdio>
+
+constexpr int ATLAS_TEXELS = ATLAS_WIDTH * ATLAS_HEIGHT;
+
+// FNV-1a, like World::hash
+static uint64_t hashAtlas(const int* atlas)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (int i = 0; i < ATLAS_TEXELS; i++)
+        hash = (hash ^ uint32_t(atlas[i])) * 0x100000001B3;
+
+    return hash;
+}
+
+// buildTextureAtlas on 1, 2, 4... threads. The atlas has to come out the same every time
+void benchTextures()
+{
+    char label[64];
+
+    int* atlas = new int[ATLAS_TEXELS]();
+
+    uint64_t expectedHash = 0;
+
+    for (int threads = 1;; threads *= 2)
+    {
+        if (threads > Jobs::threadCount())
+            threads = Jobs::threadCount();
+
+        Jobs::setThreadLimit(threads);
+
+        snprintf(label, sizeof(label), "buildTextureAtlas %d threads (texels)", threads);
+        Bench::run(label, ATLAS_TEXELS, 20, [&]() {
+            buildTextureAtlas(151910774187927L, atlas);
+        });
+
+        const uint64_t hash = hashAtlas(atlas);
+        if (threads == 1)
+            expectedHash = hash;
+
+        printf("atlas hash %016lx%s\n", hash, hash == expectedHash ? "" : " MISMATCH");
+        Bench::failures += hash != expectedHash;
+
+        if (threads == Jobs::threadCount())
+            break;
+    }
+
+    Jobs::setThreadLimit(0);
+
+    delete[] atlas;
+}
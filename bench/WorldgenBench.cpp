@@ -0,0 +1,39 @@
+#include "Bench.h"
+
+#include "Jobs.h"
+#include "World.h"
+
+#include <cstdio>
+
+// generateWorld on 1, 2, 4... threads. The world has to come out the same every time
+void benchWorldgen()
+{
+    char label[64];
+
+    uint64_t expectedHash = 0;
+
+    for (int threads = 1;; threads *= 2)
+    {
+        if (threads > Jobs::threadCount())
+            threads = Jobs::threadCount();
+
+        Jobs::setThreadLimit(threads);
+
+        snprintf(label, sizeof(label), "generateWorld %d threads", threads);
+        Bench::run(label, 1, 3, []() {
+            World::generateWorld(18295169L);
+        });
+
+        const uint64_t hash = World::hash();
+        if (threads == 1)
+            expectedHash = hash;
+
+        printf("world hash %016lx%s\n", hash, hash == expectedHash ? "" : " MISMATCH");
+        Bench::failures += hash != expectedHash;
+
+        if (threads == Jobs::threadCount())
+            break;
+    }
+
+    Jobs::setThreadLimit(0);
+}
@@ -8,15 +8,22 @@ const char *raytrace_comp =
  "#version 430\n"
  "layout(local_size_x=16,local_size_y=16) in;"
  "layout(rgba32f,binding=0)writeonly uniform image2D img_output;"
- "layout(r8ui,binding=1)readonly uniform uimage3D world;\n"
+ "layout(r8ui,binding=1)readonly uniform uimage3D world;"
+ "layout(r8ui,binding=4)readonly uniform uimage2D heights;"
+ "layout(r8ui,binding=2)readonly uniform uimage3D bricks;\n"
+ "#ifdef DF\n"
+ "layout(r8ui,binding=3)readonly uniform uimage3D distanceField;\n"
+ "#endif\n"
  "#define WS 512\n"
  "#define WH 64\n"
+ "#define BS 8\n"
  "#define TR 16\n"
  "#define RD 80.0\n"
  "uniform sampler2D t;struct C{vec3 P;float cY;float cP;float sY;float sP;vec2 fD;};"
  "uniform C c;"
  "uniform vec2 S;"
  "uniform vec3 l,k,a,s;"
+ "uniform int h;"
  "int f(ivec3 v)"
  "{"
    "return int(imageLoad(world,v).x);"
@@ -38,6 +45,45 @@ const char *raytrace_comp =
      "{"
        "if(!v(m))"
          "break;"
+       "if(m.y<h&&d.y<=0)"
+         "break;"
+       "\n#ifdef DF\n"
+       "const int Z=int(imageLoad(distanceField,m).x)-1;"
+       "if(Z>0)"
+         "{"
+           "T+=Z*min(e.x,min(e.y,e.z));"
+           "m=clamp(ivec3(floor(i+R*T)),m-Z,m+Z);"
+           "y=mix((m+max(d,0)-i)/R,vec3(1e9),equal(d,ivec3(0)));"
+           "continue;"
+         "}"
+       "\n#endif\n"
+       "if(imageLoad(bricks,(m&~(BS-1))/BS).x==0)"
+         "{"
+           "const ivec3 B=m&~(BS-1);"
+           "const vec3 X=mix((B+max(d,0)*BS-i)/R,vec3(1e9),equal(d,ivec3(0)));"
+           "T=min(X.x,min(X.y,X.z));"
+           "W=T==X.x?0:T==X.y?1:2;"
+           "m=clamp(ivec3(floor(i+R*T)),B,B+BS-1);"
+           "m[W]=B[W]+(d[W]>0?BS:-1);"
+           "y=mix((m+max(d,0)-i)/R,vec3(1e9),equal(d,ivec3(0)));"
+           "continue;"
+         "}"
+       "const int Y=int(imageLoad(heights,m.xz).x);"
+       "if(m.y<Y)"
+         "{"
+           "const int N=y.x<y.z?0:2;"
+           "const float Q=i.y+R.y*y[N];"
+           "if(Q<Y)"
+             "{"
+               "T=y[N];"
+               "W=N;"
+               "m[N]+=d[N];"
+               "y[N]+=e[N];"
+               "m.y=clamp(int(floor(Q)),d.y>0?m.y:-1,d.y>0?Y-1:m.y);"
+               "y.y=d.y==0?1e9:(m.y+max(d.y,0)-i.y)/R.y;"
+               "continue;"
+             "}"
+         "}"
        "int x=f(m);"
        "if(x!=0)"
          "{"